@@ -0,0 +1,228 @@
+#include "afsk.h"
+#include "channelizer.h"
+#include "g3ruh.h"
+#include "hldc.h"
+#include "link_sim.h"
+#include "resample.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_SECONDS 10
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Pseudo-random line levels, about BENCH_SECONDS of audio
+static void bench_bits(uint8_t *bits, int count)
+{
+    uint32_t seed = 1;
+    for (int i = 0; i < count; i++)
+    {
+        seed = seed * 1664525 + 1013904223;
+        bits[i] = seed >> 31;
+    }
+}
+
+static void bench_frame(void *ctx, const buffer_t *frame_buf, int channel)
+{
+    (void)ctx;
+    (void)frame_buf;
+    (void)channel;
+}
+
+int main(void)
+{
+    const int rates[] = {8000, 11025, 22050, 44100, 48000};
+    static uint8_t bits[AFSK_BAUD * BENCH_SECONDS];
+    static float audio[48000 * BENCH_SECONDS];
+    static uint8_t out_bits[AFSK_MAX_SLICERS][2 * 1024 * AFSK_BAUD / 8000 + 2];
+    bench_bits(bits, sizeof(bits));
+
+    printf("%-8s %16s %10s %16s %10s %16s %10s\n", "rate", "mod samples/s", "channels", "demod samples/s", "channels",
+           "9 slicers", "channels");
+    for (int r = 0; r < 5; r++)
+    {
+        int rate = rates[r];
+        buffer_t bits_buf = {.data = bits, .capacity = sizeof(bits), .size = sizeof(bits)};
+        float_buffer_t audio_buf = {.data = audio, .capacity = rate * BENCH_SECONDS, .size = 0};
+
+        afsk_modulator_t mod;
+        afsk_modulator_init(&mod, rate, 0.5f);
+        long samples = 0;
+        double start = bench_now();
+        for (int i = 0; i < 20; i++)
+            samples += afsk_modulator_process(&mod, &bits_buf, &audio_buf);
+        double mod_rate = samples / (bench_now() - start);
+
+        double demod_rate[2];
+        for (int d = 0; d < 2; d++)
+        {
+            afsk_demodulator_t demod;
+            afsk_demodulator_init_slicers(&demod, rate, d ? AFSK_MAX_SLICERS : 1);
+            buffer_t out[AFSK_MAX_SLICERS];
+            samples = 0;
+            start = bench_now();
+            for (int i = 0; i < 3; i++)
+                for (int pos = 0; pos < audio_buf.size; pos += 1024)
+                {
+                    int n = audio_buf.size - pos < 1024 ? audio_buf.size - pos : 1024;
+                    float_buffer_t block = {.data = &audio[pos], .capacity = n, .size = n};
+                    for (int s = 0; s < AFSK_MAX_SLICERS; s++)
+                        out[s] = (buffer_t){.data = out_bits[s], .capacity = sizeof(out_bits[s]), .size = 0};
+                    afsk_demodulator_process_slicers(&demod, &block, out);
+                    samples += n;
+                }
+            demod_rate[d] = samples / (bench_now() - start);
+            afsk_demodulator_free(&demod);
+        }
+
+        printf("%-8d %16.0f %10.0f %16.0f %10.0f %16.0f %10.0f\n", rate, mod_rate, mod_rate / rate,
+               demod_rate[0], demod_rate[0] / rate, demod_rate[1], demod_rate[1] / rate);
+    }
+
+    const int g3ruh_rates[] = {38400, 48000, 96000};
+    static uint8_t g3ruh_bits[G3RUH_BAUD * BENCH_SECONDS];
+    static float g3ruh_audio[96000 * BENCH_SECONDS];
+    static uint8_t g3ruh_out[2 * 1024 * G3RUH_BAUD / G3RUH_MIN_RATE + 2];
+    bench_bits(g3ruh_bits, sizeof(g3ruh_bits));
+
+    printf("\n%-8s %16s %10s %16s %10s %16s\n", "G3RUH", "mod samples/s", "channels", "demod samples/s", "channels",
+           "scrambler bit/s");
+    for (int r = 0; r < 3; r++)
+    {
+        int rate = g3ruh_rates[r];
+        buffer_t bits_buf = {.data = g3ruh_bits, .capacity = sizeof(g3ruh_bits), .size = sizeof(g3ruh_bits)};
+        float_buffer_t audio_buf = {.data = g3ruh_audio, .capacity = rate * BENCH_SECONDS, .size = 0};
+
+        g3ruh_modulator_t mod;
+        g3ruh_modulator_init(&mod, rate, 0.5f);
+        long samples = 0;
+        double start = bench_now();
+        for (int i = 0; i < 5; i++)
+            samples += g3ruh_modulator_process(&mod, &bits_buf, &audio_buf);
+        double mod_rate = samples / (bench_now() - start);
+
+        g3ruh_demodulator_t demod;
+        g3ruh_demodulator_init(&demod, rate);
+        samples = 0;
+        start = bench_now();
+        for (int pos = 0; pos < audio_buf.size; pos += 1024)
+        {
+            int n = audio_buf.size - pos < 1024 ? audio_buf.size - pos : 1024;
+            float_buffer_t block = {.data = &g3ruh_audio[pos], .capacity = n, .size = n};
+            buffer_t out = {.data = g3ruh_out, .capacity = sizeof(g3ruh_out), .size = 0};
+            g3ruh_demodulator_process(&demod, &block, &out);
+            samples += n;
+        }
+        double demod_rate = samples / (bench_now() - start);
+        g3ruh_demodulator_free(&demod);
+
+        g3ruh_scrambler_t scr;
+        g3ruh_scrambler_init(&scr);
+        long scrambled = 0;
+        start = bench_now();
+        for (int i = 0; i < 20; i++)
+            scrambled += g3ruh_scramble_bits(&scr, &bits_buf, &bits_buf);
+        double scramble_rate = scrambled / (bench_now() - start);
+
+        printf("%-8d %16.0f %10.0f %16.0f %10.0f %16.0f\n", rate, mod_rate, mod_rate / rate, demod_rate,
+               demod_rate / rate, scramble_rate);
+    }
+
+    // Decimating a 44.1 kHz capture to 8 samples per bit before the AFSK demodulator
+    const int capture_rates[] = {44100, 48000, 96000};
+    static float decimated[9600 * BENCH_SECONDS + 1];
+    printf("\n%-8s %16s %16s %10s\n", "AFSK", "direct samples/s", "9600 samples/s", "channels");
+    for (int r = 0; r < 3; r++)
+    {
+        int rate = capture_rates[r];
+        buffer_t bits_buf = {.data = bits, .capacity = sizeof(bits), .size = sizeof(bits)};
+        float_buffer_t audio_buf = {.data = g3ruh_audio, .capacity = rate * BENCH_SECONDS, .size = 0};
+        afsk_modulator_t mod;
+        afsk_modulator_init(&mod, rate, 0.5f);
+        afsk_modulator_process(&mod, &bits_buf, &audio_buf);
+
+        double rates_out[2];
+        for (int d = 0; d < 2; d++)
+        {
+            resampler_t rs;
+            resampler_init(&rs, rate, 9600);
+            afsk_demodulator_t demod;
+            afsk_demodulator_init(&demod, d ? 9600 : rate);
+            long samples = 0;
+            double start = bench_now();
+            for (int pos = 0; pos < audio_buf.size; pos += 1024)
+            {
+                int n = audio_buf.size - pos < 1024 ? audio_buf.size - pos : 1024;
+                float_buffer_t block = {.data = &g3ruh_audio[pos], .capacity = n, .size = n};
+                float_buffer_t low = {.data = decimated, .capacity = sizeof(decimated) / sizeof(float), .size = 0};
+                if (d)
+                    resampler_process(&rs, &block, &low);
+                buffer_t out = {.data = out_bits[0], .capacity = sizeof(out_bits[0]), .size = 0};
+                afsk_demodulator_process(&demod, d ? &low : &block, &out);
+                samples += n;
+            }
+            rates_out[d] = samples / (bench_now() - start);
+            afsk_demodulator_free(&demod);
+            resampler_free(&rs);
+        }
+
+        printf("%-8d %16.0f %16.0f %10.0f\n", rate, rates_out[0], rates_out[1], rates_out[1] / rate);
+    }
+
+    // Filter bank cost grows with log2 of the channel count; the receiver adds one AFSK demodulator
+    // per channel
+    const int channel_counts[] = {8, 64, 512};
+    static float iq[2 * 200000];
+    static float blocks[2 * 512 * (1024 / 4 + 1)];
+    for (int i = 0; i < 2 * 200000; i++)
+        iq[i] = g3ruh_audio[i % (48000 * BENCH_SECONDS)];
+    printf("\n%-8s %16s %16s\n", "channels", "bank IQ/s", "receiver IQ/s");
+    for (int c = 0; c < 3; c++)
+    {
+        int channels = channel_counts[c];
+        channelizer_t bank;
+        channelizer_init(&bank, channels);
+        long samples = 0;
+        double start = bench_now();
+        for (int i = 0; i < 10; i++)
+            for (int pos = 0; pos < 200000; pos += 1024)
+            {
+                float_buffer_t block = {.data = &iq[2 * pos], .capacity = 2 * 1024, .size = 2 * min(1024, 200000 - pos)};
+                float_buffer_t out = {.data = blocks, .capacity = sizeof(blocks) / sizeof(float), .size = 0};
+                channelizer_process(&bank, &block, &out);
+                samples += block.size / 2;
+            }
+        double bank_rate = samples / (bench_now() - start);
+        channelizer_free(&bank);
+
+        // 25 kHz channels
+        channelizer_receiver_t rx;
+        channelizer_receiver_init(&rx, channels * 12500, channels, 1, bench_frame, NULL);
+        float_buffer_t all = {.data = iq, .capacity = 2 * 200000, .size = 2 * 200000};
+        start = bench_now();
+        channelizer_receiver_process(&rx, &all);
+        double rx_rate = 200000 / (bench_now() - start);
+        channelizer_receiver_free(&rx);
+
+        printf("%-8d %16.0f %16.0f\n", channels, bank_rate, rx_rate);
+    }
+
+    // Simulated bulk transfer over the link layer, goodput against static FRACK values
+    ax25_link_config_t fast, slow, adaptive;
+    ax25_link_config_init(&fast);
+    fast.adaptive = false;
+    slow = fast;
+    slow.t1_ms = 15000;
+    ax25_link_config_init(&adaptive);
+    printf("\n%-18s %12s %12s %12s\n", "link", "T1 3s B/s", "T1 15s B/s", "adaptive B/s");
+    for (int i = 0; i < LINK_SCENARIOS; i++)
+        printf("%-18s %12.1f %12.1f %12.1f\n", link_scenarios[i].name, link_goodput(&fast, &link_scenarios[i], NULL),
+               link_goodput(&slow, &link_scenarios[i], NULL), link_goodput(&adaptive, &link_scenarios[i], NULL));
+    return 0;
+}
@@ -0,0 +1,148 @@
+#ifndef AFSK_H
+#define AFSK_H
+
+#include "buffer.h"
+#include "hldc.h"
+#include <stdint.h>
+
+// Bell 202 AFSK at 1200 baud. Line level 1 is sent as the mark tone, 0 as the space tone, so
+// the NRZI bits of hldc_framer_process modulate directly.
+
+#define AFSK_BAUD 1200
+#define AFSK_MARK_HZ 1200
+#define AFSK_SPACE_HZ 2200
+#define AFSK_MIN_RATE 8000
+#define AFSK_MAX_RATE 192000
+
+// Sine table of the NCO, shared by all modulators
+#define AFSK_TABLE_BITS 12
+#define AFSK_TABLE_SIZE (1 << AFSK_TABLE_BITS)
+
+typedef enum
+{
+    AFSK_SUCCESS = 0,
+    AFSK_INVALID_RATE,
+    AFSK_BUF_TOO_SMALL,
+    AFSK_NOMEM,
+} afsk_error_e;
+
+typedef struct afsk_modulator
+{
+    int sample_rate;
+    float amplitude;
+    uint32_t phase;      // NCO phase, carried across bits and calls so tones switch without a jump
+    uint32_t mark_step;  // Phase increments per sample
+    uint32_t space_step;
+    int bit_phase;       // Position of the next sample within the current bit, in 1/(AFSK_BAUD * sample_rate) s
+} afsk_modulator_t;
+
+int afsk_modulator_init(afsk_modulator_t *mod, int sample_rate, float amplitude);
+
+// Samples the next bits take, for sizing output buffers
+int afsk_modulator_samples(const afsk_modulator_t *mod, int bits);
+
+// Modulates bits (one per byte, as written by hldc_framer_process) into out_buf, replacing
+// its contents. Returns the number of samples or a negative error, in which case nothing is
+// written and the modulator is unchanged.
+int afsk_modulator_process(afsk_modulator_t *mod, const buffer_t *bits_buf, float_buffer_t *out_buf);
+
+// As afsk_modulator_process, with samples scaled to 16 bit for sound cards
+int afsk_modulator_process_s16(afsk_modulator_t *mod, const buffer_t *bits_buf, int16_t *out, int capacity);
+
+// Samples filtered per pass through the demodulator's work buffers
+#define AFSK_DEMOD_CHUNK 256
+
+#define AFSK_MAX_SLICERS 9
+#define AFSK_SLICER_SPAN_DB 8.0f // Slicers weigh the space tone from -8 to +8 dB against mark
+
+// Decision stage fed by the shared filters: weighs the tones, finds transitions and recovers
+// the bit clock
+typedef struct afsk_slicer
+{
+    float space_gain;
+    float last;   // Previous discriminator output
+    uint32_t pll; // Bit clock, a bit is sampled when it wraps past INT32_MAX
+} afsk_slicer_t;
+
+// Receive chain: bandpass FIR, mark/space quadrature correlators over one bit, envelope AGC and
+// a digital PLL that samples the discriminator once per bit. Filters run as dot products over
+// blocks of samples, vectorized with SSE where available.
+typedef struct afsk_demodulator
+{
+    int sample_rate;
+
+    int bp_taps;     // Bandpass length, padded to a multiple of 4
+    float *bp;       // Coefficients, time reversed
+    int corr_taps;   // Correlator length (one bit), padded to a multiple of 4
+    float *corr;     // Mark cos, mark sin, space cos, space sin, corr_taps each
+    float *raw;      // bp_taps - 1 samples of history, then the chunk
+    float *filtered; // corr_taps - 1 bandpassed samples of history, then the chunk
+
+    float level;       // AGC envelope of the mark and space amplitudes
+    float agc_attack;
+    float agc_decay;
+
+    uint32_t pll_step;
+    float pll_inertia; // Share of the clock phase kept at each data transition
+
+    int slicer_count;
+    afsk_slicer_t slicers[AFSK_MAX_SLICERS];
+} afsk_demodulator_t;
+
+int afsk_demodulator_init(afsk_demodulator_t *demod, int sample_rate);
+
+// Demodulator with slicers sharing the filters, their space gains spread evenly in dB over
+// AFSK_SLICER_SPAN_DB either side of 0 dB
+int afsk_demodulator_init_slicers(afsk_demodulator_t *demod, int sample_rate, int slicers);
+
+void afsk_demodulator_free(afsk_demodulator_t *demod);
+
+// Most bits samples can produce, for sizing output buffers
+int afsk_demodulator_bits(const afsk_demodulator_t *demod, int samples);
+
+// Demodulates a block of audio into line levels (one per byte) for hldc_deframer_process,
+// replacing the contents of out_bits_buf. Returns the number of bits or a negative error.
+// Only for a single slicer.
+int afsk_demodulator_process(afsk_demodulator_t *demod, const float_buffer_t *audio_buf, buffer_t *out_bits_buf);
+
+// As afsk_demodulator_process, with out_bits_bufs holding one buffer per slicer
+int afsk_demodulator_process_slicers(afsk_demodulator_t *demod, const float_buffer_t *audio_buf, buffer_t *out_bits_bufs);
+
+// Receives a frame that passed the FCS check, valid only during the call. slicer is the first
+// slicer that decoded it.
+typedef void afsk_frame_callback_t(void *ctx, const buffer_t *frame_buf, int slicer);
+
+#define AFSK_RECENT_FRAMES (2 * AFSK_MAX_SLICERS)
+#define AFSK_DUPLICATE_BITS 32 // Slicers decode the same frame within this many bit times
+
+typedef struct afsk_recent_frame
+{
+    uint16_t fcs;
+    uint64_t sample; // When it was decoded
+} afsk_recent_frame_t;
+
+// Demodulator, one deframer per slicer and suppression of frames decoded by several slicers
+typedef struct afsk_receiver
+{
+    afsk_demodulator_t demod;
+    hldc_deframer_t deframers[AFSK_MAX_SLICERS];
+    uint8_t *bits; // Bit scratch for one chunk, per slicer
+    int bits_capacity;
+    uint64_t samples; // Samples processed
+
+    afsk_recent_frame_t recent[AFSK_RECENT_FRAMES];
+    int recent_next;
+    uint32_t decoded[AFSK_MAX_SLICERS]; // Frames each slicer decoded, duplicates included
+
+    afsk_frame_callback_t *callback;
+    void *ctx;
+} afsk_receiver_t;
+
+int afsk_receiver_init(afsk_receiver_t *rx, int sample_rate, int slicers, afsk_frame_callback_t *callback, void *ctx);
+
+void afsk_receiver_free(afsk_receiver_t *rx);
+
+// Returns the number of frames passed to the callback or a negative error
+int afsk_receiver_process(afsk_receiver_t *rx, const float_buffer_t *audio_buf);
+
+#endif
@@ -8,6 +8,7 @@
 #define AX25_ADDR_MAX_CALLSIGN_LEN 6
 #define AX25_ADDR_LEN 7
 #define AX25_ADDR_PAD ' '
+#define AX25_MAX_PATH_LEN 8
 
 typedef enum
 {
@@ -15,6 +16,7 @@ typedef enum
     AX25_ADDR_BUF_TOO_SMALL,
     AX25_BUF_TOO_SMALL,
     AX25_ADDR_PACK_FAILED,
+    AX25_INFO_TOO_LARGE,
 } ax25_error_e;
 
 typedef struct ax25_addr
@@ -33,12 +35,27 @@ ax25_error_e ax25_addr_pack(const ax25_addr_t *addr, buffer_t *out_buf);
 
 ax25_error_e ax25_addr_unpack(ax25_addr_t *addr, const buffer_t *buf);
 
+#define AX25_MAX_ADDR_COUNT (2 + AX25_MAX_PATH_LEN)
+
+// Number of addresses (destination, source, path) in the address field of a frame
+int ax25_addr_count(const buffer_t *buf);
+
+// Callsign and SSID packed into an integer, ordered like the callsign text
+#define AX25_KEY_SSID_MASK 0x0fULL
+#define AX25_KEY_CALLSIGN_MASK (~AX25_KEY_SSID_MASK)
+
+uint64_t ax25_addr_key(const ax25_addr_t *addr);
+
+uint64_t ax25_addr_key_wire(const uint8_t *data);
+
+void ax25_addr_from_key(ax25_addr_t *addr, uint64_t key);
+
 #define AX25_CONTROL_LEN 1
 #define AX25_PROTOCOL_LEN 1
-#define AX25_MAX_PATH_LEN 8
-#define AX25_MAX_INFO_LEN 256
+#define AX25_MAX_INFO_LEN 256 // Default info storage size, the runtime limit is the packet's info_capacity
 #define AX25_MIN_PACKET_LEN (AX25_ADDR_LEN * 2 + AX25_CONTROL_LEN + AX25_PROTOCOL_LEN)
-#define AX25_MAX_PACKET_LEN (AX25_MIN_PACKET_LEN + AX25_MAX_PATH_LEN * AX25_ADDR_LEN + AX25_MAX_INFO_LEN)
+#define AX25_PACKET_LEN_FOR(info_len) (AX25_MIN_PACKET_LEN + AX25_MAX_PATH_LEN * AX25_ADDR_LEN + (info_len))
+#define AX25_MAX_PACKET_LEN AX25_PACKET_LEN_FOR(AX25_MAX_INFO_LEN)
 
 typedef struct ax25_packet
 {
@@ -48,14 +65,25 @@ typedef struct ax25_packet
     uint8_t path_len;
     uint8_t control;
     uint8_t protocol;
-    uint8_t info[AX25_MAX_INFO_LEN];
+    uint8_t *info;
     uint16_t info_len;
+    uint16_t info_capacity;
 } ax25_packet_t;
 
-void ax25_packet_init(ax25_packet_t *packet);
+// Initializes a packet whose info field is stored in caller-provided memory
+void ax25_packet_init(ax25_packet_t *packet, uint8_t *info, int info_capacity);
+
+// Resets header fields and info length, keeping the info storage
+void ax25_packet_reset(ax25_packet_t *packet);
 
 int ax25_packet_len(const ax25_packet_t *packet);
 
+// Address field only, for frames whose control field is not followed by a protocol byte.
+// Both return the address field length (the control field offset) or a negative error.
+int ax25_packet_pack_header(const ax25_packet_t *packet, buffer_t *out_buf);
+
+int ax25_packet_unpack_header(ax25_packet_t *packet, const buffer_t *buf);
+
 ax25_error_e ax25_packet_pack(const ax25_packet_t *packet, buffer_t *out_buf);
 
 ax25_error_e ax25_packet_unpack(ax25_packet_t *packet, const buffer_t *buf);
@@ -0,0 +1,179 @@
+#ifndef AX25_LINK_H
+#define AX25_LINK_H
+
+#include "ax25.h"
+#include "buffer.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Connected-mode AX.25 2.2 data link (LAPB): SABM(E)/UA/DISC/DM, I/RR/RNR/REJ/SREJ, XID,
+// modulo 8 and 128. Time is supplied by the caller as milliseconds on any monotonic clock.
+
+#define AX25_LINK_MAX_WINDOW 127
+#define AX25_LINK_SLOTS 128
+
+typedef enum
+{
+    AX25_LINK_SUCCESS = 0,
+    AX25_LINK_MALFORMED,
+    AX25_LINK_NOT_OURS,
+    AX25_LINK_NOT_CONNECTED,
+    AX25_LINK_NOMEM,
+} ax25_link_error_e;
+
+typedef enum
+{
+    AX25_LINK_DISCONNECTED = 0,
+    AX25_LINK_AWAITING_XID,
+    AX25_LINK_AWAITING_CONNECTION,
+    AX25_LINK_AWAITING_RELEASE,
+    AX25_LINK_CONNECTED,
+    AX25_LINK_TIMER_RECOVERY,
+} ax25_link_state_e;
+
+typedef enum
+{
+    AX25_LINK_EVENT_CONNECTED = 0,
+    AX25_LINK_EVENT_DISCONNECTED,
+    AX25_LINK_EVENT_FAILED, // Retries exhausted or connection refused
+    AX25_LINK_EVENT_RESET,  // Link re-established after a protocol error or a peer reset
+} ax25_link_event_e;
+
+typedef struct ax25_link_config
+{
+    bool modulo128; // Request (and accept) SABME
+    bool srej;      // Selective reject
+    bool xid;       // Negotiate parameters before connecting
+    int window;     // k, outstanding I frames
+    int paclen;     // N1, maximum I field length
+    int retries;    // N2
+    uint32_t t1_ms; // Acknowledgement timer, the initial value when adaptive
+    uint32_t t2_ms; // Delayed acknowledgement
+    uint32_t t3_ms; // Idle link probe
+
+    // The caller reports the end of every transmission with ax25_link_transmitted, T1 and the
+    // round trip then run from there so time spent on the air does not count against them
+    bool tx_complete;
+
+    // Adaptive mode: T1 follows the measured round trip time and backs off on expiry,
+    // paclen shrinks on frame loss and grows back while frames get through
+    bool adaptive;
+    uint32_t t1_min_ms;
+    uint32_t t1_max_ms;
+    int paclen_min;
+} ax25_link_config_t;
+
+// frame is wire format without FCS, valid only during the call
+typedef void ax25_link_output_t(void *ctx, const buffer_t *frame);
+typedef void ax25_link_receive_t(void *ctx, const uint8_t *data, int len);
+typedef void ax25_link_event_t(void *ctx, ax25_link_event_e event);
+
+typedef struct ax25_link
+{
+    ax25_addr_t local;
+    ax25_addr_t remote;
+    ax25_addr_t path[AX25_MAX_PATH_LEN]; // Digipeaters, outgoing order
+    int path_len;
+
+    ax25_link_config_t config;
+    ax25_link_state_e state;
+
+    // Negotiated parameters
+    int modulus;
+    int window;
+    int paclen_max;
+    bool srej;
+
+    int paclen; // In use, adapts below paclen_max
+
+    bool negotiated; // XID exchanged since the link was last disconnected
+
+    // Send side. Unsent data is a byte ring cut into I fields only when sent, so paclen
+    // applies to data already queued. Sent I fields live in slots addressed by an absolute
+    // frame counter: head is the oldest unacknowledged, next the next to (re)send and
+    // sent one past the newest ever sent.
+    uint8_t *queue;
+    int queue_capacity;
+    int queue_head;
+    int queue_len;
+    uint8_t *tx_data;
+    uint16_t tx_len[AX25_LINK_SLOTS];
+    uint32_t tx_head;
+    uint32_t tx_next;
+    uint32_t tx_sent;
+    uint32_t seq_base; // Absolute counter that maps to sequence number 0
+
+    // Receive side, with out of sequence frames held for selective reject
+    uint8_t *rx_data;
+    uint16_t rx_len[AX25_LINK_SLOTS];
+    bool rx_have[AX25_LINK_SLOTS];
+    bool srej_sent[AX25_LINK_SLOTS];
+    int vr;
+
+    bool peer_busy;
+    bool own_busy;
+    bool reject_sent;
+    bool ack_pending;
+    int rc;
+
+    // Round trip estimation, only frames sent once are timed (Karn's algorithm)
+    uint64_t tx_time[AX25_LINK_SLOTS]; // When each I frame was first sent
+    uint32_t tx_stamp;                 // Frames before this have been reported transmitted
+    bool tx_resent[AX25_LINK_SLOTS];
+    int srtt;   // Milliseconds scaled by 8, 0 before the first sample
+    int rttvar; // Milliseconds scaled by 4
+
+    int clean_acked;        // Frames acknowledged since paclen last changed
+    uint32_t paclen_recover; // No further paclen decrease until this frame is acknowledged
+
+    uint32_t t1_ms;     // Current T1 value
+    uint64_t t1_expiry; // 0 when stopped
+    bool t1_deferred;   // T1 starts when the current transmission ends
+    bool tx_busy;       // Frames handed to output and not yet reported transmitted
+    uint64_t t2_expiry;
+    uint64_t t3_expiry;
+
+    uint8_t *frame; // Scratch for outgoing frames
+    int frame_capacity;
+
+    ax25_link_output_t *output;
+    ax25_link_receive_t *receive;
+    ax25_link_event_t *event;
+    void *ctx;
+} ax25_link_t;
+
+void ax25_link_config_init(ax25_link_config_t *config);
+
+int ax25_link_init(ax25_link_t *link, const ax25_addr_t *local, const ax25_addr_t *remote,
+                   const ax25_link_config_t *config, ax25_link_output_t *output,
+                   ax25_link_receive_t *receive, ax25_link_event_t *event, void *ctx);
+
+void ax25_link_free(ax25_link_t *link);
+
+int ax25_link_connect(ax25_link_t *link, uint64_t now_ms);
+
+int ax25_link_disconnect(ax25_link_t *link, uint64_t now_ms);
+
+// Queues data to be sent as I frames of up to paclen bytes. Returns the number of bytes accepted,
+// which is less than len when the send queue is full. Data may be queued before connecting.
+int ax25_link_send(ax25_link_t *link, const uint8_t *data, int len, uint64_t now_ms);
+
+// Bytes queued but not yet acknowledged
+int ax25_link_pending(const ax25_link_t *link);
+
+// Own receiver busy, the peer is told to stop sending with RNR
+void ax25_link_set_busy(ax25_link_t *link, bool busy, uint64_t now_ms);
+
+// Processes a received frame (without FCS) addressed to this link
+int ax25_link_receive(ax25_link_t *link, const buffer_t *frame, uint64_t now_ms);
+
+// All frames handed to output so far have left the transmitter, with tx_complete set
+void ax25_link_transmitted(ax25_link_t *link, uint64_t now_ms);
+
+// Runs expired timers
+void ax25_link_tick(ax25_link_t *link, uint64_t now_ms);
+
+// Earliest running timer deadline, 0 when no timer runs
+uint64_t ax25_link_next_deadline(const ax25_link_t *link);
+
+#endif
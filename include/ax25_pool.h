@@ -0,0 +1,62 @@
+#ifndef AX25_POOL_H
+#define AX25_POOL_H
+
+#include "ax25.h"
+#include "buffer.h"
+#include <stdatomic.h>
+#include <stdint.h>
+
+#define AX25_POOL_CACHE_SIZE 32
+
+// Fixed-size, lock-free pool of reference-counted packets
+typedef struct ax25_pool
+{
+    void *entries;
+    size_t entry_size;
+    uint32_t count;
+    int info_capacity;
+    _Atomic uint64_t head; // ABA tag << 32 | index of first free entry
+    atomic_int available;
+} ax25_pool_t;
+
+// Per-thread cache of free entries, must not be shared between threads
+typedef struct ax25_pool_cache
+{
+    ax25_pool_t *pool;
+    uint32_t count;
+    uint32_t entries[AX25_POOL_CACHE_SIZE];
+} ax25_pool_cache_t;
+
+typedef int ax25_pool_decoder_t(ax25_packet_t *packet, const buffer_t *buf);
+
+// Each packet gets info storage of info_capacity bytes, allocated along with the pool
+int ax25_pool_init(ax25_pool_t *pool, uint32_t count, int info_capacity);
+
+void ax25_pool_free(ax25_pool_t *pool);
+
+int ax25_pool_available(const ax25_pool_t *pool);
+
+// Returns an initialized packet holding one reference, or NULL when the pool is exhausted
+ax25_packet_t *ax25_pool_alloc(ax25_pool_t *pool);
+
+ax25_packet_t *ax25_pool_retain(ax25_packet_t *packet);
+
+void ax25_pool_release(ax25_pool_t *pool, ax25_packet_t *packet);
+
+int ax25_pool_refs(const ax25_packet_t *packet);
+
+void ax25_pool_cache_init(ax25_pool_cache_t *cache, ax25_pool_t *pool);
+
+ax25_packet_t *ax25_pool_cache_alloc(ax25_pool_cache_t *cache);
+
+void ax25_pool_cache_release(ax25_pool_cache_t *cache, ax25_packet_t *packet);
+
+// Returns all cached entries to the pool
+void ax25_pool_cache_flush(ax25_pool_cache_t *cache);
+
+// Allocates a packet from the cache and fills it with the decoder, NULL on exhaustion or decode failure
+ax25_packet_t *ax25_pool_decode(ax25_pool_cache_t *cache, ax25_pool_decoder_t *decoder, const buffer_t *buf);
+
+ax25_packet_t *ax25_pool_unpack(ax25_pool_cache_t *cache, const buffer_t *buf);
+
+#endif
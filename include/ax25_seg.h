@@ -0,0 +1,99 @@
+#ifndef AX25_SEG_H
+#define AX25_SEG_H
+
+#include "ax25.h"
+#include "buffer.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// AX.25 2.2 segmentation (PID 0x08). Each segment's info field starts with a header byte:
+// bit 7 marks the first segment, bits 0-6 count the segments still to follow. The first
+// segment carries the original PID after the header.
+
+#define AX25_SEG_PID 0x08
+#define AX25_SEG_FIRST 0x80
+#define AX25_SEG_MAX_SEGMENTS 128
+
+typedef enum
+{
+    AX25_SEG_SUCCESS = 0,
+    AX25_SEG_TOO_LARGE,    // Needs more than AX25_SEG_MAX_SEGMENTS, or over the reassembly limit
+    AX25_SEG_MALFORMED,    // Not a segment
+    AX25_SEG_OUT_OF_ORDER, // Segment does not continue a message in progress, which is dropped
+    AX25_SEG_BUF_TOO_SMALL,
+    AX25_SEG_NOMEM,
+} ax25_seg_error_e;
+
+typedef struct ax25_seg_iov
+{
+    const uint8_t *data;
+    int len;
+} ax25_seg_iov_t;
+
+typedef struct ax25_segmenter
+{
+    const uint8_t *data; // Caller's message, referenced until the last segment is taken
+    int len;
+    int offset;
+    int max_info;
+    int count;
+    int remaining; // Segments not yet taken
+    uint8_t pid;
+    uint8_t header[2];
+} ax25_segmenter_t;
+
+// Splits a message into segments of at most max_info bytes of info field, all full but the last.
+// Returns the number of segments or a negative error.
+int ax25_segmenter_init(ax25_segmenter_t *seg, uint8_t pid, const uint8_t *data, int len, int max_info);
+
+// Next segment's info field without copying: iov[0] is the segment header, iov[1] a slice of the
+// message. Returns the info field length, 0 when all segments were taken.
+int ax25_segmenter_next(ax25_segmenter_t *seg, ax25_seg_iov_t iov[2]);
+
+// Writes the next segment as a frame (without FCS) with the addresses and control field of
+// header. Returns the frame length, 0 when all segments were taken, or a negative error.
+int ax25_segmenter_pack(ax25_segmenter_t *seg, const ax25_packet_t *header, buffer_t *out_frame);
+
+typedef struct ax25_reasm_slot
+{
+    uint64_t source; // ax25_addr_key
+    uint64_t destination;
+    uint64_t expiry; // 0 when free
+    int remaining;   // Segments still expected
+    int len;
+    uint8_t pid;
+} ax25_reasm_slot_t;
+
+// Reassembles messages from several stations at once, in slots of max_len bytes. Memory is
+// fixed at init: when all slots are busy the message idle longest is dropped.
+typedef struct ax25_reassembler
+{
+    ax25_reasm_slot_t *slots;
+    uint8_t *data;
+    int slot_count;
+    int max_len;
+    uint32_t timeout_ms;
+} ax25_reassembler_t;
+
+typedef struct ax25_seg_message
+{
+    uint64_t source;
+    uint64_t destination;
+    uint8_t pid;
+    const uint8_t *data; // Valid until the next call on the reassembler
+    int len;
+} ax25_seg_message_t;
+
+int ax25_reassembler_init(ax25_reassembler_t *reasm, int slot_count, int max_len, uint32_t timeout_ms);
+
+void ax25_reassembler_free(ax25_reassembler_t *reasm);
+
+// Drops messages with no segment received for timeout_ms
+void ax25_reassembler_expire(ax25_reassembler_t *reasm, uint64_t now_ms);
+
+// Feeds a PID 0x08 packet. Returns 1 with out_message filled when a message is complete,
+// 0 when more segments are needed, or a negative error.
+int ax25_reassembler_process(ax25_reassembler_t *reasm, const ax25_packet_t *packet, uint64_t now_ms,
+                             ax25_seg_message_t *out_message);
+
+#endif
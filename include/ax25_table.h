@@ -0,0 +1,61 @@
+#ifndef AX25_TABLE_H
+#define AX25_TABLE_H
+
+#include "ax25.h"
+#include "buffer.h"
+#include <stdint.h>
+
+// Structure-of-arrays packet table, one row per frame
+typedef struct ax25_table
+{
+    int capacity;
+    int count;
+
+    uint64_t *source;
+    uint64_t *destination;
+    uint8_t *path_len;
+    uint64_t *path;         // capacity * AX25_MAX_PATH_LEN keys, unused entries are 0
+    uint8_t *path_repeated; // bit i set when path[i] has been repeated
+    uint8_t *control;
+    uint8_t *protocol;
+    uint32_t *info_offset;
+    uint16_t *info_len;
+
+    uint8_t *arena;
+    uint32_t arena_capacity;
+    uint32_t arena_size;
+} ax25_table_t;
+
+int ax25_table_init(ax25_table_t *table, int capacity, uint32_t arena_capacity);
+
+void ax25_table_free(ax25_table_t *table);
+
+void ax25_table_clear(ax25_table_t *table);
+
+// Decodes frames into new rows, skipping malformed ones; stops when the table or arena is full.
+// Returns the number of frames consumed.
+int ax25_table_unpack(ax25_table_t *table, const buffer_t *frames, int count);
+
+ax25_error_e ax25_table_get(const ax25_table_t *table, int row, ax25_packet_t *packet);
+
+static inline const uint8_t *ax25_table_info(const ax25_table_t *table, int row)
+{
+    return &table->arena[table->info_offset[row]];
+}
+
+static inline const uint64_t *ax25_table_path(const ax25_table_t *table, int row)
+{
+    return &table->path[row * AX25_MAX_PATH_LEN];
+}
+
+// Row indices in [start, end) where (column[row] & mask) == key. Returns the number of rows written.
+int ax25_table_select(const uint64_t *column, int start, int end, uint64_t key, uint64_t mask, int *out_rows, int max_rows);
+
+int ax25_table_select_source(const ax25_table_t *table, uint64_t key, uint64_t mask, int *out_rows, int max_rows);
+
+int ax25_table_select_destination(const ax25_table_t *table, uint64_t key, uint64_t mask, int *out_rows, int max_rows);
+
+// Rows having the key anywhere in their path
+int ax25_table_select_path(const ax25_table_t *table, uint64_t key, uint64_t mask, int *out_rows, int max_rows);
+
+#endif
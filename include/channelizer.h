@@ -0,0 +1,96 @@
+#ifndef CHANNELIZER_H
+#define CHANNELIZER_H
+
+#include "afsk.h"
+#include "buffer.h"
+
+// Polyphase FFT filter bank splitting complex baseband into channels evenly spaced at
+// sample_rate / channels. Channel k is centred on k * spacing, channels above channels / 2 on
+// negative offsets. Outputs are twice oversampled, at 2 * sample_rate / channels, so signals
+// near a channel edge are not aliased. Each block of channels / 2 input samples costs one
+// pass over the prototype filter and one FFT.
+//
+// IQ is interleaved float I, Q pairs (cf32), buffer sizes counting floats.
+
+#define CHANNELIZER_MIN_CHANNELS 4
+#define CHANNELIZER_MAX_CHANNELS 1024 // Power of two channels in between
+#define CHANNELIZER_TAPS 16           // Prototype taps per channel
+#define CHANNELIZER_CHUNK 1024        // Input samples per pass through the work buffers
+
+typedef enum
+{
+    CHANNELIZER_SUCCESS = 0,
+    CHANNELIZER_INVALID_CHANNELS,
+    CHANNELIZER_INVALID_RATE,
+    CHANNELIZER_BUF_TOO_SMALL,
+    CHANNELIZER_NOMEM,
+} channelizer_error_e;
+
+typedef struct channelizer
+{
+    int channels;
+    int decimation; // Input samples per output block
+
+    int taps;         // channels * CHANNELIZER_TAPS
+    float *prototype; // Lowpass at the input rate, time reversed
+    float *raw_re;    // taps - 1 samples of history, then the chunk
+    float *raw_im;
+    float *sum_re; // Prototype branch sums of one block
+    float *sum_im;
+    float *fft_re;
+    float *fft_im;
+    float *twiddle_re;
+    float *twiddle_im;
+    int *bit_reverse;
+
+    int next;   // Input sample ending the next block, relative to the chunk
+    int rotate; // Index of that sample modulo channels, the phase of the channel mixers
+} channelizer_t;
+
+int channelizer_init(channelizer_t *ch, int channels);
+
+void channelizer_free(channelizer_t *ch);
+
+// Most blocks samples (IQ pairs) can produce
+int channelizer_blocks(const channelizer_t *ch, int samples);
+
+// Filters IQ into blocks of one IQ sample per channel, replacing the contents of out_buf.
+// Returns the number of blocks or a negative error.
+int channelizer_process(channelizer_t *ch, const float_buffer_t *iq_buf, float_buffer_t *out_buf);
+
+typedef void channelizer_frame_callback_t(void *ctx, const buffer_t *frame_buf, int channel);
+
+typedef struct channelizer_channel
+{
+    struct channelizer_receiver *rx;
+    int index;
+    float last_re; // Previous sample for the FM discriminator
+    float last_im;
+    afsk_receiver_t afsk;
+} channelizer_channel_t;
+
+// AFSK over narrowband FM on every channel: filter bank, FM discriminator per channel, then
+// the AFSK demodulator and deframer
+typedef struct channelizer_receiver
+{
+    channelizer_t bank;
+    int sample_rate;
+    channelizer_channel_t *channels;
+    float *blocks; // Filter bank output for one chunk
+    float *audio;  // Discriminator output of one channel for one chunk
+
+    channelizer_frame_callback_t *callback;
+    void *ctx;
+} channelizer_receiver_t;
+
+// sample_rate must be a multiple of channels / 2, and the channel rate within the AFSK
+// demodulator's range
+int channelizer_receiver_init(channelizer_receiver_t *rx, int sample_rate, int channels, int slicers,
+                              channelizer_frame_callback_t *callback, void *ctx);
+
+void channelizer_receiver_free(channelizer_receiver_t *rx);
+
+// Returns the number of frames passed to the callback or a negative error
+int channelizer_receiver_process(channelizer_receiver_t *rx, const float_buffer_t *iq_buf);
+
+#endif
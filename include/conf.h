@@ -1,6 +1,9 @@
 #pragma once
 
 #include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
 #include "common.h"
 
 typedef enum
@@ -8,29 +11,60 @@ typedef enum
     CONF_SUCCESS = 0,
     CONF_ERR_NOT_FOUND,
     CONF_ERR_INVALID_VALUE,
-    CONF_ERR_TOO_MANY_ENTRIES,
+    CONF_ERR_NOMEM,
     CONF_ERR_FILE_NOT_FOUND,
+    CONF_ERR_TOO_MANY_READERS,
 } conf_error_e;
 
-#define CONF_KEY_SIZE 64
-#define CONF_VAL_SIZE 256
+// Longest line conf_load accepts
+#define CONF_MAX_LINE (64 * 1024)
 
+// Handle to an entry, resolved once with conf_find. Negative when the key was not found.
+typedef int conf_key_t;
+
+// Values are parsed once at load time into typed slots
 typedef struct conf_entry
 {
-    char key[CONF_KEY_SIZE];
-    char value[CONF_VAL_SIZE];
+    uint32_t key;   // Offset of the key in the string arena
+    uint32_t value; // Offset of the value
+    uint32_t hash;
+    int int_value;
+    float float_value;
+    int8_t bool_value; // -1 when the value is neither "true" nor "false"
 } conf_entry_t;
 
-#define CONF_MAX_ENTRIES 64
-
 typedef struct conf
 {
-    conf_entry_t entries[CONF_MAX_ENTRIES];
+    conf_entry_t *entries;
     int count;
+    int capacity;
+
+    int32_t *index; // Open addressing hash table of entry index + 1, 0 for empty
+    int index_mask;
+
+    char *strings; // Arena holding all keys and values, NUL terminated
+    size_t strings_len;
+    size_t strings_capacity;
 } conf_t;
 
+// Loads key = value lines, ignoring blank lines and lines starting with '#'. The first entry
+// for a key wins. conf is initialized by the call and must be released with conf_free.
 conf_error_e conf_load(conf_t *conf, const char *filename);
 
+conf_error_e conf_load_buffer(conf_t *conf, const char *data, size_t len);
+
+void conf_free(conf_t *conf);
+
+conf_key_t conf_find(const conf_t *conf, const char *key);
+
+conf_error_e conf_key_int(const conf_t *conf, conf_key_t key, int *out);
+
+conf_error_e conf_key_float(const conf_t *conf, conf_key_t key, float *out);
+
+conf_error_e conf_key_bool(const conf_t *conf, conf_key_t key, int *out);
+
+const char *conf_key_str(const conf_t *conf, conf_key_t key);
+
 conf_error_e conf_get_int(const conf_t *conf, const char *key, int *out);
 
 conf_error_e conf_get_float(const conf_t *conf, const char *key, float *out);
@@ -46,3 +80,70 @@ float conf_get_float_or_default(const conf_t *conf, const char *key, float def);
 int conf_get_bool_or_default(const conf_t *conf, const char *key, int def);
 
 const char *conf_get_str_or_default(const conf_t *conf, const char *key, const char *def);
+
+#define CONF_LIVE_MAX_READERS 64
+
+typedef struct conf_live_reader
+{
+    _Alignas(64) atomic_uint_fast64_t epoch; // Last epoch seen quiescent, UINT64_MAX when offline
+    atomic_bool used;
+} conf_live_reader_t;
+
+typedef struct conf_retired
+{
+    conf_t *conf;
+    uint64_t epoch; // Freed once every reader has been quiescent at this epoch
+    struct conf_retired *next;
+} conf_retired_t;
+
+// Live configuration that can be reloaded while other threads read it. Readers get the current
+// immutable snapshot with one atomic load. A replaced snapshot is freed once every registered
+// reader has passed a quiescent state (QSBR), so readers never lock or write shared data other
+// than their own epoch. conf_key_t handles belong to one snapshot: re-resolve them when
+// conf_live_get returns a different pointer.
+typedef struct conf_live
+{
+    _Atomic(conf_t *) current;
+    atomic_uint_fast64_t epoch;
+    atomic_int reader_count; // Slots ever used, reclamation scans these
+    conf_live_reader_t readers[CONF_LIVE_MAX_READERS];
+
+    pthread_mutex_t lock; // Serializes writers
+    conf_retired_t *retired;
+} conf_live_t;
+
+void conf_live_init(conf_live_t *live);
+
+// Frees all snapshots, no reader may be using them
+void conf_live_free(conf_live_t *live);
+
+// Registers the calling thread as a reader, online from now on. Returns the reader index or
+// a negative error.
+int conf_live_register(conf_live_t *live);
+
+// Releases the reader index for another thread, the reader no longer holds any snapshot
+void conf_live_unregister(conf_live_t *live, int reader);
+
+// Current snapshot, NULL before the first publish. Valid for the reader until its next
+// quiescent or offline call.
+static inline const conf_t *conf_live_get(conf_live_t *live)
+{
+    return atomic_load_explicit(&live->current, memory_order_acquire);
+}
+
+// Declares the reader holds no snapshot pointer, e.g. once per packet or loop iteration
+void conf_live_quiescent(conf_live_t *live, int reader);
+
+// Reader stops reading for a while, e.g. before blocking, and no longer delays reclamation
+void conf_live_offline(conf_live_t *live, int reader);
+
+void conf_live_online(conf_live_t *live, int reader);
+
+// Publishes conf as the new snapshot, taking over its contents, and retires the previous one
+conf_error_e conf_live_publish(conf_live_t *live, conf_t *conf);
+
+// Loads the file into a new snapshot and publishes it. On error the current snapshot stays.
+conf_error_e conf_live_reload(conf_live_t *live, const char *filename);
+
+// Frees retired snapshots no reader can hold. Returns the number still waiting.
+int conf_live_reclaim(conf_live_t *live);
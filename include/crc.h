@@ -48,3 +48,7 @@ void crc_ccitt_update(crc_ccitt_t *crc, uint8_t byte);
 void crc_ccitt_update_buffer(crc_ccitt_t *crc, const uint8_t *buffer, int length);
 
 uint16_t crc_ccitt_get(crc_ccitt_t *crc);
+
+// Updates the FCS of a frame after some of its bytes changed without changing its length.
+// delta holds old ^ new for the changed region, which is followed by trailing_len bytes up to the end of the frame.
+uint16_t crc_ccitt_patch(uint16_t fcs, const uint8_t *delta, int delta_len, int trailing_len);
@@ -0,0 +1,50 @@
+#ifndef DEDUPE_H
+#define DEDUPE_H
+
+#include "ax25.h"
+#include "buffer.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct dedupe_entry
+{
+    uint64_t hash;
+    uint32_t bucket_next;
+    uint32_t wheel_next;
+} dedupe_entry_t;
+
+// Fixed-size duplicate cache with timing wheel expiry
+typedef struct dedupe
+{
+    dedupe_entry_t *entries;
+    uint32_t capacity;
+    uint32_t count;
+    uint32_t free_head;
+
+    uint32_t *buckets;
+    uint32_t bucket_mask;
+
+    uint32_t *wheel;
+    uint32_t wheel_slots;
+    uint32_t resolution_ms;
+    uint64_t tick;
+} dedupe_t;
+
+// Hash of source, destination and info, ignoring the path and trailing CR/LF/spaces of the info
+uint64_t dedupe_hash_frame(const buffer_t *frame);
+
+uint64_t dedupe_hash_packet(const ax25_packet_t *packet);
+
+int dedupe_init(dedupe_t *dd, uint32_t capacity, uint32_t window_ms, uint32_t resolution_ms);
+
+void dedupe_free(dedupe_t *dd);
+
+// Expires entries older than the window
+void dedupe_advance(dedupe_t *dd, uint64_t now_ms);
+
+bool dedupe_contains(dedupe_t *dd, uint64_t hash, uint64_t now_ms);
+
+// Returns true if the hash was seen within the window, otherwise records it and returns false
+bool dedupe_check(dedupe_t *dd, uint64_t hash, uint64_t now_ms);
+
+#endif
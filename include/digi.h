@@ -0,0 +1,51 @@
+#ifndef DIGI_H
+#define DIGI_H
+
+#include "ax25.h"
+#include "buffer.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define DIGI_MAX_ALIASES 8
+
+typedef enum
+{
+    DIGI_IGNORE = 0, // Not ours to repeat, frame unchanged
+    DIGI_REPEAT,     // Frame rewritten in place, ready to transmit
+} digi_action_e;
+
+typedef enum
+{
+    DIGI_SUCCESS = 0,
+    DIGI_MALFORMED,
+    DIGI_TOO_MANY_ALIASES,
+} digi_error_e;
+
+typedef enum
+{
+    DIGI_PREEMPT_OFF = 0,
+    DIGI_PREEMPT_DROP, // Remove unused addresses ahead of ours
+    DIGI_PREEMPT_MARK, // Mark unused addresses ahead of ours as used
+} digi_preempt_e;
+
+typedef struct digi
+{
+    uint8_t mycall[AX25_ADDR_LEN]; // Wire format, SSID byte reduced to the SSID bits
+    uint8_t aliases[DIGI_MAX_ALIASES][AX25_ADDR_LEN];
+    int alias_count;
+    int wide_max_n;  // Highest n of WIDEn-N to handle, 0 disables
+    int trace_max_n; // Highest n of TRACEn-N to handle, 0 disables
+    bool trace_wide; // Insert own call for WIDEn-N as well, when the path has room
+    digi_preempt_e preempt;
+} digi_t;
+
+void digi_init(digi_t *digi, const ax25_addr_t *mycall);
+
+digi_error_e digi_add_alias(digi_t *digi, const ax25_addr_t *alias);
+
+// Applies digipeating rules to a wire-format frame (without FCS), rewriting it in place.
+// The frame grows by one address when own call is inserted, which needs spare capacity.
+// When fcs is given it is updated to match the rewritten frame.
+int digi_process(const digi_t *digi, buffer_t *frame, uint16_t *fcs);
+
+#endif
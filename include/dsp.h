@@ -0,0 +1,70 @@
+#ifndef DSP_H
+#define DSP_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Kernels shared by the modems. Coefficient arrays are 16 byte aligned and padded with zeros
+// to a multiple of 4, filter inputs may be unaligned.
+
+static inline int dsp_pad4(int n)
+{
+    return (n + 3) & ~3;
+}
+
+// Zeroed, aligned and padded storage for n floats
+static inline float *dsp_alloc_floats(int n)
+{
+    float *p = aligned_alloc(16, dsp_pad4(n) * sizeof(float));
+    if (p != NULL)
+        memset(p, 0, dsp_pad4(n) * sizeof(float));
+    return p;
+}
+
+#if defined(__SSE2__)
+
+static inline float dsp_sum4(__m128 v)
+{
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+    return _mm_cvtss_f32(v);
+}
+
+static inline float dsp_dot(const float *x, const float *h, int taps)
+{
+    __m128 acc = _mm_setzero_ps();
+    for (int k = 0; k < taps; k += 4)
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(&x[k]), _mm_load_ps(&h[k])));
+    return dsp_sum4(acc);
+}
+
+// acc[k] += x[k] * h[k], n a multiple of 4 and acc and h aligned
+static inline void dsp_mac(float *acc, const float *x, const float *h, int n)
+{
+    for (int k = 0; k < n; k += 4)
+        _mm_store_ps(&acc[k], _mm_add_ps(_mm_load_ps(&acc[k]), _mm_mul_ps(_mm_loadu_ps(&x[k]), _mm_load_ps(&h[k]))));
+}
+
+#else
+
+static inline float dsp_dot(const float *x, const float *h, int taps)
+{
+    float acc = 0;
+    for (int k = 0; k < taps; k++)
+        acc += x[k] * h[k];
+    return acc;
+}
+
+static inline void dsp_mac(float *acc, const float *x, const float *h, int n)
+{
+    for (int k = 0; k < n; k++)
+        acc[k] += x[k] * h[k];
+}
+
+#endif
+
+#endif
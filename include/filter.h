@@ -0,0 +1,118 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include "ax25.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// APRS-IS style subscription filters compiled into one shared matching structure:
+//   p/AA/BB       source callsign prefix
+//   b/CALL/CALL*  source callsign, exact or with trailing wildcard
+//   d/DIGI/DIGI*  digipeater that has repeated the packet
+//   t/poimqstunw  packet type
+//   r/lat/lon/km  position within range
+// Terms are separated by spaces; a leading '-' makes a term exclude matches.
+
+typedef enum
+{
+    FILTER_SUCCESS = 0,
+    FILTER_ERR_SYNTAX,
+    FILTER_ERR_NOMEM,
+    FILTER_ERR_NOT_FOUND,
+} filter_error_e;
+
+typedef enum
+{
+    FILTER_TYPE_POSITION = 1 << 0,
+    FILTER_TYPE_OBJECT = 1 << 1,
+    FILTER_TYPE_ITEM = 1 << 2,
+    FILTER_TYPE_MESSAGE = 1 << 3,
+    FILTER_TYPE_QUERY = 1 << 4,
+    FILTER_TYPE_STATUS = 1 << 5,
+    FILTER_TYPE_TELEMETRY = 1 << 6,
+    FILTER_TYPE_USER = 1 << 7,
+    FILTER_TYPE_WEATHER = 1 << 8,
+    FILTER_TYPE_NWS = 1 << 9,
+} filter_type_e;
+
+typedef struct filter_trie_node
+{
+    uint32_t children[37]; // A-Z, 0-9, '-'
+    uint32_t prefix_refs;
+    uint32_t exact_refs;
+} filter_trie_node_t;
+
+typedef struct filter_trie
+{
+    filter_trie_node_t *nodes;
+    uint32_t count;
+    uint32_t capacity;
+} filter_trie_t;
+
+typedef struct filter_ref
+{
+    uint32_t sub;
+    uint32_t next;
+    bool negated;
+} filter_ref_t;
+
+typedef struct filter_set
+{
+    int count; // Subscription slots, removed ones included
+    int words; // 64-bit words in a subscription bitmap
+
+    filter_trie_t source_trie;
+    filter_trie_t digi_trie;
+    filter_ref_t *refs;
+    uint32_t ref_count;
+    uint32_t ref_capacity;
+    uint32_t free_refs; // Refs of removed terms, chained through next
+
+    // Type terms
+    uint32_t *type_sub;
+    uint16_t *type_mask;
+    uint8_t *type_negated;
+    int type_count;
+    int type_capacity;
+
+    // Range terms
+    uint32_t *range_sub;
+    double *range_sin_lat;
+    double *range_cos_lat;
+    double *range_sin_lon;
+    double *range_cos_lon;
+    double *range_cos_dist;
+    uint8_t *range_negated;
+    int range_count;
+    int range_capacity;
+
+    uint64_t *positive;
+    uint64_t *negative;
+    uint8_t *active; // Per subscription slot, 64 for each bitmap word
+    int bits_capacity;
+} filter_set_t;
+
+int filter_set_init(filter_set_t *set);
+
+void filter_set_free(filter_set_t *set);
+
+// Compiles a filter string into the set, returns the subscription index or a negative error.
+// The index of a removed subscription is reused. On error the set is unchanged.
+int filter_set_add(filter_set_t *set, const char *filter);
+
+// Recompiles a subscription with a new filter, keeping its index. On error the old filter stays.
+int filter_set_replace(filter_set_t *set, int sub, const char *filter);
+
+// Removes a subscription, its terms no longer take space or match. Trie nodes of its callsigns
+// are kept for later filters.
+int filter_set_remove(filter_set_t *set, int sub);
+
+// Evaluates a packet against all subscriptions at once. out_bits receives set->words words,
+// bit i set when subscription i matches. Returns the number of matching subscriptions.
+int filter_set_match(filter_set_t *set, const ax25_packet_t *packet, uint64_t *out_bits);
+
+int filter_packet_type(const ax25_packet_t *packet);
+
+bool filter_packet_position(const ax25_packet_t *packet, double *lat, double *lon);
+
+#endif
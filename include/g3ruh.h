@@ -0,0 +1,99 @@
+#ifndef G3RUH_H
+#define G3RUH_H
+
+#include "buffer.h"
+#include <stdint.h>
+
+// G3RUH 9600 baud: baseband pulses scrambled with the self-synchronizing polynomial
+// x^17 + x^12 + 1. On transmit the NRZI bits of hldc_framer_process are scrambled then
+// modulated; on receive demodulated bits are descrambled before hldc_deframer_process.
+//
+// The scrambler works on 64 bits at a time, packed into words with the earliest bit in bit 0.
+
+#define G3RUH_BAUD 9600
+#define G3RUH_MIN_RATE (4 * G3RUH_BAUD)
+#define G3RUH_MAX_RATE 192000
+
+typedef enum
+{
+    G3RUH_SUCCESS = 0,
+    G3RUH_INVALID_RATE,
+    G3RUH_BUF_TOO_SMALL,
+    G3RUH_NOMEM,
+} g3ruh_error_e;
+
+// Scrambler or descrambler state, the last 64 line bits with the latest in bit 63
+typedef struct g3ruh_scrambler
+{
+    uint64_t history;
+} g3ruh_scrambler_t;
+
+void g3ruh_scrambler_init(g3ruh_scrambler_t *scr);
+
+// Scrambles the first n (1 to 64) bits of data
+uint64_t g3ruh_scramble(g3ruh_scrambler_t *scr, uint64_t data, int n);
+
+uint64_t g3ruh_descramble(g3ruh_scrambler_t *scr, uint64_t line, int n);
+
+// Same on bits stored one per byte, as used by the framer and deframer. in_buf and out_buf may
+// be the same buffer.
+int g3ruh_scramble_bits(g3ruh_scrambler_t *scr, const buffer_t *in_buf, buffer_t *out_buf);
+
+int g3ruh_descramble_bits(g3ruh_scrambler_t *scr, const buffer_t *in_buf, buffer_t *out_buf);
+
+// Raised cosine pulse span and resolution of the modulator's shared pulse table
+#define G3RUH_PULSE_SPAN 6
+#define G3RUH_PULSE_PHASES 64
+
+typedef struct g3ruh_modulator
+{
+    int sample_rate;
+    float amplitude;
+    float symbols[G3RUH_PULSE_SPAN]; // Latest last, output lags input by half the span
+    int bit_phase;                   // As for afsk_modulator_t, in 1/(G3RUH_BAUD * sample_rate) s
+} g3ruh_modulator_t;
+
+int g3ruh_modulator_init(g3ruh_modulator_t *mod, int sample_rate, float amplitude);
+
+int g3ruh_modulator_samples(const g3ruh_modulator_t *mod, int bits);
+
+// Modulates line bits (one per byte) into out_buf, replacing its contents. Returns the number
+// of samples or a negative error.
+int g3ruh_modulator_process(g3ruh_modulator_t *mod, const buffer_t *bits_buf, float_buffer_t *out_buf);
+
+// Samples filtered per pass through the demodulator's work buffers
+#define G3RUH_DEMOD_CHUNK 256
+
+// Matched lowpass FIR, DC removal and AGC, then a PLL sampling the sign once per bit
+typedef struct g3ruh_demodulator
+{
+    int sample_rate;
+
+    int taps;        // Lowpass length, padded to a multiple of 4
+    float *lowpass;  // Coefficients, time reversed
+    float *raw;      // taps - 1 samples of history, then the chunk
+
+    float dc;
+    float level;
+    float dc_rate;
+    float agc_attack;
+    float agc_decay;
+    float last;
+
+    uint32_t pll;
+    uint32_t pll_step;
+    float pll_inertia;
+} g3ruh_demodulator_t;
+
+int g3ruh_demodulator_init(g3ruh_demodulator_t *demod, int sample_rate);
+
+void g3ruh_demodulator_free(g3ruh_demodulator_t *demod);
+
+// Most bits samples can produce, for sizing output buffers
+int g3ruh_demodulator_bits(const g3ruh_demodulator_t *demod, int samples);
+
+// Demodulates a block of audio into line bits (one per byte) for g3ruh_descramble_bits,
+// replacing the contents of out_bits_buf. Returns the number of bits or a negative error.
+int g3ruh_demodulator_process(g3ruh_demodulator_t *demod, const float_buffer_t *audio_buf, buffer_t *out_bits_buf);
+
+#endif
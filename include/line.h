@@ -3,21 +3,48 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include "buffer.h"
 
 #define READ_BUF_SIZE 2048
+#define LINE_READER_BATCH 64
 
-typedef void line_callback_t(const buffer_t *line_buf);
+typedef void line_callback_t(void *ctx, const buffer_t *line_buf);
+
+// Receives the lines of one block, valid only during the call
+typedef void line_batch_callback_t(void *ctx, const buffer_t *lines, int count);
 
 typedef struct line_reader
 {
     char buf[READ_BUF_SIZE];
+    uint8_t *arena; // Replaces buf once a fragment outgrows it, up to max_line
+    size_t arena_capacity;
+    size_t max_line;
     size_t buf_pos;
     line_callback_t *line_callback;
+    line_batch_callback_t *batch_callback;
+    void *ctx;
     bool invalid;
+    uint64_t dropped; // Lines over max_line
 
+    buffer_t batch[LINE_READER_BATCH];
+    int batch_count;
 } line_reader_t;
 
-void line_reader_init(line_reader_t *lr, line_callback_t *line_callback);
+void line_reader_init(line_reader_t *lr, line_callback_t *line_callback, void *ctx);
+
+// Delivers the lines of a block in batches of up to LINE_READER_BATCH instead of one call per line
+void line_reader_init_batch(line_reader_t *lr, line_batch_callback_t *batch_callback, void *ctx);
+
+// Keeps lines of up to max_line bytes (default READ_BUF_SIZE). Fragments longer than
+// READ_BUF_SIZE that span blocks are stored on the heap, grown as needed. A stored fragment
+// longer than a lowered max_line is dropped.
+void line_reader_set_max_line(line_reader_t *lr, size_t max_line);
+
+void line_reader_free(line_reader_t *lr);
 
 void line_reader_process(line_reader_t *lr, char ch);
+
+// Processes a block of input. Lines complete within data are passed to the callback as views
+// into data; only a line that continues in the next block is copied.
+void line_reader_process_buffer(line_reader_t *lr, const uint8_t *data, size_t len);
@@ -1,5 +1,11 @@
 #pragma once
 
+#include <stdint.h>
+
+#if defined(__PCLMUL__)
+#include <wmmintrin.h>
+#endif
+
 static inline void nrzi_encoder_init(int *nrzi_bit)
 {
     *nrzi_bit = 0;
@@ -24,3 +30,45 @@ static inline int nrzi_decode(int b, int *last_bit)
     *last_bit = b;
     return output_bit;
 }
+
+// Packed variants on the first n (1 to 64) bits of a word, the earliest bit in bit 0. State
+// carries across words and is shared with the single bit functions. Bits above n are zero.
+
+static inline uint64_t nrzi_word_mask(int n)
+{
+    return n == 64 ? ~0ULL : (1ULL << n) - 1;
+}
+
+// XOR of each bit with all earlier bits
+static inline uint64_t nrzi_prefix_xor(uint64_t x)
+{
+#if defined(__PCLMUL__)
+    __m128i p = _mm_clmulepi64_si128(_mm_cvtsi64_si128((long long)x), _mm_set1_epi64x(-1), 0);
+    return (uint64_t)_mm_cvtsi128_si64(p);
+#else
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+#endif
+}
+
+static inline uint64_t nrzi_encode_word(uint64_t bits, int n, int *nrzi_bit)
+{
+    // Each 0 toggles the level
+    uint64_t levels = nrzi_prefix_xor(~bits) ^ (*nrzi_bit ? ~0ULL : 0);
+    levels &= nrzi_word_mask(n);
+    *nrzi_bit = (levels >> (n - 1)) & 1;
+    return levels;
+}
+
+static inline uint64_t nrzi_decode_word(uint64_t levels, int n, int *last_bit)
+{
+    levels &= nrzi_word_mask(n);
+    uint64_t bits = ~(levels ^ (levels << 1 | (uint64_t)(*last_bit & 1)));
+    *last_bit = (levels >> (n - 1)) & 1;
+    return bits & nrzi_word_mask(n);
+}
@@ -0,0 +1,48 @@
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include "buffer.h"
+
+// Polyphase FIR resampler for rational rate changes, e.g. a 44.1 kHz sound card to a small
+// multiple of the baud rate ahead of a demodulator. The rate ratio is reduced to up/down and a
+// lowpass designed at in_rate * up is split into up phases of equal length.
+
+#define RESAMPLER_MAX_PHASES 1024 // Largest up after reducing the ratio
+#define RESAMPLER_TAPS 32         // Taps per phase per unit of decimation
+#define RESAMPLER_CHUNK 256       // Input samples per pass through the work buffer
+
+typedef enum
+{
+    RESAMPLER_SUCCESS = 0,
+    RESAMPLER_INVALID_RATE,
+    RESAMPLER_BUF_TOO_SMALL,
+    RESAMPLER_NOMEM,
+} resampler_error_e;
+
+typedef struct resampler
+{
+    int in_rate;
+    int out_rate;
+    int up;
+    int down;
+
+    int taps;    // Per phase, padded to a multiple of 4
+    float *bank; // up phases of taps coefficients, each time reversed
+    float *raw;  // taps - 1 samples of history, then the chunk
+
+    int phase; // Of the next output, 0 to up - 1
+    int next;  // Input sample ending the next output, relative to the chunk
+} resampler_t;
+
+int resampler_init(resampler_t *rs, int in_rate, int out_rate);
+
+void resampler_free(resampler_t *rs);
+
+// Most outputs in_samples can produce, for sizing output buffers
+int resampler_samples(const resampler_t *rs, int in_samples);
+
+// Resamples a block into out_buf, replacing its contents. Filter state carries over to the next
+// block. Returns the number of samples or a negative error.
+int resampler_process(resampler_t *rs, const float_buffer_t *in_buf, float_buffer_t *out_buf);
+
+#endif
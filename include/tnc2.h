@@ -1,8 +1,10 @@
 #ifndef TNC2_H
 #define TNC2_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include "ax25.h"
+#include "ax25_pool.h"
 #include "buffer.h"
 
 // Convert AX25 address to TNC2 string format
@@ -11,10 +13,50 @@ int tnc2_addr_to_string(const ax25_addr_t *addr, buffer_t *out_buf);
 // Convert TNC2 address string to AX25 address
 int tnc2_string_to_addr(ax25_addr_t *addr, const buffer_t *buf);
 
+// Length of the TNC2 string of a packet, without terminator, or -1 if it cannot be formatted
+int tnc2_packet_string_len(const ax25_packet_t *packet);
+
 // Convert AX25 packet to TNC2 string format
 int tnc2_packet_to_string(const ax25_packet_t *packet, buffer_t *out_buf);
 
+// Appends packets as newline-terminated TNC2 lines after out_buf->size. Returns the number of
+// packets appended, stopping at the first that does not fit or cannot be formatted.
+int tnc2_packets_to_lines(const ax25_packet_t *const *packets, int count, buffer_t *out_buf);
+
 // Convert TNC2 packet string to AX25 packet
 int tnc2_string_to_packet(ax25_packet_t *packet, const buffer_t *buf);
 
+// Convert TNC2 packet string to a packet allocated from a pool cache, NULL on failure
+ax25_packet_t *tnc2_string_to_pool_packet(ax25_pool_cache_t *cache, const buffer_t *buf);
+
+// APRS-IS lines as views into the caller's buffer. Path entries need not be AX.25 addresses
+// (TCPIP*, q-constructs, long server names) and may exceed AX25_MAX_PATH_LEN.
+#define TNC2_VIEW_MAX_PATH 32
+
+typedef struct tnc2_span
+{
+    const uint8_t *data;
+    int len;
+} tnc2_span_t;
+
+typedef struct tnc2_view
+{
+    tnc2_span_t header; // Up to, not including, the ':'
+    tnc2_span_t source;
+    tnc2_span_t destination;
+    tnc2_span_t path[TNC2_VIEW_MAX_PATH];
+    int path_len;
+    int q_index;             // Path index of the q-construct, -1 if none
+    tnc2_span_t q_construct; // qAC, qAR...
+    tnc2_span_t q_gate;      // Path entry after the q-construct, empty if none
+    tnc2_span_t info;
+    bool third_party;  // Info starts with '}'
+    tnc2_span_t inner; // Encapsulated packet line, after the '}'
+} tnc2_view_t;
+
+// Splits a line into spans without copying, returns 0 or -1 when the header is malformed
+int tnc2_view_parse(tnc2_view_t *view, const uint8_t *data, int len);
+
+bool tnc2_span_equal(const tnc2_span_t *span, const char *str);
+
 #endif
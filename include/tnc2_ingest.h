@@ -0,0 +1,47 @@
+#ifndef TNC2_INGEST_H
+#define TNC2_INGEST_H
+
+#include "ax25.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Bulk parsing of TNC2 logs, one packet per line. The input is cut into newline-aligned chunks
+// that worker threads parse into their own packet arenas.
+
+typedef enum
+{
+    TNC2_INGEST_SUCCESS = 0,
+    TNC2_INGEST_IO,
+    TNC2_INGEST_NOMEM,
+} tnc2_ingest_error_e;
+
+typedef struct tnc2_ingest_config
+{
+    int threads;       // Worker threads, 0 for one per online CPU
+    size_t chunk_size; // Bytes of input per chunk
+    bool ordered;      // Deliver chunks in input order
+} tnc2_ingest_config_t;
+
+typedef struct tnc2_ingest_stats
+{
+    uint64_t lines; // Non-empty lines
+    uint64_t packets;
+    uint64_t errors; // Lines that did not parse
+} tnc2_ingest_stats_t;
+
+// Receives the packets of one chunk, valid only during the call. In ordered mode calls are made
+// one at a time in input order, otherwise concurrently from all workers. worker is the index of
+// the calling thread, for per-thread state in the sink.
+typedef void tnc2_ingest_sink_t(void *ctx, int worker, uint64_t chunk, const ax25_packet_t *packets, int count);
+
+void tnc2_ingest_config_init(tnc2_ingest_config_t *config);
+
+int tnc2_ingest_buffer(const uint8_t *data, size_t len, const tnc2_ingest_config_t *config,
+                       tnc2_ingest_sink_t *sink, void *ctx, tnc2_ingest_stats_t *out_stats);
+
+// Maps the file into memory and ingests it like tnc2_ingest_buffer
+int tnc2_ingest_file(const char *path, const tnc2_ingest_config_t *config,
+                     tnc2_ingest_sink_t *sink, void *ctx, tnc2_ingest_stats_t *out_stats);
+
+#endif
@@ -0,0 +1,428 @@
+#include "afsk.h"
+#include "common.h"
+#include <math.h>
+#include <pthread.h>
+#include "dsp.h"
+#include <stdbool.h>
+#include <string.h>
+
+#define AFSK_TABLE_SHIFT (32 - AFSK_TABLE_BITS)
+
+#define AFSK_BP_LOW_HZ 800
+#define AFSK_BP_HIGH_HZ 2600
+#define AFSK_BP_BITS 1.5f       // Bandpass length in bits
+#define AFSK_AGC_DECAY_S 0.25f  // Envelope decay time constant
+#define AFSK_PLL_INERTIA 0.75f
+
+static float afsk_sine[AFSK_TABLE_SIZE];
+static pthread_once_t afsk_sine_once = PTHREAD_ONCE_INIT;
+
+static void afsk_sine_init(void)
+{
+    for (int i = 0; i < AFSK_TABLE_SIZE; i++)
+        afsk_sine[i] = sin(2 * M_PI * i / AFSK_TABLE_SIZE);
+}
+
+static uint32_t afsk_step(double hz, int sample_rate)
+{
+    return (uint32_t)llround(hz / sample_rate * 4294967296.0);
+}
+
+int afsk_modulator_init(afsk_modulator_t *mod, int sample_rate, float amplitude)
+{
+    nonnull(mod, "mod");
+
+    if (sample_rate < AFSK_MIN_RATE || sample_rate > AFSK_MAX_RATE)
+        return -AFSK_INVALID_RATE;
+
+    pthread_once(&afsk_sine_once, afsk_sine_init);
+
+    mod->sample_rate = sample_rate;
+    mod->amplitude = amplitude;
+    mod->phase = 0;
+    mod->mark_step = afsk_step(AFSK_MARK_HZ, sample_rate);
+    mod->space_step = afsk_step(AFSK_SPACE_HZ, sample_rate);
+    mod->bit_phase = 0;
+
+    return 0;
+}
+
+int afsk_modulator_samples(const afsk_modulator_t *mod, int bits)
+{
+    nonnull(mod, "mod");
+    nonnegative(bits, "bits");
+
+    // Samples advance the bit clock by AFSK_BAUD, bits last sample_rate. Each bit ends at the
+    // first sample past its end, so the total only depends on where the first bit starts.
+    int64_t end = (int64_t)bits * mod->sample_rate;
+    if (end <= mod->bit_phase)
+        return 0;
+    int64_t samples = (end - mod->bit_phase + AFSK_BAUD - 1) / AFSK_BAUD;
+    return samples > INT32_MAX ? INT32_MAX : (int)samples;
+}
+
+// Samples for the bit starting at bit_phase, and advances bit_phase into the next bit
+static int afsk_bit_samples(afsk_modulator_t *mod)
+{
+    int n = (mod->sample_rate - mod->bit_phase + AFSK_BAUD - 1) / AFSK_BAUD;
+    mod->bit_phase += n * AFSK_BAUD - mod->sample_rate;
+    return n;
+}
+
+int afsk_modulator_process(afsk_modulator_t *mod, const buffer_t *bits_buf, float_buffer_t *out_buf)
+{
+    nonnull(mod, "mod");
+    assert_buffer_valid(bits_buf);
+    assert_buffer_valid(out_buf);
+
+    int total = afsk_modulator_samples(mod, bits_buf->size);
+    if (total > out_buf->capacity)
+        return -AFSK_BUF_TOO_SMALL;
+
+    float *out = out_buf->data;
+    uint32_t phase = mod->phase;
+    float amplitude = mod->amplitude;
+    for (int i = 0; i < bits_buf->size; i++)
+    {
+        uint32_t step = bits_buf->data[i] ? mod->mark_step : mod->space_step;
+        int n = afsk_bit_samples(mod);
+        for (int j = 0; j < n; j++)
+        {
+            out[j] = amplitude * afsk_sine[phase >> AFSK_TABLE_SHIFT];
+            phase += step;
+        }
+        out += n;
+    }
+    mod->phase = phase;
+
+    out_buf->size = total;
+    return total;
+}
+
+int afsk_modulator_process_s16(afsk_modulator_t *mod, const buffer_t *bits_buf, int16_t *out, int capacity)
+{
+    nonnull(mod, "mod");
+    assert_buffer_valid(bits_buf);
+    nonnull(out, "out");
+
+    int total = afsk_modulator_samples(mod, bits_buf->size);
+    if (total > capacity)
+        return -AFSK_BUF_TOO_SMALL;
+
+    uint32_t phase = mod->phase;
+    float scale = min(max(mod->amplitude, -1.0f), 1.0f) * INT16_MAX;
+    for (int i = 0; i < bits_buf->size; i++)
+    {
+        uint32_t step = bits_buf->data[i] ? mod->mark_step : mod->space_step;
+        int n = afsk_bit_samples(mod);
+        for (int j = 0; j < n; j++)
+        {
+            out[j] = (int16_t)(scale * afsk_sine[phase >> AFSK_TABLE_SHIFT]);
+            phase += step;
+        }
+        out += n;
+    }
+    mod->phase = phase;
+
+    return total;
+}
+
+// Bandpass taps in time reversed order, zero padded at the oldest end
+static void afsk_bandpass(float *out, int taps, int padded, int sample_rate)
+{
+    float f1 = (float)AFSK_BP_LOW_HZ / sample_rate;
+    float f2 = (float)AFSK_BP_HIGH_HZ / sample_rate;
+    float center = (taps - 1) / 2.0f;
+    for (int k = 0; k < taps; k++)
+    {
+        float t = k - center;
+        float window = 0.54f - 0.46f * cosf(2 * M_PI * k / (taps - 1));
+        float h = t == 0 ? 2 * (f2 - f1) : (sinf(2 * M_PI * f2 * t) - sinf(2 * M_PI * f1 * t)) / (M_PI * t);
+        out[padded - 1 - k] = window * h;
+    }
+}
+
+int afsk_demodulator_init(afsk_demodulator_t *demod, int sample_rate)
+{
+    return afsk_demodulator_init_slicers(demod, sample_rate, 1);
+}
+
+int afsk_demodulator_init_slicers(afsk_demodulator_t *demod, int sample_rate, int slicers)
+{
+    nonnull(demod, "demod");
+    _assert(slicers >= 1 && slicers <= AFSK_MAX_SLICERS, "1 <= slicers <= AFSK_MAX_SLICERS");
+
+    if (sample_rate < AFSK_MIN_RATE || sample_rate > AFSK_MAX_RATE)
+        return -AFSK_INVALID_RATE;
+
+    memset(demod, 0, sizeof(*demod));
+    demod->sample_rate = sample_rate;
+
+    float samples_per_bit = (float)sample_rate / AFSK_BAUD;
+    int bp_taps = (int)(samples_per_bit * AFSK_BP_BITS) | 1;
+    int corr_taps = lrintf(samples_per_bit);
+    demod->bp_taps = dsp_pad4(bp_taps);
+    demod->corr_taps = dsp_pad4(corr_taps);
+
+    demod->bp = dsp_alloc_floats(demod->bp_taps);
+    demod->corr = dsp_alloc_floats(4 * demod->corr_taps);
+    demod->raw = dsp_alloc_floats(demod->bp_taps - 1 + AFSK_DEMOD_CHUNK);
+    demod->filtered = dsp_alloc_floats(demod->corr_taps - 1 + AFSK_DEMOD_CHUNK);
+    if (!demod->bp || !demod->corr || !demod->raw || !demod->filtered)
+    {
+        afsk_demodulator_free(demod);
+        return -AFSK_NOMEM;
+    }
+
+    afsk_bandpass(demod->bp, bp_taps, demod->bp_taps, sample_rate);
+
+    // Quadrature references of both tones over the last bit, newest sample last
+    for (int k = 0; k < corr_taps; k++)
+    {
+        int i = demod->corr_taps - 1 - k;
+        float mark = 2 * M_PI * AFSK_MARK_HZ * k / sample_rate;
+        float space = 2 * M_PI * AFSK_SPACE_HZ * k / sample_rate;
+        demod->corr[i] = cosf(mark);
+        demod->corr[demod->corr_taps + i] = sinf(mark);
+        demod->corr[2 * demod->corr_taps + i] = cosf(space);
+        demod->corr[3 * demod->corr_taps + i] = sinf(space);
+    }
+
+    demod->agc_attack = 0.5f;
+    demod->agc_decay = 1.0f / (sample_rate * AFSK_AGC_DECAY_S);
+    demod->pll_step = afsk_step(AFSK_BAUD, sample_rate);
+    demod->pll_inertia = AFSK_PLL_INERTIA;
+
+    demod->slicer_count = slicers;
+    for (int i = 0; i < slicers; i++)
+    {
+        float db = slicers == 1 ? 0 : AFSK_SLICER_SPAN_DB * (2.0f * i / (slicers - 1) - 1);
+        demod->slicers[i].space_gain = powf(10, db / 20);
+    }
+
+    return 0;
+}
+
+void afsk_demodulator_free(afsk_demodulator_t *demod)
+{
+    nonnull(demod, "demod");
+
+    free(demod->bp);
+    free(demod->corr);
+    free(demod->raw);
+    free(demod->filtered);
+    demod->bp = demod->corr = demod->raw = demod->filtered = NULL;
+}
+
+int afsk_demodulator_bits(const afsk_demodulator_t *demod, int samples)
+{
+    nonnull(demod, "demod");
+    nonnegative(samples, "samples");
+
+    // Transitions pull the bit clock forward, so bits can come as often as every half bit
+    return (int)((int64_t)2 * samples * AFSK_BAUD / demod->sample_rate) + 2;
+}
+
+#if defined(__SSE2__)
+
+// Mark and space amplitudes of the bit ending at x[taps - 1]
+static inline void afsk_correlate(const float *x, const float *corr, int taps, float *out_mark, float *out_space)
+{
+    __m128 mc = _mm_setzero_ps(), ms = _mm_setzero_ps(), sc = _mm_setzero_ps(), ss = _mm_setzero_ps();
+    for (int k = 0; k < taps; k += 4)
+    {
+        __m128 v = _mm_loadu_ps(&x[k]);
+        mc = _mm_add_ps(mc, _mm_mul_ps(v, _mm_load_ps(&corr[k])));
+        ms = _mm_add_ps(ms, _mm_mul_ps(v, _mm_load_ps(&corr[taps + k])));
+        sc = _mm_add_ps(sc, _mm_mul_ps(v, _mm_load_ps(&corr[2 * taps + k])));
+        ss = _mm_add_ps(ss, _mm_mul_ps(v, _mm_load_ps(&corr[3 * taps + k])));
+    }
+    float i = dsp_sum4(mc), q = dsp_sum4(ms);
+    *out_mark = sqrtf(i * i + q * q);
+    i = dsp_sum4(sc), q = dsp_sum4(ss);
+    *out_space = sqrtf(i * i + q * q);
+}
+
+#else
+
+static inline void afsk_correlate(const float *x, const float *corr, int taps, float *out_mark, float *out_space)
+{
+    float mc = 0, ms = 0, sc = 0, ss = 0;
+    for (int k = 0; k < taps; k++)
+    {
+        mc += x[k] * corr[k];
+        ms += x[k] * corr[taps + k];
+        sc += x[k] * corr[2 * taps + k];
+        ss += x[k] * corr[3 * taps + k];
+    }
+    *out_mark = sqrtf(mc * mc + ms * ms);
+    *out_space = sqrtf(sc * sc + ss * ss);
+}
+
+#endif
+
+int afsk_demodulator_process_slicers(afsk_demodulator_t *demod, const float_buffer_t *audio_buf, buffer_t *out_bits_bufs)
+{
+    nonnull(demod, "demod");
+    assert_buffer_valid(audio_buf);
+    nonnull(out_bits_bufs, "out_bits_bufs");
+
+    int max_bits = afsk_demodulator_bits(demod, audio_buf->size);
+    for (int s = 0; s < demod->slicer_count; s++)
+    {
+        assert_buffer_valid(&out_bits_bufs[s]);
+        if (max_bits > out_bits_bufs[s].capacity)
+            return -AFSK_BUF_TOO_SMALL;
+        out_bits_bufs[s].size = 0;
+    }
+
+    int bp_hist = demod->bp_taps - 1;
+    int corr_hist = demod->corr_taps - 1;
+    float *raw = demod->raw;
+    float *filtered = demod->filtered;
+    float level = demod->level;
+
+    for (int pos = 0; pos < audio_buf->size; pos += AFSK_DEMOD_CHUNK)
+    {
+        int n = min(AFSK_DEMOD_CHUNK, audio_buf->size - pos);
+        memcpy(&raw[bp_hist], &audio_buf->data[pos], n * sizeof(float));
+
+        for (int i = 0; i < n; i++)
+            filtered[corr_hist + i] = dsp_dot(&raw[i], demod->bp, demod->bp_taps);
+
+        for (int i = 0; i < n; i++)
+        {
+            float mark, space;
+            afsk_correlate(&filtered[i], demod->corr, demod->corr_taps, &mark, &space);
+
+            float amplitude = max(mark, space);
+            level += (amplitude - level) * (amplitude > level ? demod->agc_attack : demod->agc_decay);
+            float scale = 1 / (level + 1e-9f);
+
+            for (int s = 0; s < demod->slicer_count; s++)
+            {
+                afsk_slicer_t *slicer = &demod->slicers[s];
+                float d = (mark - slicer->space_gain * space) * scale;
+
+                // Data transitions pull the bit clock towards the middle of the bit
+                uint32_t pll = slicer->pll;
+                if ((d > 0) != (slicer->last > 0))
+                    pll = (uint32_t)(int32_t)((int32_t)pll * demod->pll_inertia);
+                slicer->last = d;
+
+                uint32_t next = pll + demod->pll_step;
+                if ((int32_t)pll >= 0 && (int32_t)next < 0)
+                    out_bits_bufs[s].data[out_bits_bufs[s].size++] = d > 0;
+                slicer->pll = next;
+            }
+        }
+
+        memmove(raw, &raw[n], bp_hist * sizeof(float));
+        memmove(filtered, &filtered[n], corr_hist * sizeof(float));
+    }
+
+    demod->level = level;
+    return out_bits_bufs[0].size;
+}
+
+int afsk_demodulator_process(afsk_demodulator_t *demod, const float_buffer_t *audio_buf, buffer_t *out_bits_buf)
+{
+    nonnull(demod, "demod");
+    _assert(demod->slicer_count == 1, "single slicer");
+
+    return afsk_demodulator_process_slicers(demod, audio_buf, out_bits_buf);
+}
+
+int afsk_receiver_init(afsk_receiver_t *rx, int sample_rate, int slicers, afsk_frame_callback_t *callback, void *ctx)
+{
+    nonnull(rx, "rx");
+    nonnull(callback, "callback");
+
+    memset(rx, 0, sizeof(*rx));
+    int ret = afsk_demodulator_init_slicers(&rx->demod, sample_rate, slicers);
+    if (ret < 0)
+        return ret;
+
+    rx->bits_capacity = afsk_demodulator_bits(&rx->demod, AFSK_DEMOD_CHUNK);
+    rx->bits = malloc((size_t)slicers * rx->bits_capacity);
+    if (rx->bits == NULL)
+    {
+        afsk_demodulator_free(&rx->demod);
+        return -AFSK_NOMEM;
+    }
+
+    for (int s = 0; s < slicers; s++)
+        hldc_deframer_init(&rx->deframers[s]);
+    rx->callback = callback;
+    rx->ctx = ctx;
+
+    return 0;
+}
+
+void afsk_receiver_free(afsk_receiver_t *rx)
+{
+    nonnull(rx, "rx");
+
+    afsk_demodulator_free(&rx->demod);
+    free(rx->bits);
+    rx->bits = NULL;
+}
+
+// Whether another slicer decoded the frame just now, otherwise remembers it
+static bool afsk_receiver_duplicate(afsk_receiver_t *rx, uint16_t fcs, uint64_t sample)
+{
+    uint64_t window = (uint64_t)AFSK_DUPLICATE_BITS * rx->demod.sample_rate / AFSK_BAUD;
+    for (int i = 0; i < AFSK_RECENT_FRAMES; i++)
+    {
+        const afsk_recent_frame_t *recent = &rx->recent[i];
+        uint64_t apart = sample > recent->sample ? sample - recent->sample : recent->sample - sample;
+        if (recent->sample != 0 && recent->fcs == fcs && apart <= window)
+            return true;
+    }
+
+    rx->recent[rx->recent_next] = (afsk_recent_frame_t){.fcs = fcs, .sample = sample};
+    rx->recent_next = (rx->recent_next + 1) % AFSK_RECENT_FRAMES;
+    return false;
+}
+
+int afsk_receiver_process(afsk_receiver_t *rx, const float_buffer_t *audio_buf)
+{
+    nonnull(rx, "rx");
+    assert_buffer_valid(audio_buf);
+
+    int slicers = rx->demod.slicer_count;
+    buffer_t bits[AFSK_MAX_SLICERS];
+    uint8_t frame[sizeof(rx->deframers[0].bytes)];
+    int delivered = 0;
+
+    for (int pos = 0; pos < audio_buf->size; pos += AFSK_DEMOD_CHUNK)
+    {
+        int n = min(AFSK_DEMOD_CHUNK, audio_buf->size - pos);
+        float_buffer_t chunk = {.data = &audio_buf->data[pos], .capacity = n, .size = n};
+        for (int s = 0; s < slicers; s++)
+            bits[s] = (buffer_t){.data = &rx->bits[s * rx->bits_capacity], .capacity = rx->bits_capacity, .size = 0};
+        afsk_demodulator_process_slicers(&rx->demod, &chunk, bits);
+
+        for (int s = 0; s < slicers; s++)
+            for (int i = 0; i < bits[s].size; i++)
+            {
+                buffer_t frame_buf = {.data = frame, .capacity = sizeof(frame), .size = 0};
+                uint16_t fcs;
+                hldc_deframer_process(&rx->deframers[s], bits[s].data[i], &frame_buf, &fcs);
+                if (frame_buf.size == 0)
+                    continue;
+
+                rx->decoded[s]++;
+                // Samples are counted from 1 so 0 marks an unused recent entry
+                uint64_t sample = rx->samples + 1 + (uint64_t)i * n / max(bits[s].size, 1);
+                if (afsk_receiver_duplicate(rx, fcs, sample))
+                    continue;
+                rx->callback(rx->ctx, &frame_buf, s);
+                delivered++;
+            }
+
+        rx->samples += n;
+    }
+
+    return delivered;
+}
@@ -2,6 +2,118 @@
 #include "common.h"
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define AX25_ADDR_BLOCK_LEN (AX25_MAX_ADDR_COUNT * AX25_ADDR_LEN)
+#define AX25_ADDR_BLOCK_PADDED_LEN 80
+
+// Bits at the SSID byte offsets (6, 13, ..., 69) of the address block
+#define AX25_ADDR_EXT_MASK_LO 0x4081020408102040ULL
+#define AX25_ADDR_EXT_MASK_HI 0x0020ULL
+
+static inline void ax25_addr_decode(ax25_addr_t *addr, const uint8_t *callsign, uint8_t ssid_byte)
+{
+    memcpy(addr->callsign, callsign, AX25_ADDR_MAX_CALLSIGN_LEN);
+    addr->repeated = (ssid_byte >> 7) & 1;
+    addr->ssid = (ssid_byte >> 1) & 0x0f;
+    addr->last = ssid_byte & 1;
+}
+
+static inline uint8_t ax25_addr_ssid_byte(const ax25_addr_t *addr, bool last)
+{
+    return 0b01100000 | (addr->repeated << 7) | ((addr->ssid & 0x0f) << 1) | last;
+}
+
+// Loads up to AX25_MAX_ADDR_COUNT addresses into a zero-padded block so that
+// whole-block vector loads never read past the caller's buffer
+static inline void ax25_addr_block_load(uint8_t *block, const uint8_t *data, int count)
+{
+    memset(block, 0, AX25_ADDR_BLOCK_PADDED_LEN);
+    memcpy(block, data, count * AX25_ADDR_LEN);
+}
+
+#if defined(__SSE2__)
+
+static inline int ax25_addr_block_last_index(const uint8_t *block)
+{
+    uint64_t lo = 0, hi = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(block + 16 * i));
+        lo |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_slli_epi16(v, 7)) << (16 * i);
+    }
+    __m128i v = _mm_loadu_si128((const __m128i *)(block + 64));
+    hi = (uint16_t)_mm_movemask_epi8(_mm_slli_epi16(v, 7));
+
+    // The destination's extension bit is not an end-of-address marker
+    lo &= AX25_ADDR_EXT_MASK_LO & ~(1ULL << (AX25_ADDR_LEN - 1));
+    hi &= AX25_ADDR_EXT_MASK_HI;
+
+    int bit;
+    if (lo)
+        bit = __builtin_ctzll(lo);
+    else if (hi)
+        bit = 64 + __builtin_ctzll(hi);
+    else
+        return -1;
+    return bit / AX25_ADDR_LEN;
+}
+
+static inline void ax25_addr_block_shift_right(uint8_t *block)
+{
+    const __m128i mask = _mm_set1_epi8(0x7f);
+    for (int i = 0; i < AX25_ADDR_BLOCK_PADDED_LEN; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(block + i));
+        _mm_storeu_si128((__m128i *)(block + i), _mm_and_si128(_mm_srli_epi16(v, 1), mask));
+    }
+}
+
+static inline void ax25_addr_block_shift_left(uint8_t *block)
+{
+    for (int i = 0; i < AX25_ADDR_BLOCK_PADDED_LEN; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(block + i));
+        _mm_storeu_si128((__m128i *)(block + i), _mm_add_epi8(v, v));
+    }
+}
+
+#else
+
+static inline int ax25_addr_block_last_index(const uint8_t *block)
+{
+    for (int i = 1; i < AX25_MAX_ADDR_COUNT; i++)
+        if (block[i * AX25_ADDR_LEN + AX25_ADDR_LEN - 1] & 1)
+            return i;
+    return -1;
+}
+
+static inline void ax25_addr_block_shift_right(uint8_t *block)
+{
+    for (int i = 0; i < AX25_ADDR_BLOCK_PADDED_LEN; i += 8)
+    {
+        uint64_t w;
+        memcpy(&w, block + i, 8);
+        w = (w >> 1) & 0x7f7f7f7f7f7f7f7fULL;
+        memcpy(block + i, &w, 8);
+    }
+}
+
+static inline void ax25_addr_block_shift_left(uint8_t *block)
+{
+    for (int i = 0; i < AX25_ADDR_BLOCK_PADDED_LEN; i += 8)
+    {
+        uint64_t w;
+        memcpy(&w, block + i, 8);
+        w = (w << 1) & 0xfefefefefefefefeULL;
+        memcpy(block + i, &w, 8);
+    }
+}
+
+#endif
+
 void ax25_addr_init(ax25_addr_t *addr)
 {
     nonnull(addr, "addr");
@@ -56,17 +168,75 @@ ax25_error_e ax25_addr_unpack(ax25_addr_t *addr, const buffer_t *buf)
     if (!buf_has_size_ge(buf, AX25_ADDR_LEN))
         return -AX25_ADDR_BUF_TOO_SMALL;
 
+    char callsign[AX25_ADDR_MAX_CALLSIGN_LEN];
     for (int i = 0; i < AX25_ADDR_MAX_CALLSIGN_LEN; i++)
-        addr->callsign[i] = (buf->data[i] >> 1) & 0x7f;
+        callsign[i] = (buf->data[i] >> 1) & 0x7f;
 
-    addr->repeated = (buf->data[AX25_ADDR_MAX_CALLSIGN_LEN] >> 7) & 1;
-    addr->ssid = (buf->data[AX25_ADDR_MAX_CALLSIGN_LEN] >> 1) & 0x0f;
-    addr->last = buf->data[AX25_ADDR_MAX_CALLSIGN_LEN] & 1;
+    ax25_addr_decode(addr, (const uint8_t *)callsign, buf->data[AX25_ADDR_MAX_CALLSIGN_LEN]);
 
     return AX25_SUCCESS;
 }
 
-void ax25_packet_init(ax25_packet_t *packet)
+int ax25_addr_count(const buffer_t *buf)
+{
+    assert_buffer_valid(buf);
+
+    int available = min(buf->size / AX25_ADDR_LEN, AX25_MAX_ADDR_COUNT);
+    if (available < 2)
+        return -AX25_BUF_TOO_SMALL;
+
+    uint8_t block[AX25_ADDR_BLOCK_PADDED_LEN];
+    ax25_addr_block_load(block, buf->data, available);
+
+    int last = ax25_addr_block_last_index(block);
+    return last < 0 ? available : last + 1;
+}
+
+uint64_t ax25_addr_key(const ax25_addr_t *addr)
+{
+    nonnull(addr, "addr");
+
+    uint64_t key = 0;
+    for (int i = 0; i < AX25_ADDR_MAX_CALLSIGN_LEN; i++)
+        key = (key << 7) | (addr->callsign[i] & 0x7f);
+    return (key << 4) | (addr->ssid & 0x0f);
+}
+
+uint64_t ax25_addr_key_wire(const uint8_t *data)
+{
+    nonnull(data, "data");
+
+    uint64_t key = 0;
+    for (int i = 0; i < AX25_ADDR_MAX_CALLSIGN_LEN; i++)
+        key = (key << 7) | ((data[i] >> 1) & 0x7f);
+    return (key << 4) | ((data[AX25_ADDR_MAX_CALLSIGN_LEN] >> 1) & 0x0f);
+}
+
+void ax25_addr_from_key(ax25_addr_t *addr, uint64_t key)
+{
+    nonnull(addr, "addr");
+
+    addr->ssid = key & 0x0f;
+    key >>= 4;
+    for (int i = AX25_ADDR_MAX_CALLSIGN_LEN - 1; i >= 0; i--, key >>= 7)
+        addr->callsign[i] = key & 0x7f;
+    addr->repeated = false;
+    addr->last = false;
+}
+
+void ax25_packet_init(ax25_packet_t *packet, uint8_t *info, int info_capacity)
+{
+    nonnull(packet, "packet");
+    nonnegative(info_capacity, "info_capacity");
+    _assert(info_capacity <= UINT16_MAX, "info_capacity <= UINT16_MAX");
+    _assert(info != NULL || info_capacity == 0, "info storage provided");
+
+    packet->info = info;
+    packet->info_capacity = info_capacity;
+    ax25_packet_reset(packet);
+}
+
+void ax25_packet_reset(ax25_packet_t *packet)
 {
     nonnull(packet, "packet");
 
@@ -85,104 +255,118 @@ int ax25_packet_len(const ax25_packet_t *packet)
            + packet->info_len;
 }
 
-ax25_error_e ax25_packet_pack(const ax25_packet_t *packet, buffer_t *out_buf)
+int ax25_packet_pack_header(const ax25_packet_t *packet, buffer_t *out_buf)
 {
     nonnull(packet, "packet");
     assert_buffer_valid(out_buf);
 
-    if (out_buf->capacity < ax25_packet_len(packet))
+    if (packet->path_len > AX25_MAX_PATH_LEN)
+        return -AX25_ADDR_PACK_FAILED;
+
+    int count = 2 + packet->path_len;
+    if (out_buf->capacity < count * AX25_ADDR_LEN)
         return -AX25_BUF_TOO_SMALL;
 
-    out_buf->size = 0;
+    const ax25_addr_t *addrs[AX25_MAX_ADDR_COUNT];
+    addrs[0] = &packet->destination;
+    addrs[1] = &packet->source;
+    for (int i = 0; i < packet->path_len; i++)
+        addrs[2 + i] = &packet->path[i];
 
-    buffer_t addr_buf = {
-        .data = &out_buf->data[out_buf->size],
-        .capacity = out_buf->capacity - out_buf->size,
-        .size = 0};
-    if (ax25_addr_pack(&packet->destination, &addr_buf))
-        return -AX25_ADDR_PACK_FAILED;
-    out_buf->size += addr_buf.size;
+    uint8_t block[AX25_ADDR_BLOCK_PADDED_LEN];
+    memset(block, 0, sizeof(block));
+    for (int i = 0; i < count; i++)
+        memcpy(&block[i * AX25_ADDR_LEN], addrs[i]->callsign, AX25_ADDR_MAX_CALLSIGN_LEN);
 
-    addr_buf.data = &out_buf->data[out_buf->size];
-    addr_buf.capacity = out_buf->capacity - out_buf->size;
+    ax25_addr_block_shift_left(block);
 
-    ((ax25_packet_t *)packet)->source.last = packet->path_len == 0;
-    if (ax25_addr_pack(&packet->source, &addr_buf))
-        return -AX25_ADDR_PACK_FAILED;
-    out_buf->size += addr_buf.size;
+    for (int i = 0; i < count; i++)
+        block[i * AX25_ADDR_LEN + AX25_ADDR_MAX_CALLSIGN_LEN] = ax25_addr_ssid_byte(addrs[i], i == count - 1);
 
-    for (int i = 0; i < packet->path_len; i++)
-    {
-        addr_buf.data = &out_buf->data[out_buf->size];
-        addr_buf.capacity = out_buf->capacity - out_buf->size;
+    out_buf->size = count * AX25_ADDR_LEN;
+    memcpy(out_buf->data, block, out_buf->size);
 
-        ((ax25_packet_t *)packet)->path[i].last = (packet->path_len - 1) == i;
-        if (ax25_addr_pack(&packet->path[i], &addr_buf))
-            return -AX25_ADDR_PACK_FAILED;
-        out_buf->size += addr_buf.size;
-    }
+    return out_buf->size;
+}
+
+ax25_error_e ax25_packet_pack(const ax25_packet_t *packet, buffer_t *out_buf)
+{
+    nonnull(packet, "packet");
+    assert_buffer_valid(out_buf);
+
+    if (out_buf->capacity < ax25_packet_len(packet))
+        return -AX25_BUF_TOO_SMALL;
+    if (packet->info_len > packet->info_capacity)
+        return -AX25_INFO_TOO_LARGE;
+
+    int ret = ax25_packet_pack_header(packet, out_buf);
+    if (ret < 0)
+        return ret;
 
     out_buf->data[out_buf->size++] = packet->control;
     out_buf->data[out_buf->size++] = packet->protocol;
 
-    memcpy(&out_buf->data[out_buf->size], packet->info, packet->info_len);
+    if (packet->info_len > 0)
+        memcpy(&out_buf->data[out_buf->size], packet->info, packet->info_len);
     out_buf->size += packet->info_len;
 
     return AX25_SUCCESS;
 }
 
-ax25_error_e ax25_packet_unpack(ax25_packet_t *packet, const buffer_t *buf)
+int ax25_packet_unpack_header(ax25_packet_t *packet, const buffer_t *buf)
 {
     nonnull(packet, "packet");
     assert_buffer_valid(buf);
 
-    if (!buf_has_size_ge(buf, AX25_MIN_PACKET_LEN))
+    int count = ax25_addr_count(buf);
+    if (count < 2)
         return -1;
 
-    int buffer_pos = 0;
-
-    buffer_t addr_buf = {
-        .data = &buf->data[buffer_pos],
-        .capacity = buf->size - buffer_pos,
-        .size = AX25_ADDR_LEN};
-    if (ax25_addr_unpack(&packet->destination, &addr_buf))
+    int buffer_pos = count * AX25_ADDR_LEN;
+    if (!buf_has_size_ge(buf, buffer_pos + AX25_CONTROL_LEN))
         return -1;
-    buffer_pos += addr_buf.size;
 
-    addr_buf.data = &buf->data[buffer_pos];
-    addr_buf.capacity = buf->size - buffer_pos;
-    if (ax25_addr_unpack(&packet->source, &addr_buf))
-        return -1;
-    buffer_pos += addr_buf.size;
+    uint8_t block[AX25_ADDR_BLOCK_PADDED_LEN];
+    ax25_addr_block_load(block, buf->data, count);
+    ax25_addr_block_shift_right(block);
 
-    packet->path_len = 0;
-    ax25_addr_t address;
-    bool is_last = packet->source.last;
-    while (!is_last && packet->path_len < AX25_MAX_PATH_LEN && buf_has_size_ge(buf, buffer_pos + AX25_ADDR_LEN))
-    {
-        addr_buf.data = &buf->data[buffer_pos];
-        addr_buf.capacity = buf->size - buffer_pos;
-        if (ax25_addr_unpack(&address, &addr_buf))
-            return -1;
-        buffer_pos += addr_buf.size;
-
-        packet->path[packet->path_len++] = address;
-        is_last = address.last;
-    }
+    const uint8_t *ssid_bytes = &buf->data[AX25_ADDR_MAX_CALLSIGN_LEN];
+    ax25_addr_decode(&packet->destination, &block[0], ssid_bytes[0]);
+    ax25_addr_decode(&packet->source, &block[AX25_ADDR_LEN], ssid_bytes[AX25_ADDR_LEN]);
+
+    packet->path_len = count - 2;
+    for (int i = 0; i < packet->path_len; i++)
+        ax25_addr_decode(&packet->path[i], &block[(2 + i) * AX25_ADDR_LEN], ssid_bytes[(2 + i) * AX25_ADDR_LEN]);
+
+    return buffer_pos;
+}
+
+ax25_error_e ax25_packet_unpack(ax25_packet_t *packet, const buffer_t *buf)
+{
+    nonnull(packet, "packet");
+    assert_buffer_valid(buf);
 
+    if (!buf_has_size_ge(buf, AX25_MIN_PACKET_LEN))
+        return -1;
+
+    int buffer_pos = ax25_packet_unpack_header(packet, buf);
+    if (buffer_pos < 0)
+        return -1;
     if (!buf_has_size_ge(buf, buffer_pos + 2)) // Will allow control & protocol fields
         return -1;
 
     packet->control = buf->data[buffer_pos++];
     packet->protocol = buf->data[buffer_pos++];
 
-    packet->info_len = buf->size - buffer_pos;
-    if (packet->info_len > AX25_MAX_INFO_LEN)
+    int info_len = buf->size - buffer_pos;
+    if (info_len > packet->info_capacity)
     {
-        LOG("excessive information field length %d (max %d), limiting to max", packet->info_len, AX25_MAX_INFO_LEN);
-        packet->info_len = AX25_MAX_INFO_LEN;
+        LOGV("information field length %d exceeds capacity %d", info_len, packet->info_capacity);
+        return -AX25_INFO_TOO_LARGE;
     }
-    memcpy(packet->info, &buf->data[buffer_pos], packet->info_len);
+    packet->info_len = info_len;
+    if (info_len > 0)
+        memcpy(packet->info, &buf->data[buffer_pos], info_len);
 
     return AX25_SUCCESS;
 }
@@ -0,0 +1,1095 @@
+#include "ax25_link.h"
+#include "common.h"
+#include <string.h>
+
+#define AX25_LINK_PF 0x10
+
+// U frame control fields with the P/F bit clear
+#define AX25_LINK_SABME 0x6f
+#define AX25_LINK_SABM 0x2f
+#define AX25_LINK_DISC 0x43
+#define AX25_LINK_DM 0x0f
+#define AX25_LINK_UA 0x63
+#define AX25_LINK_FRMR 0x87
+#define AX25_LINK_XID 0xaf
+
+// S frame types
+#define AX25_LINK_RR 0
+#define AX25_LINK_RNR 1
+#define AX25_LINK_REJ 2
+#define AX25_LINK_SREJ 3
+
+#define AX25_LINK_PID_NONE 0xf0
+#define AX25_LINK_PACLEN_STEP 16
+
+// XID information field
+#define AX25_LINK_XID_FI 0x82
+#define AX25_LINK_XID_GI 0x80
+#define AX25_LINK_XID_CLASSES 2
+#define AX25_LINK_XID_FUNCTIONS 3
+#define AX25_LINK_XID_IFIELD_RX 6
+#define AX25_LINK_XID_WINDOW_RX 8
+#define AX25_LINK_XID_T1 9
+#define AX25_LINK_XID_RETRIES 10
+#define AX25_LINK_XID_MAX_LEN 32
+
+#define AX25_LINK_CLASS_ABM_HALF_DUPLEX 0x2100
+#define AX25_LINK_FUNC_REJ 0x020000
+#define AX25_LINK_FUNC_SREJ 0x040000
+#define AX25_LINK_FUNC_MODULO8 0x000400
+#define AX25_LINK_FUNC_MODULO128 0x000800
+
+typedef struct ax25_link_params
+{
+    int modulus;
+    bool srej;
+    int window;
+    int paclen;
+} ax25_link_params_t;
+
+static inline int ax25_link_seq(const ax25_link_t *link, uint32_t abs)
+{
+    return (abs - link->seq_base) % link->modulus;
+}
+
+static inline uint8_t *ax25_link_tx_slot(const ax25_link_t *link, uint32_t abs)
+{
+    return &link->tx_data[(abs % AX25_LINK_SLOTS) * link->config.paclen];
+}
+
+static inline uint8_t *ax25_link_rx_slot(const ax25_link_t *link, int seq)
+{
+    return &link->rx_data[seq * link->config.paclen];
+}
+
+static bool ax25_link_addr_equal(const ax25_addr_t *a, const ax25_addr_t *b)
+{
+    return memcmp(a->callsign, b->callsign, AX25_ADDR_MAX_CALLSIGN_LEN) == 0 && a->ssid == b->ssid;
+}
+
+static void ax25_link_emit(ax25_link_t *link, ax25_link_event_e event)
+{
+    if (link->event != NULL)
+        link->event(link->ctx, event);
+}
+
+static void ax25_link_output(ax25_link_t *link, bool command, const uint8_t *control, int control_len,
+                             bool pid, const uint8_t *info, int info_len)
+{
+    ax25_packet_t header;
+    ax25_packet_init(&header, NULL, 0);
+    header.destination = link->remote;
+    header.destination.repeated = command; // C bits
+    header.source = link->local;
+    header.source.repeated = !command;
+    header.path_len = link->path_len;
+    memcpy(header.path, link->path, link->path_len * sizeof(ax25_addr_t));
+
+    buffer_t out = {.data = link->frame, .capacity = link->frame_capacity, .size = 0};
+    int ret = ax25_packet_pack_header(&header, &out);
+    _assert(ret >= 0, "link header fits the frame scratch");
+
+    memcpy(&out.data[out.size], control, control_len);
+    out.size += control_len;
+    if (pid)
+        out.data[out.size++] = AX25_LINK_PID_NONE;
+    if (info_len > 0)
+        memcpy(&out.data[out.size], info, info_len);
+    out.size += info_len;
+
+    // T1 waits for the frame to leave
+    if (link->config.tx_complete)
+    {
+        link->tx_busy = true;
+        if (link->t1_expiry)
+        {
+            link->t1_expiry = 0;
+            link->t1_deferred = true;
+        }
+    }
+    link->output(link->ctx, &out);
+}
+
+static void ax25_link_send_u(ax25_link_t *link, bool command, uint8_t type, bool pf, const uint8_t *info, int info_len)
+{
+    uint8_t control = type | (pf ? AX25_LINK_PF : 0);
+    ax25_link_output(link, command, &control, 1, false, info, info_len);
+}
+
+static void ax25_link_send_s(ax25_link_t *link, bool command, int type, int nr, bool pf)
+{
+    uint8_t control[2];
+    int control_len;
+    if (link->modulus == 128)
+    {
+        control[0] = 0x01 | type << 2;
+        control[1] = nr << 1 | pf;
+        control_len = 2;
+    }
+    else
+    {
+        control[0] = 0x01 | type << 2 | pf << 4 | nr << 5;
+        control_len = 1;
+    }
+    ax25_link_output(link, command, control, control_len, false, NULL, 0);
+
+    if (type != AX25_LINK_SREJ)
+    {
+        link->ack_pending = false;
+        link->t2_expiry = 0;
+    }
+}
+
+static void ax25_link_send_i(ax25_link_t *link, uint32_t abs, bool p)
+{
+    int ns = ax25_link_seq(link, abs);
+    uint8_t control[2];
+    int control_len;
+    if (link->modulus == 128)
+    {
+        control[0] = ns << 1;
+        control[1] = link->vr << 1 | p;
+        control_len = 2;
+    }
+    else
+    {
+        control[0] = link->vr << 5 | p << 4 | ns << 1;
+        control_len = 1;
+    }
+    ax25_link_output(link, true, control, control_len, true, ax25_link_tx_slot(link, abs), link->tx_len[abs % AX25_LINK_SLOTS]);
+
+    link->ack_pending = false;
+    link->t2_expiry = 0;
+}
+
+static inline void ax25_link_start_t1(ax25_link_t *link, uint64_t now_ms)
+{
+    link->t1_deferred = link->tx_busy;
+    link->t1_expiry = link->tx_busy ? 0 : now_ms + link->t1_ms;
+}
+
+static inline void ax25_link_stop_t1(ax25_link_t *link)
+{
+    link->t1_expiry = 0;
+    link->t1_deferred = false;
+}
+
+static void ax25_link_enquiry(ax25_link_t *link, uint64_t now_ms)
+{
+    ax25_link_send_s(link, true, link->own_busy ? AX25_LINK_RNR : AX25_LINK_RR, link->vr, true);
+    ax25_link_start_t1(link, now_ms);
+}
+
+static void ax25_link_enquiry_response(ax25_link_t *link, bool f)
+{
+    ax25_link_send_s(link, false, link->own_busy ? AX25_LINK_RNR : AX25_LINK_RR, link->vr, f);
+}
+
+static uint8_t *ax25_link_xid_param(uint8_t *p, int pi, int pl, uint32_t pv)
+{
+    *p++ = pi;
+    *p++ = pl;
+    for (int i = pl - 1; i >= 0; i--)
+        *p++ = pv >> (8 * i);
+    return p;
+}
+
+static int ax25_link_xid_encode(const ax25_link_t *link, uint8_t *out)
+{
+    uint32_t functions = AX25_LINK_FUNC_REJ | (link->srej ? AX25_LINK_FUNC_SREJ : 0) |
+                         (link->modulus == 128 ? AX25_LINK_FUNC_MODULO128 : AX25_LINK_FUNC_MODULO8);
+
+    uint8_t *p = &out[4];
+    p = ax25_link_xid_param(p, AX25_LINK_XID_CLASSES, 2, AX25_LINK_CLASS_ABM_HALF_DUPLEX);
+    p = ax25_link_xid_param(p, AX25_LINK_XID_FUNCTIONS, 3, functions);
+    p = ax25_link_xid_param(p, AX25_LINK_XID_IFIELD_RX, 2, link->paclen_max * 8);
+    p = ax25_link_xid_param(p, AX25_LINK_XID_WINDOW_RX, 1, link->window);
+    p = ax25_link_xid_param(p, AX25_LINK_XID_T1, 2, min(link->t1_ms, UINT16_MAX));
+    p = ax25_link_xid_param(p, AX25_LINK_XID_RETRIES, 1, link->config.retries);
+
+    int group_len = p - &out[4];
+    out[0] = AX25_LINK_XID_FI;
+    out[1] = AX25_LINK_XID_GI;
+    out[2] = group_len >> 8;
+    out[3] = group_len;
+    return group_len + 4;
+}
+
+// Parameters absent from the XID keep the values already in params
+static bool ax25_link_xid_decode(const uint8_t *data, int len, ax25_link_params_t *params)
+{
+    if (len < 4 || data[0] != AX25_LINK_XID_FI || data[1] != AX25_LINK_XID_GI)
+        return false;
+
+    int group_len = data[2] << 8 | data[3];
+    if (group_len > len - 4)
+        return false;
+
+    const uint8_t *p = &data[4];
+    const uint8_t *end = p + group_len;
+    while (p + 2 <= end)
+    {
+        int pi = p[0];
+        int pl = p[1];
+        p += 2;
+        if (pl > 4 || p + pl > end)
+            return false;
+
+        uint32_t pv = 0;
+        for (int i = 0; i < pl; i++)
+            pv = pv << 8 | p[i];
+        p += pl;
+
+        switch (pi)
+        {
+        case AX25_LINK_XID_FUNCTIONS:
+            params->modulus = (pv & AX25_LINK_FUNC_MODULO128) ? 128 : 8;
+            params->srej = (pv & AX25_LINK_FUNC_SREJ) != 0;
+            break;
+        case AX25_LINK_XID_IFIELD_RX:
+            params->paclen = pv / 8;
+            break;
+        case AX25_LINK_XID_WINDOW_RX:
+            params->window = pv;
+            break;
+        }
+    }
+    return true;
+}
+
+// Selective reject needs the window within half the sequence space to tell retransmissions from new frames
+static inline int ax25_link_max_window(const ax25_link_t *link)
+{
+    return link->srej ? link->modulus / 2 : link->modulus - 1;
+}
+
+// Retransmission timeout from the smoothed round trip time and its variation
+static uint32_t ax25_link_rto(const ax25_link_t *link)
+{
+    uint32_t rto = (link->srtt >> 3) + link->rttvar;
+    return min(max(rto, link->config.t1_min_ms), link->config.t1_max_ms);
+}
+
+static void ax25_link_rtt_sample(ax25_link_t *link, uint64_t rtt_ms)
+{
+    int rtt = min(rtt_ms, (uint64_t)link->config.t1_max_ms);
+    if (link->srtt == 0)
+    {
+        link->srtt = max(rtt, 1) << 3;
+        link->rttvar = rtt << 1;
+    }
+    else
+    {
+        int delta = rtt - (link->srtt >> 3);
+        link->srtt = max(link->srtt + delta, 8);
+        link->rttvar += abs(delta) - (link->rttvar >> 2);
+    }
+    link->t1_ms = ax25_link_rto(link);
+}
+
+// Frame loss shrinks paclen, at most once per window of frames in flight. A T1 expiry alone is
+// not taken as loss, the round trip may just have been underestimated.
+static void ax25_link_loss(ax25_link_t *link)
+{
+    if (!link->config.adaptive)
+        return;
+
+    link->clean_acked = 0;
+    if ((int32_t)(link->tx_head - link->paclen_recover) >= 0)
+    {
+        link->paclen = max(link->config.paclen_min, link->paclen * 3 / 4);
+        link->paclen_recover = link->tx_sent;
+    }
+}
+
+static void ax25_link_defaults(ax25_link_t *link)
+{
+    link->modulus = link->config.modulo128 ? 128 : 8;
+    link->srej = link->config.srej;
+    link->window = min(link->config.window, ax25_link_max_window(link));
+    link->paclen_max = link->config.paclen;
+    link->paclen = link->paclen_max;
+    link->negotiated = false;
+    link->t1_ms = (link->config.adaptive && link->srtt) ? ax25_link_rto(link) : link->config.t1_ms;
+}
+
+static void ax25_link_negotiate(ax25_link_t *link, const uint8_t *xid, int xid_len)
+{
+    ax25_link_params_t peer = {
+        .modulus = link->modulus,
+        .srej = link->srej,
+        .window = link->window,
+        .paclen = link->paclen,
+    };
+    if (!ax25_link_xid_decode(xid, xid_len, &peer))
+        return;
+
+    link->modulus = (link->config.modulo128 && peer.modulus == 128) ? 128 : 8;
+    link->srej = link->config.srej && peer.srej;
+    link->window = max(1, min(min(link->config.window, peer.window), ax25_link_max_window(link)));
+    link->paclen_max = max(1, min(link->config.paclen, peer.paclen));
+    link->paclen = link->paclen_max;
+    link->negotiated = true;
+}
+
+static void ax25_link_send_xid(ax25_link_t *link, bool command, bool pf)
+{
+    uint8_t xid[AX25_LINK_XID_MAX_LEN];
+    int len = ax25_link_xid_encode(link, xid);
+    ax25_link_send_u(link, command, AX25_LINK_XID, pf, xid, len);
+}
+
+static void ax25_link_clear_exceptions(ax25_link_t *link)
+{
+    link->clean_acked = 0;
+    link->peer_busy = false;
+    link->reject_sent = false;
+    link->ack_pending = false;
+    memset(link->rx_have, 0, sizeof(link->rx_have));
+    memset(link->srej_sent, 0, sizeof(link->srej_sent));
+}
+
+// Starts sequence numbering afresh, keeping unacknowledged frames to be sent again
+static void ax25_link_reset_sequence(ax25_link_t *link)
+{
+    link->seq_base = link->tx_head;
+    link->tx_next = link->tx_head;
+    link->tx_sent = link->tx_head;
+    link->tx_stamp = link->tx_head;
+    link->paclen_recover = link->tx_head;
+    link->vr = 0;
+    link->rc = 0;
+    ax25_link_clear_exceptions(link);
+}
+
+static void ax25_link_establish(ax25_link_t *link, uint64_t now_ms)
+{
+    ax25_link_clear_exceptions(link);
+    link->rc = 0;
+    ax25_link_send_u(link, true, link->modulus == 128 ? AX25_LINK_SABME : AX25_LINK_SABM, true, NULL, 0);
+    link->state = AX25_LINK_AWAITING_CONNECTION;
+    link->t2_expiry = 0;
+    link->t3_expiry = 0;
+    ax25_link_start_t1(link, now_ms);
+}
+
+static void ax25_link_connected(ax25_link_t *link)
+{
+    ax25_link_reset_sequence(link);
+    link->state = AX25_LINK_CONNECTED;
+    ax25_link_stop_t1(link);
+}
+
+static void ax25_link_disconnected(ax25_link_t *link, ax25_link_event_e event)
+{
+    link->state = AX25_LINK_DISCONNECTED;
+    ax25_link_stop_t1(link);
+    link->t2_expiry = 0;
+    link->t3_expiry = 0;
+    ax25_link_reset_sequence(link);
+    ax25_link_defaults(link);
+    ax25_link_emit(link, event);
+}
+
+static void ax25_link_nr_error(ax25_link_t *link, uint64_t now_ms)
+{
+    LOGV("invalid N(R), re-establishing link");
+    ax25_link_reset_sequence(link);
+    ax25_link_establish(link, now_ms);
+    ax25_link_emit(link, AX25_LINK_EVENT_RESET);
+}
+
+// N(R) must acknowledge a frame between V(A) and the newest frame sent
+static bool ax25_link_nr_valid(const ax25_link_t *link, int nr)
+{
+    uint32_t acked = (nr - ax25_link_seq(link, link->tx_head) + link->modulus) % link->modulus;
+    return acked <= link->tx_sent - link->tx_head;
+}
+
+// Advances V(A) to N(R), returns true if any frame was newly acknowledged
+static bool ax25_link_ack(ax25_link_t *link, int nr, uint64_t now_ms)
+{
+    uint32_t acked = (nr - ax25_link_seq(link, link->tx_head) + link->modulus) % link->modulus;
+
+    // Timed from the newest frame acknowledged, unless any frame covered was sent again: the
+    // acknowledgement may then have waited for the resend. Answers to our polls are not timed.
+    bool timed = acked > 0 && link->config.adaptive && link->state == AX25_LINK_CONNECTED;
+    for (uint32_t i = 0; timed && i < acked; i++)
+        timed = !link->tx_resent[(link->tx_head + i) % AX25_LINK_SLOTS];
+
+    link->tx_head += acked;
+    if ((int32_t)(link->tx_next - link->tx_head) < 0)
+        link->tx_next = link->tx_head;
+    if (timed)
+        ax25_link_rtt_sample(link, now_ms - link->tx_time[(link->tx_head - 1) % AX25_LINK_SLOTS]);
+
+    if (link->config.adaptive)
+    {
+        link->clean_acked += acked;
+        if (link->clean_acked >= link->window && link->paclen < link->paclen_max)
+        {
+            link->paclen = min(link->paclen + AX25_LINK_PACLEN_STEP, link->paclen_max);
+            link->clean_acked = 0;
+        }
+    }
+    return acked > 0;
+}
+
+static void ax25_link_check_acked(ax25_link_t *link, int nr, uint64_t now_ms)
+{
+    if (ax25_link_ack(link, nr, now_ms) && link->tx_head != link->tx_sent)
+        ax25_link_start_t1(link, now_ms);
+}
+
+static void ax25_link_deliver(ax25_link_t *link, const uint8_t *data, int len)
+{
+    if (link->receive != NULL)
+        link->receive(link->ctx, data, len);
+}
+
+static void ax25_link_on_i(ax25_link_t *link, int ns, int nr, bool p, const uint8_t *info, int len, uint64_t now_ms)
+{
+    if (!ax25_link_nr_valid(link, nr))
+    {
+        ax25_link_nr_error(link, now_ms);
+        return;
+    }
+    if (link->state == AX25_LINK_CONNECTED)
+        ax25_link_check_acked(link, nr, now_ms);
+    else
+        ax25_link_ack(link, nr, now_ms);
+
+    if (link->own_busy)
+    {
+        if (p)
+            ax25_link_enquiry_response(link, true);
+        return;
+    }
+
+    int m = link->modulus;
+    if (ns == link->vr)
+    {
+        link->rx_have[ns] = false;
+        link->srej_sent[ns] = false;
+        link->reject_sent = false;
+        link->vr = (link->vr + 1) % m;
+        ax25_link_deliver(link, info, len);
+
+        while (link->rx_have[link->vr])
+        {
+            int vr = link->vr;
+            link->rx_have[vr] = false;
+            link->srej_sent[vr] = false;
+            link->vr = (vr + 1) % m;
+            ax25_link_deliver(link, ax25_link_rx_slot(link, vr), link->rx_len[vr]);
+        }
+
+        if (p)
+            ax25_link_enquiry_response(link, true);
+        else
+            link->ack_pending = true;
+        return;
+    }
+
+    int ahead = (ns - link->vr + m) % m;
+    if (ahead >= link->window)
+    {
+        // Already delivered, the peer missed our acknowledgement
+        if (p)
+            ax25_link_enquiry_response(link, true);
+        else
+            link->ack_pending = true;
+        return;
+    }
+
+    if (link->srej && len <= link->config.paclen)
+    {
+        memcpy(ax25_link_rx_slot(link, ns), info, len);
+        link->rx_len[ns] = len;
+        link->rx_have[ns] = true;
+        link->srej_sent[ns] = false;
+
+        for (int seq = link->vr; seq != ns; seq = (seq + 1) % m)
+            if (!link->rx_have[seq] && !link->srej_sent[seq])
+            {
+                ax25_link_send_s(link, false, AX25_LINK_SREJ, seq, false);
+                link->srej_sent[seq] = true;
+            }
+        if (p)
+            ax25_link_enquiry_response(link, true);
+    }
+    else if (!link->reject_sent)
+    {
+        ax25_link_send_s(link, false, AX25_LINK_REJ, link->vr, p);
+        link->reject_sent = true;
+    }
+    else if (p)
+        ax25_link_enquiry_response(link, true);
+}
+
+static void ax25_link_retransmit(ax25_link_t *link, int seq, uint64_t now_ms)
+{
+    uint32_t offset = (seq - ax25_link_seq(link, link->tx_head) + link->modulus) % link->modulus;
+    if (offset >= link->tx_sent - link->tx_head)
+        return;
+
+    uint32_t abs = link->tx_head + offset;
+    link->tx_resent[abs % AX25_LINK_SLOTS] = true;
+    ax25_link_send_i(link, abs, false);
+    ax25_link_start_t1(link, now_ms);
+}
+
+static void ax25_link_on_s(ax25_link_t *link, int type, bool command, int nr, bool pf, uint64_t now_ms)
+{
+    link->peer_busy = type == AX25_LINK_RNR;
+    if (command && pf)
+        ax25_link_enquiry_response(link, true);
+
+    if (type == AX25_LINK_SREJ)
+    {
+        ax25_link_loss(link);
+        ax25_link_retransmit(link, nr, now_ms);
+        return;
+    }
+    if (!ax25_link_nr_valid(link, nr))
+    {
+        ax25_link_nr_error(link, now_ms);
+        return;
+    }
+
+    if (link->state == AX25_LINK_TIMER_RECOVERY)
+    {
+        ax25_link_ack(link, nr, now_ms);
+        if (!command && pf)
+        {
+            // Answer to our enquiry: the frame the peer expects next was lost. With selective
+            // reject the peer asks for any other gap itself, otherwise all after it go again.
+            if (link->config.adaptive)
+                link->t1_ms = link->srtt ? ax25_link_rto(link) : link->config.t1_ms;
+            ax25_link_stop_t1(link);
+            link->rc = 0;
+            link->state = AX25_LINK_CONNECTED;
+            if (link->tx_head != link->tx_sent)
+            {
+                ax25_link_loss(link);
+                if (link->srej)
+                    ax25_link_retransmit(link, nr, now_ms);
+                else
+                    link->tx_next = link->tx_head;
+            }
+        }
+        return;
+    }
+
+    if (type == AX25_LINK_REJ)
+    {
+        ax25_link_ack(link, nr, now_ms);
+        ax25_link_loss(link);
+        ax25_link_stop_t1(link);
+        link->tx_next = link->tx_head;
+    }
+    else
+        ax25_link_check_acked(link, nr, now_ms);
+}
+
+static void ax25_link_on_u(ax25_link_t *link, bool command, uint8_t type, bool pf, const uint8_t *info, int len, uint64_t now_ms)
+{
+    ax25_link_state_e state = link->state;
+    switch (type)
+    {
+    case AX25_LINK_SABM:
+    case AX25_LINK_SABME:
+        if (!command)
+            return;
+        if (type == AX25_LINK_SABME && !link->config.modulo128)
+        {
+            ax25_link_send_u(link, false, AX25_LINK_FRMR, pf, NULL, 0); // As a version 2.0 station would
+            return;
+        }
+        if (state == AX25_LINK_AWAITING_RELEASE)
+        {
+            ax25_link_send_u(link, false, AX25_LINK_DM, pf, NULL, 0);
+            return;
+        }
+
+        if (type == AX25_LINK_SABM)
+        {
+            link->modulus = 8;
+            if (!link->negotiated)
+                link->srej = false;
+            link->window = min(link->window, ax25_link_max_window(link));
+        }
+        else
+        {
+            link->modulus = 128;
+            link->window = min(link->negotiated ? link->window : link->config.window, ax25_link_max_window(link));
+        }
+
+        ax25_link_send_u(link, false, AX25_LINK_UA, pf, NULL, 0);
+        ax25_link_connected(link);
+        ax25_link_emit(link, (state == AX25_LINK_CONNECTED || state == AX25_LINK_TIMER_RECOVERY)
+                                 ? AX25_LINK_EVENT_RESET
+                                 : AX25_LINK_EVENT_CONNECTED);
+        return;
+
+    case AX25_LINK_DISC:
+        if (!command)
+            return;
+        if (state == AX25_LINK_DISCONNECTED || state == AX25_LINK_AWAITING_CONNECTION || state == AX25_LINK_AWAITING_XID)
+        {
+            ax25_link_send_u(link, false, AX25_LINK_DM, pf, NULL, 0);
+            if (state != AX25_LINK_DISCONNECTED)
+                ax25_link_disconnected(link, AX25_LINK_EVENT_FAILED);
+            return;
+        }
+        ax25_link_send_u(link, false, AX25_LINK_UA, pf, NULL, 0);
+        ax25_link_disconnected(link, AX25_LINK_EVENT_DISCONNECTED);
+        return;
+
+    case AX25_LINK_UA:
+        if (state == AX25_LINK_AWAITING_CONNECTION && pf)
+        {
+            ax25_link_connected(link);
+            ax25_link_emit(link, AX25_LINK_EVENT_CONNECTED);
+        }
+        else if (state == AX25_LINK_AWAITING_RELEASE && pf)
+            ax25_link_disconnected(link, AX25_LINK_EVENT_DISCONNECTED);
+        return;
+
+    case AX25_LINK_DM:
+        if (state == AX25_LINK_AWAITING_XID)
+            ax25_link_establish(link, now_ms); // Peer without XID support
+        else if (state == AX25_LINK_AWAITING_CONNECTION && pf)
+            ax25_link_disconnected(link, AX25_LINK_EVENT_FAILED);
+        else if (state == AX25_LINK_AWAITING_RELEASE && pf)
+            ax25_link_disconnected(link, AX25_LINK_EVENT_DISCONNECTED);
+        else if (state == AX25_LINK_CONNECTED || state == AX25_LINK_TIMER_RECOVERY)
+            ax25_link_disconnected(link, AX25_LINK_EVENT_DISCONNECTED);
+        return;
+
+    case AX25_LINK_FRMR:
+        if (state == AX25_LINK_AWAITING_XID || (state == AX25_LINK_AWAITING_CONNECTION && link->modulus == 128))
+        {
+            // Version 2.0 peer, fall back to modulo 8 without selective reject
+            link->modulus = 8;
+            link->srej = false;
+            link->window = min(link->window, ax25_link_max_window(link));
+            ax25_link_establish(link, now_ms);
+        }
+        else if (state == AX25_LINK_CONNECTED || state == AX25_LINK_TIMER_RECOVERY)
+            ax25_link_nr_error(link, now_ms);
+        return;
+
+    case AX25_LINK_XID:
+        if (command)
+        {
+            if (state == AX25_LINK_DISCONNECTED)
+                ax25_link_negotiate(link, info, len);
+            ax25_link_send_xid(link, false, pf);
+        }
+        else if (state == AX25_LINK_AWAITING_XID)
+        {
+            ax25_link_negotiate(link, info, len);
+            ax25_link_establish(link, now_ms);
+        }
+        return;
+
+    default:
+        return;
+    }
+}
+
+// Sends what the window allows and keeps T1/T3 consistent with what is outstanding
+static void ax25_link_pump(ax25_link_t *link, uint64_t now_ms)
+{
+    while (!link->peer_busy && link->tx_next - link->tx_head < (uint32_t)link->window)
+    {
+        if (link->tx_next == link->tx_sent)
+        {
+            if (link->queue_len == 0)
+                break;
+
+            // Cut the next I field from the queue
+            int len = min(link->queue_len, link->paclen);
+            uint8_t *slot = ax25_link_tx_slot(link, link->tx_next);
+            int first = min(len, link->queue_capacity - link->queue_head);
+            memcpy(slot, &link->queue[link->queue_head], first);
+            memcpy(slot + first, link->queue, len - first);
+            link->queue_head = (link->queue_head + len) % link->queue_capacity;
+            link->queue_len -= len;
+            link->tx_len[link->tx_next % AX25_LINK_SLOTS] = len;
+            link->tx_time[link->tx_next % AX25_LINK_SLOTS] = now_ms;
+            link->tx_resent[link->tx_next % AX25_LINK_SLOTS] = false;
+            link->tx_sent++;
+        }
+        else
+            link->tx_resent[link->tx_next % AX25_LINK_SLOTS] = true;
+        ax25_link_send_i(link, link->tx_next++, false);
+        if (link->t1_expiry == 0)
+            ax25_link_start_t1(link, now_ms);
+    }
+
+    if (link->tx_sent != link->tx_head)
+    {
+        if (link->t1_expiry == 0)
+            ax25_link_start_t1(link, now_ms);
+        link->t3_expiry = 0;
+    }
+    else
+    {
+        ax25_link_stop_t1(link);
+        if (link->t3_expiry == 0)
+            link->t3_expiry = now_ms + link->config.t3_ms;
+    }
+}
+
+static void ax25_link_update(ax25_link_t *link, uint64_t now_ms)
+{
+    if (link->state == AX25_LINK_CONNECTED)
+        ax25_link_pump(link, now_ms);
+
+    if (link->ack_pending && (link->state == AX25_LINK_CONNECTED || link->state == AX25_LINK_TIMER_RECOVERY))
+    {
+        if (link->config.t2_ms == 0)
+            ax25_link_enquiry_response(link, false);
+        else if (link->t2_expiry == 0)
+            link->t2_expiry = now_ms + link->config.t2_ms;
+    }
+}
+
+static void ax25_link_on_t1(ax25_link_t *link, uint64_t now_ms)
+{
+    bool exhausted = link->rc >= link->config.retries;
+    if (link->config.adaptive)
+        link->t1_ms = min(link->t1_ms * 2, link->config.t1_max_ms);
+    switch (link->state)
+    {
+    case AX25_LINK_AWAITING_XID:
+        if (exhausted)
+            ax25_link_establish(link, now_ms);
+        else
+        {
+            link->rc++;
+            ax25_link_send_xid(link, true, true);
+            ax25_link_start_t1(link, now_ms);
+        }
+        return;
+
+    case AX25_LINK_AWAITING_CONNECTION:
+        if (exhausted)
+            ax25_link_disconnected(link, AX25_LINK_EVENT_FAILED);
+        else
+        {
+            link->rc++;
+            ax25_link_send_u(link, true, link->modulus == 128 ? AX25_LINK_SABME : AX25_LINK_SABM, true, NULL, 0);
+            ax25_link_start_t1(link, now_ms);
+        }
+        return;
+
+    case AX25_LINK_AWAITING_RELEASE:
+        if (exhausted)
+            ax25_link_disconnected(link, AX25_LINK_EVENT_DISCONNECTED);
+        else
+        {
+            link->rc++;
+            ax25_link_send_u(link, true, AX25_LINK_DISC, true, NULL, 0);
+            ax25_link_start_t1(link, now_ms);
+        }
+        return;
+
+    case AX25_LINK_CONNECTED:
+        link->rc = 1;
+        link->state = AX25_LINK_TIMER_RECOVERY;
+        ax25_link_enquiry(link, now_ms);
+        return;
+
+    case AX25_LINK_TIMER_RECOVERY:
+        if (exhausted)
+        {
+            ax25_link_send_u(link, false, AX25_LINK_DM, false, NULL, 0);
+            ax25_link_disconnected(link, AX25_LINK_EVENT_FAILED);
+        }
+        else
+        {
+            link->rc++;
+            ax25_link_enquiry(link, now_ms);
+        }
+        return;
+
+    default:
+        return;
+    }
+}
+
+void ax25_link_config_init(ax25_link_config_t *config)
+{
+    nonnull(config, "config");
+
+    config->modulo128 = true;
+    config->srej = true;
+    config->xid = true;
+    config->window = 32;
+    config->paclen = 256;
+    config->retries = 10;
+    config->t1_ms = 3000;
+    config->t2_ms = 300;
+    config->t3_ms = 300000;
+    config->tx_complete = false;
+    config->adaptive = true;
+    config->t1_min_ms = 500;
+    config->t1_max_ms = 60000;
+    config->paclen_min = 32;
+}
+
+int ax25_link_init(ax25_link_t *link, const ax25_addr_t *local, const ax25_addr_t *remote,
+                   const ax25_link_config_t *config, ax25_link_output_t *output,
+                   ax25_link_receive_t *receive, ax25_link_event_t *event, void *ctx)
+{
+    nonnull(link, "link");
+    nonnull(local, "local");
+    nonnull(remote, "remote");
+    nonnull(config, "config");
+    nonnull(output, "output");
+    _assert(config->window >= 1 && config->window <= AX25_LINK_MAX_WINDOW, "1 <= window <= AX25_LINK_MAX_WINDOW");
+    _assert(config->paclen >= 1 && config->paclen <= UINT16_MAX, "1 <= paclen <= UINT16_MAX");
+    nonzero(config->t1_ms, "t1_ms");
+    nonzero(config->t3_ms, "t3_ms");
+    _assert(!config->adaptive || (config->t1_min_ms > 0 && config->t1_min_ms <= config->t1_max_ms), "0 < t1_min_ms <= t1_max_ms");
+    _assert(!config->adaptive || (config->paclen_min >= 1 && config->paclen_min <= config->paclen), "1 <= paclen_min <= paclen");
+
+    memset(link, 0, sizeof(*link));
+    link->local = *local;
+    link->remote = *remote;
+    link->config = *config;
+    link->output = output;
+    link->receive = receive;
+    link->event = event;
+    link->ctx = ctx;
+    link->t1_ms = config->t1_ms;
+
+    size_t store = (size_t)AX25_LINK_SLOTS * config->paclen;
+    link->queue_capacity = store;
+    link->queue = malloc(store);
+    link->tx_data = malloc(store);
+    link->rx_data = malloc(store);
+    link->frame_capacity = AX25_PACKET_LEN_FOR(max(config->paclen, AX25_LINK_XID_MAX_LEN)) + 1;
+    link->frame = malloc(link->frame_capacity);
+    if (!link->queue || !link->tx_data || !link->rx_data || !link->frame)
+    {
+        ax25_link_free(link);
+        return -AX25_LINK_NOMEM;
+    }
+
+    link->state = AX25_LINK_DISCONNECTED;
+    ax25_link_defaults(link);
+    return AX25_LINK_SUCCESS;
+}
+
+void ax25_link_free(ax25_link_t *link)
+{
+    nonnull(link, "link");
+
+    free(link->queue);
+    free(link->tx_data);
+    free(link->rx_data);
+    free(link->frame);
+    link->queue = NULL;
+    link->tx_data = NULL;
+    link->rx_data = NULL;
+    link->frame = NULL;
+}
+
+int ax25_link_connect(ax25_link_t *link, uint64_t now_ms)
+{
+    nonnull(link, "link");
+
+    if (link->state != AX25_LINK_DISCONNECTED)
+        return AX25_LINK_SUCCESS;
+
+    ax25_link_defaults(link);
+    if (link->config.xid)
+    {
+        link->rc = 0;
+        link->state = AX25_LINK_AWAITING_XID;
+        ax25_link_send_xid(link, true, true);
+        ax25_link_start_t1(link, now_ms);
+    }
+    else
+        ax25_link_establish(link, now_ms);
+    return AX25_LINK_SUCCESS;
+}
+
+int ax25_link_disconnect(ax25_link_t *link, uint64_t now_ms)
+{
+    nonnull(link, "link");
+
+    if (link->state == AX25_LINK_DISCONNECTED)
+        return -AX25_LINK_NOT_CONNECTED;
+
+    // Unsent and unacknowledged data is discarded
+    link->queue_len = 0;
+    link->tx_head = link->tx_sent;
+    link->rc = 0;
+    link->state = AX25_LINK_AWAITING_RELEASE;
+    link->t2_expiry = 0;
+    link->t3_expiry = 0;
+    ax25_link_send_u(link, true, AX25_LINK_DISC, true, NULL, 0);
+    ax25_link_start_t1(link, now_ms);
+    return AX25_LINK_SUCCESS;
+}
+
+int ax25_link_send(ax25_link_t *link, const uint8_t *data, int len, uint64_t now_ms)
+{
+    nonnull(link, "link");
+    nonnull(data, "data");
+    nonnegative(len, "len");
+
+    int accepted = min(len, link->queue_capacity - link->queue_len);
+    int tail = (link->queue_head + link->queue_len) % link->queue_capacity;
+    int first = min(accepted, link->queue_capacity - tail);
+    memcpy(&link->queue[tail], data, first);
+    memcpy(link->queue, data + first, accepted - first);
+    link->queue_len += accepted;
+
+    ax25_link_update(link, now_ms);
+    return accepted;
+}
+
+int ax25_link_pending(const ax25_link_t *link)
+{
+    nonnull(link, "link");
+
+    int pending = link->queue_len;
+    for (uint32_t abs = link->tx_head; abs != link->tx_sent; abs++)
+        pending += link->tx_len[abs % AX25_LINK_SLOTS];
+    return pending;
+}
+
+void ax25_link_set_busy(ax25_link_t *link, bool busy, uint64_t now_ms)
+{
+    nonnull(link, "link");
+
+    if (link->own_busy == busy)
+        return;
+
+    link->own_busy = busy;
+    if (link->state == AX25_LINK_CONNECTED || link->state == AX25_LINK_TIMER_RECOVERY)
+        ax25_link_enquiry_response(link, false);
+    ax25_link_update(link, now_ms);
+}
+
+int ax25_link_receive(ax25_link_t *link, const buffer_t *frame, uint64_t now_ms)
+{
+    nonnull(link, "link");
+    assert_buffer_valid(frame);
+
+    ax25_packet_t header;
+    ax25_packet_init(&header, NULL, 0);
+    int pos = ax25_packet_unpack_header(&header, frame);
+    if (pos < 0)
+        return -AX25_LINK_MALFORMED;
+
+    if (!ax25_link_addr_equal(&header.destination, &link->local) || !ax25_link_addr_equal(&header.source, &link->remote))
+        return -AX25_LINK_NOT_OURS;
+    for (int i = 0; i < header.path_len; i++)
+        if (!header.path[i].repeated)
+            return -AX25_LINK_NOT_OURS; // Still on its way through the digipeaters
+
+    // Version 2 command/response bits, older stations set both alike and are taken as commands
+    bool command = header.destination.repeated || !header.source.repeated;
+
+    const uint8_t *data = &frame->data[pos];
+    int len = frame->size - pos;
+    uint8_t control = data[0];
+
+    if ((control & 0x03) == 0x03)
+    {
+        ax25_link_on_u(link, command, control & ~AX25_LINK_PF, control & AX25_LINK_PF, data + 1, len - 1, now_ms);
+        ax25_link_update(link, now_ms);
+        return AX25_LINK_SUCCESS;
+    }
+
+    int control_len = link->modulus == 128 ? 2 : 1;
+    if (len < control_len)
+        return -AX25_LINK_MALFORMED;
+
+    int nr = link->modulus == 128 ? data[1] >> 1 : control >> 5;
+    bool pf = link->modulus == 128 ? data[1] & 1 : (control >> 4) & 1;
+    bool is_i = (control & 0x01) == 0;
+    if (is_i && len < control_len + AX25_PROTOCOL_LEN)
+        return -AX25_LINK_MALFORMED;
+
+    if (link->state != AX25_LINK_CONNECTED && link->state != AX25_LINK_TIMER_RECOVERY)
+    {
+        if (link->state == AX25_LINK_DISCONNECTED && command && pf)
+            ax25_link_send_u(link, false, AX25_LINK_DM, true, NULL, 0);
+        return AX25_LINK_SUCCESS;
+    }
+
+    if (is_i)
+    {
+        int ns = link->modulus == 128 ? control >> 1 : (control >> 1) & 0x07;
+        int info_pos = control_len + AX25_PROTOCOL_LEN;
+        ax25_link_on_i(link, ns, nr, pf, &data[info_pos], len - info_pos, now_ms);
+    }
+    else
+        ax25_link_on_s(link, (control >> 2) & 0x03, command, nr, pf, now_ms);
+
+    ax25_link_update(link, now_ms);
+    return AX25_LINK_SUCCESS;
+}
+
+void ax25_link_transmitted(ax25_link_t *link, uint64_t now_ms)
+{
+    nonnull(link, "link");
+
+    // Round trips are timed from the end of the first transmission
+    if ((int32_t)(link->tx_stamp - link->tx_head) < 0)
+        link->tx_stamp = link->tx_head;
+    for (; (int32_t)(link->tx_sent - link->tx_stamp) > 0; link->tx_stamp++)
+        link->tx_time[link->tx_stamp % AX25_LINK_SLOTS] = now_ms;
+
+    link->tx_busy = false;
+    if (link->t1_deferred)
+        ax25_link_start_t1(link, now_ms);
+}
+
+void ax25_link_tick(ax25_link_t *link, uint64_t now_ms)
+{
+    nonnull(link, "link");
+
+    if (link->t2_expiry && now_ms >= link->t2_expiry)
+    {
+        link->t2_expiry = 0;
+        if (link->ack_pending)
+            ax25_link_enquiry_response(link, false);
+    }
+    if (link->t1_expiry && now_ms >= link->t1_expiry)
+    {
+        link->t1_expiry = 0;
+        ax25_link_on_t1(link, now_ms);
+    }
+    if (link->t3_expiry && now_ms >= link->t3_expiry)
+    {
+        link->t3_expiry = 0;
+        if (link->state == AX25_LINK_CONNECTED)
+        {
+            link->rc = 0;
+            link->state = AX25_LINK_TIMER_RECOVERY;
+            ax25_link_enquiry(link, now_ms);
+        }
+    }
+    ax25_link_update(link, now_ms);
+}
+
+uint64_t ax25_link_next_deadline(const ax25_link_t *link)
+{
+    nonnull(link, "link");
+
+    uint64_t deadline = 0;
+    const uint64_t timers[] = {link->t1_expiry, link->t2_expiry, link->t3_expiry};
+    for (int i = 0; i < 3; i++)
+        if (timers[i] && (deadline == 0 || timers[i] < deadline))
+            deadline = timers[i];
+    return deadline;
+}
@@ -0,0 +1,244 @@
+#include "ax25_pool.h"
+#include "common.h"
+#include <string.h>
+
+#define AX25_POOL_NIL UINT32_MAX
+
+typedef struct ax25_pool_entry
+{
+    ax25_packet_t packet; // Must stay first, packets are cast back to entries
+    atomic_uint refs;
+    atomic_uint next;
+    uint32_t index;
+} ax25_pool_entry_t;
+
+static inline ax25_pool_entry_t *ax25_pool_entry(const ax25_pool_t *pool, uint32_t index)
+{
+    return (ax25_pool_entry_t *)((uint8_t *)pool->entries + (size_t)index * pool->entry_size);
+}
+
+static inline uint64_t ax25_pool_head(uint64_t old_head, uint32_t index)
+{
+    return (((old_head >> 32) + 1) << 32) | index;
+}
+
+static uint32_t ax25_pool_pop(ax25_pool_t *pool)
+{
+    uint64_t head = atomic_load_explicit(&pool->head, memory_order_acquire);
+    for (;;)
+    {
+        uint32_t index = (uint32_t)head;
+        if (index == AX25_POOL_NIL)
+            return AX25_POOL_NIL;
+
+        uint32_t next = atomic_load_explicit(&ax25_pool_entry(pool, index)->next, memory_order_relaxed);
+        if (atomic_compare_exchange_weak_explicit(&pool->head, &head, ax25_pool_head(head, next),
+                                                  memory_order_acq_rel, memory_order_acquire))
+        {
+            atomic_fetch_sub_explicit(&pool->available, 1, memory_order_relaxed);
+            return index;
+        }
+    }
+}
+
+// Pushes a chain of entries already linked from first to last
+static void ax25_pool_push_chain(ax25_pool_t *pool, uint32_t first, uint32_t last, int length)
+{
+    ax25_pool_entry_t *tail = ax25_pool_entry(pool, last);
+    uint64_t head = atomic_load_explicit(&pool->head, memory_order_relaxed);
+    do
+        atomic_store_explicit(&tail->next, (uint32_t)head, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&pool->head, &head, ax25_pool_head(head, first),
+                                                  memory_order_release, memory_order_relaxed));
+
+    atomic_fetch_add_explicit(&pool->available, length, memory_order_relaxed);
+}
+
+static ax25_packet_t *ax25_pool_take(ax25_pool_t *pool, uint32_t index)
+{
+    ax25_pool_entry_t *entry = ax25_pool_entry(pool, index);
+    atomic_store_explicit(&entry->refs, 1, memory_order_relaxed);
+    ax25_packet_init(&entry->packet, (uint8_t *)(entry + 1), pool->info_capacity);
+    return &entry->packet;
+}
+
+// Drops one reference, returns true when it was the last one
+static bool ax25_pool_unref(ax25_packet_t *packet)
+{
+    ax25_pool_entry_t *entry = (ax25_pool_entry_t *)packet;
+    unsigned int refs = atomic_fetch_sub_explicit(&entry->refs, 1, memory_order_acq_rel);
+    _assert(refs > 0, "packet released more often than retained");
+    return refs == 1;
+}
+
+int ax25_pool_init(ax25_pool_t *pool, uint32_t count, int info_capacity)
+{
+    nonnull(pool, "pool");
+    nonzero(count, "count");
+    nonnegative(info_capacity, "info_capacity");
+    _assert(count < AX25_POOL_NIL, "count < AX25_POOL_NIL");
+    _assert(info_capacity <= UINT16_MAX, "info_capacity <= UINT16_MAX");
+
+    // Info storage follows each entry, rounded up to keep entries aligned
+    size_t align = _Alignof(ax25_pool_entry_t);
+    pool->entry_size = (sizeof(ax25_pool_entry_t) + info_capacity + align - 1) / align * align;
+    pool->info_capacity = info_capacity;
+    pool->count = count;
+    pool->entries = malloc(count * pool->entry_size);
+    if (pool->entries == NULL)
+        return -1;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        ax25_pool_entry_t *entry = ax25_pool_entry(pool, i);
+        entry->index = i;
+        atomic_init(&entry->refs, 0);
+        atomic_init(&entry->next, i + 1 < count ? i + 1 : AX25_POOL_NIL);
+    }
+    atomic_init(&pool->head, 0);
+    atomic_init(&pool->available, count);
+
+    return 0;
+}
+
+void ax25_pool_free(ax25_pool_t *pool)
+{
+    nonnull(pool, "pool");
+
+    free(pool->entries);
+    pool->entries = NULL;
+    pool->count = 0;
+}
+
+int ax25_pool_available(const ax25_pool_t *pool)
+{
+    nonnull(pool, "pool");
+
+    return atomic_load_explicit(&((ax25_pool_t *)pool)->available, memory_order_relaxed);
+}
+
+ax25_packet_t *ax25_pool_alloc(ax25_pool_t *pool)
+{
+    nonnull(pool, "pool");
+
+    uint32_t index = ax25_pool_pop(pool);
+    if (index == AX25_POOL_NIL)
+        return NULL;
+    return ax25_pool_take(pool, index);
+}
+
+ax25_packet_t *ax25_pool_retain(ax25_packet_t *packet)
+{
+    nonnull(packet, "packet");
+
+    atomic_fetch_add_explicit(&((ax25_pool_entry_t *)packet)->refs, 1, memory_order_relaxed);
+    return packet;
+}
+
+void ax25_pool_release(ax25_pool_t *pool, ax25_packet_t *packet)
+{
+    nonnull(pool, "pool");
+    nonnull(packet, "packet");
+
+    if (ax25_pool_unref(packet))
+    {
+        uint32_t index = ((ax25_pool_entry_t *)packet)->index;
+        ax25_pool_push_chain(pool, index, index, 1);
+    }
+}
+
+int ax25_pool_refs(const ax25_packet_t *packet)
+{
+    nonnull(packet, "packet");
+
+    return atomic_load_explicit(&((ax25_pool_entry_t *)packet)->refs, memory_order_relaxed);
+}
+
+void ax25_pool_cache_init(ax25_pool_cache_t *cache, ax25_pool_t *pool)
+{
+    nonnull(cache, "cache");
+    nonnull(pool, "pool");
+
+    cache->pool = pool;
+    cache->count = 0;
+}
+
+static void ax25_pool_cache_spill(ax25_pool_cache_t *cache, uint32_t keep)
+{
+    if (cache->count <= keep)
+        return;
+
+    ax25_pool_t *pool = cache->pool;
+    for (uint32_t i = keep; i + 1 < cache->count; i++)
+        atomic_store_explicit(&ax25_pool_entry(pool, cache->entries[i])->next, cache->entries[i + 1], memory_order_relaxed);
+
+    ax25_pool_push_chain(pool, cache->entries[keep], cache->entries[cache->count - 1], cache->count - keep);
+    cache->count = keep;
+}
+
+ax25_packet_t *ax25_pool_cache_alloc(ax25_pool_cache_t *cache)
+{
+    nonnull(cache, "cache");
+
+    if (cache->count == 0)
+    {
+        while (cache->count < AX25_POOL_CACHE_SIZE / 2)
+        {
+            uint32_t index = ax25_pool_pop(cache->pool);
+            if (index == AX25_POOL_NIL)
+                break;
+            cache->entries[cache->count++] = index;
+        }
+        if (cache->count == 0)
+            return NULL;
+    }
+
+    return ax25_pool_take(cache->pool, cache->entries[--cache->count]);
+}
+
+void ax25_pool_cache_release(ax25_pool_cache_t *cache, ax25_packet_t *packet)
+{
+    nonnull(cache, "cache");
+    nonnull(packet, "packet");
+
+    if (!ax25_pool_unref(packet))
+        return;
+
+    if (cache->count == AX25_POOL_CACHE_SIZE)
+        ax25_pool_cache_spill(cache, AX25_POOL_CACHE_SIZE / 2);
+    cache->entries[cache->count++] = ((ax25_pool_entry_t *)packet)->index;
+}
+
+void ax25_pool_cache_flush(ax25_pool_cache_t *cache)
+{
+    nonnull(cache, "cache");
+
+    ax25_pool_cache_spill(cache, 0);
+}
+
+ax25_packet_t *ax25_pool_decode(ax25_pool_cache_t *cache, ax25_pool_decoder_t *decoder, const buffer_t *buf)
+{
+    nonnull(cache, "cache");
+    nonnull(decoder, "decoder");
+
+    ax25_packet_t *packet = ax25_pool_cache_alloc(cache);
+    if (packet == NULL)
+        return NULL;
+
+    if (decoder(packet, buf) != 0)
+    {
+        ax25_pool_cache_release(cache, packet);
+        return NULL;
+    }
+    return packet;
+}
+
+static int ax25_pool_unpack_decoder(ax25_packet_t *packet, const buffer_t *buf)
+{
+    return ax25_packet_unpack(packet, buf);
+}
+
+ax25_packet_t *ax25_pool_unpack(ax25_pool_cache_t *cache, const buffer_t *buf)
+{
+    return ax25_pool_decode(cache, ax25_pool_unpack_decoder, buf);
+}
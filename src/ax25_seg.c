@@ -0,0 +1,218 @@
+#include "ax25_seg.h"
+#include "common.h"
+#include <string.h>
+
+int ax25_segmenter_init(ax25_segmenter_t *seg, uint8_t pid, const uint8_t *data, int len, int max_info)
+{
+    nonnull(seg, "seg");
+    nonnegative(len, "len");
+    _assert(data != NULL || len == 0, "data not NULL");
+    _assert(max_info >= 3, "max_info >= 3");
+
+    // The first segment also carries the original PID
+    int first_len = max_info - 2;
+    int rest_len = max_info - 1;
+    int count = len <= first_len ? 1 : 1 + (len - first_len + rest_len - 1) / rest_len;
+    if (count > AX25_SEG_MAX_SEGMENTS)
+        return -AX25_SEG_TOO_LARGE;
+
+    memset(seg, 0, sizeof(*seg));
+    seg->data = data;
+    seg->len = len;
+    seg->max_info = max_info;
+    seg->count = count;
+    seg->remaining = count;
+    seg->pid = pid;
+
+    return count;
+}
+
+int ax25_segmenter_next(ax25_segmenter_t *seg, ax25_seg_iov_t iov[2])
+{
+    nonnull(seg, "seg");
+    nonnull(iov, "iov");
+
+    if (seg->remaining == 0)
+        return 0;
+
+    bool first = seg->remaining == seg->count;
+    seg->remaining--;
+    seg->header[0] = (first ? AX25_SEG_FIRST : 0) | seg->remaining;
+    seg->header[1] = seg->pid;
+    iov[0].data = seg->header;
+    iov[0].len = first ? 2 : 1;
+
+    iov[1].data = seg->data != NULL ? &seg->data[seg->offset] : NULL;
+    iov[1].len = min(seg->len - seg->offset, seg->max_info - iov[0].len);
+    seg->offset += iov[1].len;
+
+    return iov[0].len + iov[1].len;
+}
+
+int ax25_segmenter_pack(ax25_segmenter_t *seg, const ax25_packet_t *header, buffer_t *out_frame)
+{
+    nonnull(seg, "seg");
+    nonnull(header, "header");
+    assert_buffer_valid(out_frame);
+
+    if (seg->remaining == 0)
+        return 0;
+
+    int pos = ax25_packet_pack_header(header, out_frame);
+    if (pos < 0)
+        return -AX25_SEG_BUF_TOO_SMALL;
+
+    int first_len = seg->remaining == seg->count ? 2 : 1;
+    int info_len = first_len + min(seg->len - seg->offset, seg->max_info - first_len);
+    if (out_frame->capacity < pos + AX25_CONTROL_LEN + AX25_PROTOCOL_LEN + info_len)
+        return -AX25_SEG_BUF_TOO_SMALL;
+
+    ax25_seg_iov_t iov[2];
+    int ret = ax25_segmenter_next(seg, iov);
+    if (ret <= 0)
+        return ret;
+
+    uint8_t *p = &out_frame->data[pos];
+    *p++ = header->control;
+    *p++ = AX25_SEG_PID;
+    memcpy(p, iov[0].data, iov[0].len);
+    if (iov[1].len > 0)
+        memcpy(p + iov[0].len, iov[1].data, iov[1].len);
+    out_frame->size = pos + AX25_CONTROL_LEN + AX25_PROTOCOL_LEN + info_len;
+
+    return out_frame->size;
+}
+
+int ax25_reassembler_init(ax25_reassembler_t *reasm, int slot_count, int max_len, uint32_t timeout_ms)
+{
+    nonnull(reasm, "reasm");
+    _assert(slot_count >= 1, "slot_count >= 1");
+    _assert(max_len >= 1, "max_len >= 1");
+    nonzero(timeout_ms, "timeout_ms");
+
+    memset(reasm, 0, sizeof(*reasm));
+    reasm->slot_count = slot_count;
+    reasm->max_len = max_len;
+    reasm->timeout_ms = timeout_ms;
+
+    reasm->slots = calloc(slot_count, sizeof(ax25_reasm_slot_t));
+    reasm->data = malloc((size_t)slot_count * max_len);
+    if (!reasm->slots || !reasm->data)
+    {
+        ax25_reassembler_free(reasm);
+        return -AX25_SEG_NOMEM;
+    }
+
+    return 0;
+}
+
+void ax25_reassembler_free(ax25_reassembler_t *reasm)
+{
+    nonnull(reasm, "reasm");
+
+    free(reasm->slots);
+    free(reasm->data);
+    memset(reasm, 0, sizeof(*reasm));
+}
+
+void ax25_reassembler_expire(ax25_reassembler_t *reasm, uint64_t now_ms)
+{
+    nonnull(reasm, "reasm");
+
+    for (int i = 0; i < reasm->slot_count; i++)
+        if (reasm->slots[i].expiry != 0 && reasm->slots[i].expiry <= now_ms)
+            reasm->slots[i].expiry = 0;
+}
+
+static ax25_reasm_slot_t *ax25_reassembler_find(ax25_reassembler_t *reasm, uint64_t source, uint64_t destination)
+{
+    for (int i = 0; i < reasm->slot_count; i++)
+    {
+        ax25_reasm_slot_t *slot = &reasm->slots[i];
+        if (slot->expiry != 0 && slot->source == source && slot->destination == destination)
+            return slot;
+    }
+    return NULL;
+}
+
+// A free slot, otherwise the one idle longest
+static ax25_reasm_slot_t *ax25_reassembler_claim(ax25_reassembler_t *reasm)
+{
+    ax25_reasm_slot_t *oldest = &reasm->slots[0];
+    for (int i = 0; i < reasm->slot_count; i++)
+    {
+        ax25_reasm_slot_t *slot = &reasm->slots[i];
+        if (slot->expiry == 0)
+            return slot;
+        if (slot->expiry < oldest->expiry)
+            oldest = slot;
+    }
+    return oldest;
+}
+
+int ax25_reassembler_process(ax25_reassembler_t *reasm, const ax25_packet_t *packet, uint64_t now_ms,
+                             ax25_seg_message_t *out_message)
+{
+    nonnull(reasm, "reasm");
+    nonnull(packet, "packet");
+    nonnull(out_message, "out_message");
+
+    bool first = packet->info_len >= 1 && (packet->info[0] & AX25_SEG_FIRST);
+    if (packet->protocol != AX25_SEG_PID || packet->info_len < (first ? 2 : 1))
+        return -AX25_SEG_MALFORMED;
+
+    ax25_reassembler_expire(reasm, now_ms);
+
+    int remaining = packet->info[0] & ~AX25_SEG_FIRST;
+    const uint8_t *data = &packet->info[1];
+    int len = packet->info_len - 1;
+
+    uint64_t source = ax25_addr_key(&packet->source);
+    uint64_t destination = ax25_addr_key(&packet->destination);
+    ax25_reasm_slot_t *slot = ax25_reassembler_find(reasm, source, destination);
+
+    if (first)
+    {
+        // A new first segment abandons any message in progress from the same station
+        if (slot == NULL)
+            slot = ax25_reassembler_claim(reasm);
+        slot->source = source;
+        slot->destination = destination;
+        slot->pid = data[0];
+        slot->len = 0;
+        data++;
+        len--;
+    }
+    else if (slot == NULL)
+        return -AX25_SEG_OUT_OF_ORDER;
+    else if (remaining == slot->remaining)
+        return 0; // Duplicate, e.g. heard again through a digipeater
+    else if (remaining != slot->remaining - 1)
+    {
+        slot->expiry = 0;
+        return -AX25_SEG_OUT_OF_ORDER;
+    }
+
+    if (slot->len + len > reasm->max_len)
+    {
+        slot->expiry = 0;
+        return -AX25_SEG_TOO_LARGE;
+    }
+
+    uint8_t *storage = &reasm->data[(size_t)(slot - reasm->slots) * reasm->max_len];
+    memcpy(&storage[slot->len], data, len);
+    slot->len += len;
+    slot->remaining = remaining;
+    slot->expiry = now_ms + reasm->timeout_ms;
+
+    if (remaining > 0)
+        return 0;
+
+    slot->expiry = 0;
+    out_message->source = source;
+    out_message->destination = destination;
+    out_message->pid = slot->pid;
+    out_message->data = storage;
+    out_message->len = slot->len;
+    return 1;
+}
@@ -0,0 +1,214 @@
+#include "ax25_table.h"
+#include "common.h"
+#include <string.h>
+
+#define AX25_TABLE_CHUNK 64
+
+int ax25_table_init(ax25_table_t *table, int capacity, uint32_t arena_capacity)
+{
+    nonnull(table, "table");
+    nonzero(capacity, "capacity");
+    nonnegative(capacity, "capacity");
+
+    memset(table, 0, sizeof(*table));
+    table->capacity = capacity;
+    table->arena_capacity = arena_capacity;
+
+    table->source = malloc(capacity * sizeof(uint64_t));
+    table->destination = malloc(capacity * sizeof(uint64_t));
+    table->path_len = malloc(capacity * sizeof(uint8_t));
+    table->path = malloc(capacity * AX25_MAX_PATH_LEN * sizeof(uint64_t));
+    table->path_repeated = malloc(capacity * sizeof(uint8_t));
+    table->control = malloc(capacity * sizeof(uint8_t));
+    table->protocol = malloc(capacity * sizeof(uint8_t));
+    table->info_offset = malloc(capacity * sizeof(uint32_t));
+    table->info_len = malloc(capacity * sizeof(uint16_t));
+    table->arena = malloc(arena_capacity > 0 ? arena_capacity : 1);
+
+    if (!table->source || !table->destination || !table->path_len || !table->path || !table->path_repeated ||
+        !table->control || !table->protocol || !table->info_offset || !table->info_len || !table->arena)
+    {
+        ax25_table_free(table);
+        return -1;
+    }
+
+    return 0;
+}
+
+void ax25_table_free(ax25_table_t *table)
+{
+    nonnull(table, "table");
+
+    free(table->source);
+    free(table->destination);
+    free(table->path_len);
+    free(table->path);
+    free(table->path_repeated);
+    free(table->control);
+    free(table->protocol);
+    free(table->info_offset);
+    free(table->info_len);
+    free(table->arena);
+    memset(table, 0, sizeof(*table));
+}
+
+void ax25_table_clear(ax25_table_t *table)
+{
+    nonnull(table, "table");
+
+    table->count = 0;
+    table->arena_size = 0;
+}
+
+int ax25_table_unpack(ax25_table_t *table, const buffer_t *frames, int count)
+{
+    nonnull(table, "table");
+    nonnull(frames, "frames");
+
+    int consumed = 0;
+    for (; consumed < count && table->count < table->capacity; consumed++)
+    {
+        const buffer_t *frame = &frames[consumed];
+        if (!buf_has_size_ge(frame, AX25_MIN_PACKET_LEN))
+            continue;
+
+        int addr_count = ax25_addr_count(frame);
+        if (addr_count < 2)
+            continue;
+
+        int header_len = addr_count * AX25_ADDR_LEN;
+        int info_len = frame->size - header_len - AX25_CONTROL_LEN - AX25_PROTOCOL_LEN;
+        if (info_len < 0 || info_len > UINT16_MAX)
+            continue;
+        if (table->arena_size + (uint32_t)info_len > table->arena_capacity)
+            break;
+
+        int row = table->count++;
+        const uint8_t *data = frame->data;
+
+        table->destination[row] = ax25_addr_key_wire(&data[0]);
+        table->source[row] = ax25_addr_key_wire(&data[AX25_ADDR_LEN]);
+
+        uint64_t *path = &table->path[row * AX25_MAX_PATH_LEN];
+        uint8_t repeated = 0;
+        int path_len = addr_count - 2;
+        for (int i = 0; i < AX25_MAX_PATH_LEN; i++)
+        {
+            if (i < path_len)
+            {
+                const uint8_t *addr = &data[(2 + i) * AX25_ADDR_LEN];
+                path[i] = ax25_addr_key_wire(addr);
+                repeated |= ((addr[AX25_ADDR_MAX_CALLSIGN_LEN] >> 7) & 1) << i;
+            }
+            else
+                path[i] = 0;
+        }
+        table->path_len[row] = path_len;
+        table->path_repeated[row] = repeated;
+
+        table->control[row] = data[header_len];
+        table->protocol[row] = data[header_len + 1];
+
+        table->info_offset[row] = table->arena_size;
+        table->info_len[row] = info_len;
+        memcpy(&table->arena[table->arena_size], &data[header_len + 2], info_len);
+        table->arena_size += info_len;
+    }
+
+    return consumed;
+}
+
+ax25_error_e ax25_table_get(const ax25_table_t *table, int row, ax25_packet_t *packet)
+{
+    nonnull(table, "table");
+    nonnull(packet, "packet");
+    _assert(row >= 0 && row < table->count, "row < table.count");
+
+    if (table->info_len[row] > packet->info_capacity)
+        return -AX25_INFO_TOO_LARGE;
+
+    ax25_addr_from_key(&packet->source, table->source[row]);
+    ax25_addr_from_key(&packet->destination, table->destination[row]);
+
+    packet->path_len = table->path_len[row];
+    const uint64_t *path = ax25_table_path(table, row);
+    for (int i = 0; i < packet->path_len; i++)
+    {
+        ax25_addr_from_key(&packet->path[i], path[i]);
+        packet->path[i].repeated = (table->path_repeated[row] >> i) & 1;
+    }
+
+    packet->control = table->control[row];
+    packet->protocol = table->protocol[row];
+    packet->info_len = table->info_len[row];
+    memcpy(packet->info, ax25_table_info(table, row), packet->info_len);
+
+    return AX25_SUCCESS;
+}
+
+int ax25_table_select(const uint64_t *column, int start, int end, uint64_t key, uint64_t mask, int *out_rows, int max_rows)
+{
+    nonnull(column, "column");
+    nonnull(out_rows, "out_rows");
+
+    key &= mask;
+    int n = 0;
+    uint8_t hit[AX25_TABLE_CHUNK];
+    for (int base = start; base < end && n < max_rows; base += AX25_TABLE_CHUNK)
+    {
+        int len = min(AX25_TABLE_CHUNK, end - base);
+        for (int i = 0; i < len; i++)
+            hit[i] = (column[base + i] & mask) == key;
+        for (int i = 0; i < len && n < max_rows; i++)
+        {
+            out_rows[n] = base + i;
+            n += hit[i];
+        }
+    }
+    return n;
+}
+
+int ax25_table_select_source(const ax25_table_t *table, uint64_t key, uint64_t mask, int *out_rows, int max_rows)
+{
+    nonnull(table, "table");
+
+    return ax25_table_select(table->source, 0, table->count, key, mask, out_rows, max_rows);
+}
+
+int ax25_table_select_destination(const ax25_table_t *table, uint64_t key, uint64_t mask, int *out_rows, int max_rows)
+{
+    nonnull(table, "table");
+
+    return ax25_table_select(table->destination, 0, table->count, key, mask, out_rows, max_rows);
+}
+
+int ax25_table_select_path(const ax25_table_t *table, uint64_t key, uint64_t mask, int *out_rows, int max_rows)
+{
+    nonnull(table, "table");
+    nonnull(out_rows, "out_rows");
+
+    key &= mask;
+    if (key == 0)
+        return 0; // Would match unused path entries
+
+    int n = 0;
+    uint8_t hit[AX25_TABLE_CHUNK];
+    for (int base = 0; base < table->count && n < max_rows; base += AX25_TABLE_CHUNK)
+    {
+        int len = min(AX25_TABLE_CHUNK, table->count - base);
+        const uint64_t *path = &table->path[base * AX25_MAX_PATH_LEN];
+        for (int i = 0; i < len; i++)
+        {
+            uint8_t h = 0;
+            for (int j = 0; j < AX25_MAX_PATH_LEN; j++)
+                h |= (path[i * AX25_MAX_PATH_LEN + j] & mask) == key;
+            hit[i] = h;
+        }
+        for (int i = 0; i < len && n < max_rows; i++)
+        {
+            out_rows[n] = base + i;
+            n += hit[i];
+        }
+    }
+    return n;
+}
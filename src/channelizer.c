@@ -0,0 +1,313 @@
+#include "channelizer.h"
+#include "common.h"
+#include "dsp.h"
+#include <math.h>
+#include <string.h>
+
+#define CHANNELIZER_KAISER_BETA 6.0 // About 60 dB stopband
+
+static double channelizer_bessel_i0(double x)
+{
+    double sum = 1, term = 1;
+    for (int k = 1; k < 32; k++)
+    {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+// Kaiser windowed sinc cut off at half the channel spacing, unity gain at DC
+static void channelizer_design(channelizer_t *ch)
+{
+    double fc = 0.5 / ch->channels;
+    double center = (ch->taps - 1) / 2.0, sum = 0;
+    for (int i = 0; i < ch->taps; i++)
+    {
+        double t = i - center;
+        double r = 2 * t / (ch->taps - 1);
+        double window = channelizer_bessel_i0(CHANNELIZER_KAISER_BETA * sqrt(fmax(0, 1 - r * r))) /
+                        channelizer_bessel_i0(CHANNELIZER_KAISER_BETA);
+        double h = window * (t == 0 ? 2 * fc : sin(2 * M_PI * fc * t) / (M_PI * t));
+        ch->prototype[ch->taps - 1 - i] = h;
+        sum += h;
+    }
+    for (int i = 0; i < ch->taps; i++)
+        ch->prototype[i] /= sum;
+}
+
+int channelizer_init(channelizer_t *ch, int channels)
+{
+    nonnull(ch, "ch");
+
+    if (channels < CHANNELIZER_MIN_CHANNELS || channels > CHANNELIZER_MAX_CHANNELS || (channels & (channels - 1)))
+        return -CHANNELIZER_INVALID_CHANNELS;
+
+    memset(ch, 0, sizeof(*ch));
+    ch->channels = channels;
+    ch->decimation = channels / 2;
+    ch->taps = channels * CHANNELIZER_TAPS;
+
+    ch->prototype = dsp_alloc_floats(ch->taps);
+    ch->raw_re = dsp_alloc_floats(ch->taps - 1 + CHANNELIZER_CHUNK);
+    ch->raw_im = dsp_alloc_floats(ch->taps - 1 + CHANNELIZER_CHUNK);
+    ch->sum_re = dsp_alloc_floats(channels);
+    ch->sum_im = dsp_alloc_floats(channels);
+    ch->fft_re = dsp_alloc_floats(channels);
+    ch->fft_im = dsp_alloc_floats(channels);
+    ch->twiddle_re = dsp_alloc_floats(channels / 2);
+    ch->twiddle_im = dsp_alloc_floats(channels / 2);
+    ch->bit_reverse = malloc(channels * sizeof(int));
+    if (!ch->prototype || !ch->raw_re || !ch->raw_im || !ch->sum_re || !ch->sum_im || !ch->fft_re || !ch->fft_im ||
+        !ch->twiddle_re || !ch->twiddle_im || !ch->bit_reverse)
+    {
+        channelizer_free(ch);
+        return -CHANNELIZER_NOMEM;
+    }
+
+    channelizer_design(ch);
+
+    int bits = 0;
+    while ((1 << bits) < channels)
+        bits++;
+    for (int i = 0; i < channels; i++)
+    {
+        int r = 0;
+        for (int b = 0; b < bits; b++)
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        ch->bit_reverse[i] = r;
+    }
+    for (int k = 0; k < channels / 2; k++)
+    {
+        ch->twiddle_re[k] = cos(2 * M_PI * k / channels);
+        ch->twiddle_im[k] = sin(2 * M_PI * k / channels);
+    }
+
+    return 0;
+}
+
+void channelizer_free(channelizer_t *ch)
+{
+    nonnull(ch, "ch");
+
+    free(ch->prototype);
+    free(ch->raw_re);
+    free(ch->raw_im);
+    free(ch->sum_re);
+    free(ch->sum_im);
+    free(ch->fft_re);
+    free(ch->fft_im);
+    free(ch->twiddle_re);
+    free(ch->twiddle_im);
+    free(ch->bit_reverse);
+    memset(ch, 0, sizeof(*ch));
+}
+
+int channelizer_blocks(const channelizer_t *ch, int samples)
+{
+    nonnull(ch, "ch");
+    nonnegative(samples, "samples");
+
+    return samples / ch->decimation + 1;
+}
+
+// In place radix 2 FFT with positive exponent, input in bit reversed order
+static void channelizer_fft(channelizer_t *ch)
+{
+    float *re = ch->fft_re, *im = ch->fft_im;
+    int n = ch->channels;
+    for (int len = 2; len <= n; len <<= 1)
+    {
+        int half = len / 2, step = n / len;
+        for (int i = 0; i < n; i += len)
+            for (int k = 0; k < half; k++)
+            {
+                float wr = ch->twiddle_re[k * step], wi = ch->twiddle_im[k * step];
+                int a = i + k, b = a + half;
+                float tr = re[b] * wr - im[b] * wi;
+                float ti = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+    }
+}
+
+// Channel k of the block ending at sample n is sum over i of h[i] x[n - i] e^(-2 pi j k (n - i) / M).
+// Splitting i into m + p M leaves M branch sums of the prototype times the input, then a DFT
+// of the branch sums rotated by n.
+static void channelizer_block(channelizer_t *ch, int start, float *out)
+{
+    int m_count = ch->channels, mask = m_count - 1;
+
+    // The window reversed prototype lines up with the input, so branch m collects index M - 1 - m
+    // of each segment
+    memset(ch->sum_re, 0, m_count * sizeof(float));
+    memset(ch->sum_im, 0, m_count * sizeof(float));
+    for (int s = 0; s < CHANNELIZER_TAPS; s++)
+    {
+        dsp_mac(ch->sum_re, &ch->raw_re[start + s * m_count], &ch->prototype[s * m_count], m_count);
+        dsp_mac(ch->sum_im, &ch->raw_im[start + s * m_count], &ch->prototype[s * m_count], m_count);
+    }
+
+    for (int m = 0; m < m_count; m++)
+    {
+        int slot = ch->bit_reverse[(m - ch->rotate) & mask];
+        ch->fft_re[slot] = ch->sum_re[m_count - 1 - m];
+        ch->fft_im[slot] = ch->sum_im[m_count - 1 - m];
+    }
+    channelizer_fft(ch);
+
+    for (int k = 0; k < m_count; k++)
+    {
+        out[2 * k] = ch->fft_re[k];
+        out[2 * k + 1] = ch->fft_im[k];
+    }
+    ch->rotate = (ch->rotate + ch->decimation) & mask;
+}
+
+int channelizer_process(channelizer_t *ch, const float_buffer_t *iq_buf, float_buffer_t *out_buf)
+{
+    nonnull(ch, "ch");
+    assert_buffer_valid(iq_buf);
+    assert_buffer_valid(out_buf);
+    _assert(iq_buf->size % 2 == 0, "iq_buf.size even");
+
+    int samples = iq_buf->size / 2;
+    if ((int64_t)channelizer_blocks(ch, samples) * 2 * ch->channels > out_buf->capacity)
+        return -CHANNELIZER_BUF_TOO_SMALL;
+
+    int hist = ch->taps - 1;
+    const float *iq = iq_buf->data;
+    int blocks = 0;
+
+    for (int pos = 0; pos < samples; pos += CHANNELIZER_CHUNK)
+    {
+        int n = min(CHANNELIZER_CHUNK, samples - pos);
+        for (int i = 0; i < n; i++)
+        {
+            ch->raw_re[hist + i] = iq[2 * (pos + i)];
+            ch->raw_im[hist + i] = iq[2 * (pos + i) + 1];
+        }
+
+        for (; ch->next < n; ch->next += ch->decimation)
+            channelizer_block(ch, ch->next, &out_buf->data[(size_t)blocks++ * 2 * ch->channels]);
+        ch->next -= n;
+
+        memmove(ch->raw_re, &ch->raw_re[n], hist * sizeof(float));
+        memmove(ch->raw_im, &ch->raw_im[n], hist * sizeof(float));
+    }
+
+    out_buf->size = blocks * 2 * ch->channels;
+    return blocks;
+}
+
+static void channelizer_receiver_frame(void *ctx, const buffer_t *frame_buf, int slicer)
+{
+    (void)slicer;
+    channelizer_channel_t *channel = ctx;
+    channel->rx->callback(channel->rx->ctx, frame_buf, channel->index);
+}
+
+int channelizer_receiver_init(channelizer_receiver_t *rx, int sample_rate, int channels, int slicers,
+                              channelizer_frame_callback_t *callback, void *ctx)
+{
+    nonnull(rx, "rx");
+    nonnull(callback, "callback");
+
+    memset(rx, 0, sizeof(*rx));
+    int ret = channelizer_init(&rx->bank, channels);
+    if (ret < 0)
+        return ret;
+    if (sample_rate <= 0 || sample_rate % rx->bank.decimation)
+    {
+        channelizer_free(&rx->bank);
+        return -CHANNELIZER_INVALID_RATE;
+    }
+    rx->sample_rate = sample_rate;
+    rx->callback = callback;
+    rx->ctx = ctx;
+
+    int blocks = channelizer_blocks(&rx->bank, CHANNELIZER_CHUNK);
+    rx->channels = calloc(channels, sizeof(channelizer_channel_t));
+    rx->blocks = malloc((size_t)blocks * 2 * channels * sizeof(float));
+    rx->audio = malloc(blocks * sizeof(float));
+    if (!rx->channels || !rx->blocks || !rx->audio)
+    {
+        channelizer_receiver_free(rx);
+        return -CHANNELIZER_NOMEM;
+    }
+
+    int channel_rate = sample_rate / rx->bank.decimation;
+    for (int k = 0; k < channels; k++)
+    {
+        channelizer_channel_t *channel = &rx->channels[k];
+        channel->rx = rx;
+        channel->index = k;
+        ret = afsk_receiver_init(&channel->afsk, channel_rate, slicers, channelizer_receiver_frame, channel);
+        if (ret < 0)
+        {
+            channelizer_receiver_free(rx);
+            return ret == -AFSK_INVALID_RATE ? -CHANNELIZER_INVALID_RATE : -CHANNELIZER_NOMEM;
+        }
+    }
+
+    return 0;
+}
+
+void channelizer_receiver_free(channelizer_receiver_t *rx)
+{
+    nonnull(rx, "rx");
+
+    // Receivers not yet initialized are zeroed, freeing them is a no-op
+    if (rx->channels != NULL)
+        for (int k = 0; k < rx->bank.channels; k++)
+            afsk_receiver_free(&rx->channels[k].afsk);
+    channelizer_free(&rx->bank);
+    free(rx->channels);
+    free(rx->blocks);
+    free(rx->audio);
+    rx->channels = NULL;
+    rx->blocks = rx->audio = NULL;
+}
+
+int channelizer_receiver_process(channelizer_receiver_t *rx, const float_buffer_t *iq_buf)
+{
+    nonnull(rx, "rx");
+    assert_buffer_valid(iq_buf);
+    _assert(iq_buf->size % 2 == 0, "iq_buf.size even");
+
+    int channels = rx->bank.channels;
+    int delivered = 0;
+
+    for (int pos = 0; pos < iq_buf->size; pos += 2 * CHANNELIZER_CHUNK)
+    {
+        int n = min(2 * CHANNELIZER_CHUNK, iq_buf->size - pos);
+        float_buffer_t chunk = {.data = &iq_buf->data[pos], .capacity = n, .size = n};
+        float_buffer_t blocks_buf = {.data = rx->blocks, .capacity = channelizer_blocks(&rx->bank, CHANNELIZER_CHUNK) * 2 * channels, .size = 0};
+        int blocks = channelizer_process(&rx->bank, &chunk, &blocks_buf);
+
+        for (int k = 0; k < channels; k++)
+        {
+            // FM discriminator: phase step between samples, full scale at half the channel rate
+            channelizer_channel_t *channel = &rx->channels[k];
+            float last_re = channel->last_re, last_im = channel->last_im;
+            for (int b = 0; b < blocks; b++)
+            {
+                float re = rx->blocks[(b * channels + k) * 2];
+                float im = rx->blocks[(b * channels + k) * 2 + 1];
+                rx->audio[b] = atan2f(im * last_re - re * last_im, re * last_re + im * last_im) * (float)M_1_PI;
+                last_re = re;
+                last_im = im;
+            }
+            channel->last_re = last_re;
+            channel->last_im = last_im;
+
+            float_buffer_t audio = {.data = rx->audio, .capacity = blocks, .size = blocks};
+            delivered += afsk_receiver_process(&channel->afsk, &audio);
+        }
+    }
+
+    return delivered;
+}
@@ -1,175 +1,300 @@
 #include <string.h>
 #include <ctype.h>
 #include "conf.h"
+#include "line.h"
 
-static conf_error_e conf_trim(char *str)
+typedef struct conf_loader
 {
-    size_t len;
-    char *end;
-    char *start = str;
+    conf_t *conf;
+    conf_error_e err;
+} conf_loader_t;
 
-    nonnull(str, "str");
+static uint32_t conf_hash(const char *data, size_t len)
+{
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (size_t i = 0; i < len; i++)
+        hash = (hash ^ (uint8_t)data[i]) * 16777619u;
+    return hash;
+}
 
-    if (*start == '\0')
+// Index slot holding the key, or the empty slot where it would go
+static int conf_slot(const conf_t *conf, const char *key, size_t len, uint32_t hash)
+{
+    int slot = hash & conf->index_mask;
+    for (;; slot = (slot + 1) & conf->index_mask)
     {
-        str[0] = '\0';
-        return CONF_SUCCESS;
+        int32_t entry = conf->index[slot];
+        if (entry == 0)
+            return slot;
+        const conf_entry_t *e = &conf->entries[entry - 1];
+        const char *k = &conf->strings[e->key];
+        if (e->hash == hash && strncmp(k, key, len) == 0 && k[len] == '\0')
+            return slot;
+    }
+}
+
+static conf_error_e conf_grow_index(conf_t *conf)
+{
+    int size = conf->index ? 2 * (conf->index_mask + 1) : 64;
+    int32_t *index = calloc(size, sizeof(int32_t));
+    if (index == NULL)
+        return -CONF_ERR_NOMEM;
+
+    free(conf->index);
+    conf->index = index;
+    conf->index_mask = size - 1;
+    for (int i = 0; i < conf->count; i++)
+    {
+        const conf_entry_t *e = &conf->entries[i];
+        const char *k = &conf->strings[e->key];
+        conf->index[conf_slot(conf, k, strlen(k), e->hash)] = i + 1;
+    }
+    return CONF_SUCCESS;
+}
+
+static conf_error_e conf_add_string(conf_t *conf, const char *data, size_t len, uint32_t *out_offset)
+{
+    if (conf->strings_len + len + 1 > UINT32_MAX)
+        return -CONF_ERR_NOMEM;
+    if (conf->strings_len + len + 1 > conf->strings_capacity)
+    {
+        size_t capacity = max(max(conf->strings_capacity * 2, conf->strings_len + len + 1), (size_t)4096);
+        char *strings = realloc(conf->strings, capacity);
+        if (strings == NULL)
+            return -CONF_ERR_NOMEM;
+        conf->strings = strings;
+        conf->strings_capacity = capacity;
+    }
+
+    *out_offset = conf->strings_len;
+    memcpy(&conf->strings[conf->strings_len], data, len);
+    conf->strings[conf->strings_len + len] = '\0';
+    conf->strings_len += len + 1;
+    return CONF_SUCCESS;
+}
+
+static conf_error_e conf_add(conf_t *conf, const char *key, size_t key_len, const char *value, size_t value_len)
+{
+    if (2 * (conf->count + 1) > conf->index_mask + 1)
+    {
+        conf_error_e err = conf_grow_index(conf);
+        if (err)
+            return err;
     }
 
-    len = strlen(start);
-    end = start + len - 1;
+    uint32_t hash = conf_hash(key, key_len);
+    int slot = conf_slot(conf, key, key_len, hash);
+    if (conf->index[slot] != 0)
+        return CONF_SUCCESS; // First entry wins
 
-    while (end > start && isspace((unsigned char)*end))
-        end--;
+    if (conf->count == conf->capacity)
+    {
+        int capacity = max(16, conf->capacity * 2);
+        conf_entry_t *entries = realloc(conf->entries, capacity * sizeof(conf_entry_t));
+        if (entries == NULL)
+            return -CONF_ERR_NOMEM;
+        conf->entries = entries;
+        conf->capacity = capacity;
+    }
 
-    end[1] = '\0';
+    conf_entry_t *entry = &conf->entries[conf->count];
+    conf_error_e err = conf_add_string(conf, key, key_len, &entry->key);
+    if (!err)
+        err = conf_add_string(conf, value, value_len, &entry->value);
+    if (err)
+        return err;
 
-    if (start != str)
-        memmove(str, start, strlen(start) + 1);
+    const char *v = &conf->strings[entry->value];
+    entry->hash = hash;
+    entry->int_value = atoi(v);
+    entry->float_value = atof(v);
+    entry->bool_value = strcmp(v, "true") == 0 ? 1 : strcmp(v, "false") == 0 ? 0 : -1;
 
+    conf->index[slot] = ++conf->count;
     return CONF_SUCCESS;
 }
 
-static conf_error_e conf_parse_line(conf_entry_t *entry, const char *line)
+static size_t conf_trim_end(const char *str, size_t len)
 {
-    const char *eq;
-    size_t key_len;
-    size_t val_len;
-
-    nonnull(entry, "entry");
-    nonnull(line, "line");
+    while (len > 0 && isspace((unsigned char)str[len - 1]))
+        len--;
+    return len;
+}
 
-    while (isspace((unsigned char)*line))
+static conf_error_e conf_parse_line(conf_t *conf, const char *line, size_t len)
+{
+    const char *end = line + len;
+    while (line < end && isspace((unsigned char)*line))
         line++;
-    if (*line == '#' || *line == '\0')
+    if (line == end || *line == '#')
         return CONF_SUCCESS;
 
-    eq = strchr(line, '=');
+    const char *eq = memchr(line, '=', end - line);
     if (!eq)
-        return -CONF_ERR_INVALID_VALUE;
+        return CONF_SUCCESS; // Not an entry
 
-    key_len = eq - line;
-    if (key_len >= CONF_KEY_SIZE)
-        key_len = CONF_KEY_SIZE - 1;
-    memcpy(entry->key, line, key_len);
-    entry->key[key_len] = '\0';
-    conf_trim(entry->key);
+    size_t key_len = conf_trim_end(line, strnlen(line, eq - line));
+    if (key_len == 0)
+        return CONF_SUCCESS;
 
-    val_len = strlen(line) - key_len - 1;
-    if (val_len >= CONF_VAL_SIZE)
-        val_len = CONF_VAL_SIZE - 1;
-    memcpy(entry->value, eq + 1, val_len);
-    entry->value[val_len] = '\0';
-    conf_trim(entry->value);
+    const char *value = eq + 1;
+    while (value < end && isspace((unsigned char)*value))
+        value++;
 
-    return CONF_SUCCESS;
+    return conf_add(conf, line, key_len, value, conf_trim_end(value, end - value));
+}
+
+static void conf_load_line(void *ctx, const buffer_t *line_buf)
+{
+    conf_loader_t *loader = ctx;
+    if (!loader->err)
+        loader->err = conf_parse_line(loader->conf, (const char *)line_buf->data, line_buf->size);
+}
+
+static void conf_init(conf_t *conf, line_reader_t *lr, conf_loader_t *loader)
+{
+    memset(conf, 0, sizeof(*conf));
+    loader->conf = conf;
+    loader->err = CONF_SUCCESS;
+    line_reader_init(lr, conf_load_line, loader);
+    line_reader_set_max_line(lr, CONF_MAX_LINE);
+}
+
+conf_error_e conf_load_buffer(conf_t *conf, const char *data, size_t len)
+{
+    line_reader_t lr;
+    conf_loader_t loader;
+
+    nonnull(conf, "conf");
+    _assert(data != NULL || len == 0, "data not NULL");
+
+    conf_init(conf, &lr, &loader);
+    line_reader_process_buffer(&lr, (const uint8_t *)data, len);
+    line_reader_process(&lr, '\n');
+    line_reader_free(&lr);
+
+    if (loader.err)
+        conf_free(conf);
+    return loader.err;
 }
 
 conf_error_e conf_load(conf_t *conf, const char *filename)
 {
     FILE *fp;
-    char line[512];
-    conf_entry_t *entry;
+    uint8_t block[4096];
+    size_t n;
+    line_reader_t lr;
+    conf_loader_t loader;
 
     nonnull(conf, "conf");
     nonnull(filename, "filename");
 
-    _assert(sizeof(line) >= CONF_KEY_SIZE + CONF_VAL_SIZE, "line buffer fits config entry");
-
     fp = fopen(filename, "r");
     if (!fp)
         return -CONF_ERR_FILE_NOT_FOUND;
 
-    conf->count = 0;
-    while (fgets(line, sizeof(line), fp))
-    {
-        if (conf->count >= CONF_MAX_ENTRIES)
-        {
-            fclose(fp);
-            return -CONF_ERR_TOO_MANY_ENTRIES;
-        }
-        entry = &conf->entries[conf->count];
-        if (conf_parse_line(entry, line) == CONF_SUCCESS)
-        {
-            if (entry->key[0] != '\0')
-                conf->count++;
-        }
-    }
-
+    conf_init(conf, &lr, &loader);
+    while ((n = fread(block, 1, sizeof(block), fp)) > 0)
+        line_reader_process_buffer(&lr, block, n);
+    line_reader_process(&lr, '\n');
+    line_reader_free(&lr);
     fclose(fp);
-    return CONF_SUCCESS;
+
+    if (loader.err)
+        conf_free(conf);
+    return loader.err;
 }
 
-conf_error_e conf_get_int(const conf_t *conf, const char *key, int *out)
+void conf_free(conf_t *conf)
 {
-    int i;
     nonnull(conf, "conf");
-    nonnull(key, "key");
-    nonnull(out, "out");
 
-    for (i = 0; i < conf->count; i++)
-    {
-        if (strcmp(conf->entries[i].key, key) == 0)
-        {
-            *out = atoi(conf->entries[i].value);
-            return CONF_SUCCESS;
-        }
-    }
-    return -CONF_ERR_NOT_FOUND;
+    free(conf->entries);
+    free(conf->index);
+    free(conf->strings);
+    memset(conf, 0, sizeof(*conf));
 }
 
-conf_error_e conf_get_float(const conf_t *conf, const char *key, float *out)
+conf_key_t conf_find(const conf_t *conf, const char *key)
 {
-    int i;
     nonnull(conf, "conf");
     nonnull(key, "key");
-    nonnull(out, "out");
 
-    for (i = 0; i < conf->count; i++)
-    {
-        if (strcmp(conf->entries[i].key, key) == 0)
-        {
-            *out = atof(conf->entries[i].value);
-            return CONF_SUCCESS;
-        }
-    }
-    return -CONF_ERR_NOT_FOUND;
+    if (conf->count == 0)
+        return -CONF_ERR_NOT_FOUND;
+
+    size_t len = strlen(key);
+    int32_t entry = conf->index[conf_slot(conf, key, len, conf_hash(key, len))];
+    return entry ? entry - 1 : -CONF_ERR_NOT_FOUND;
 }
 
-conf_error_e conf_get_bool(const conf_t *conf, const char *key, int *out)
+static const conf_entry_t *conf_entry(const conf_t *conf, conf_key_t key)
 {
-    int i;
     nonnull(conf, "conf");
-    nonnull(key, "key");
+    _assert(key < conf->count, "key from this conf");
+
+    return key >= 0 ? &conf->entries[key] : NULL;
+}
+
+conf_error_e conf_key_int(const conf_t *conf, conf_key_t key, int *out)
+{
     nonnull(out, "out");
 
-    for (i = 0; i < conf->count; i++)
-    {
-        if (strcmp(conf->entries[i].key, key) == 0)
-        {
-            if (strcmp(conf->entries[i].value, "true") == 0)
-                *out = 1;
-            else if (strcmp(conf->entries[i].value, "false") == 0)
-                *out = 0;
-            else
-                return -CONF_ERR_INVALID_VALUE;
-            return CONF_SUCCESS;
-        }
-    }
-    return -CONF_ERR_NOT_FOUND;
+    const conf_entry_t *entry = conf_entry(conf, key);
+    if (!entry)
+        return -CONF_ERR_NOT_FOUND;
+    *out = entry->int_value;
+    return CONF_SUCCESS;
 }
 
-const char *conf_get_str(const conf_t *conf, const char *key)
+conf_error_e conf_key_float(const conf_t *conf, conf_key_t key, float *out)
 {
-    int i;
-    nonnull(conf, "conf");
-    nonnull(key, "key");
+    nonnull(out, "out");
 
-    for (i = 0; i < conf->count; i++)
-        if (strcmp(conf->entries[i].key, key) == 0)
-            return conf->entries[i].value;
+    const conf_entry_t *entry = conf_entry(conf, key);
+    if (!entry)
+        return -CONF_ERR_NOT_FOUND;
+    *out = entry->float_value;
+    return CONF_SUCCESS;
+}
+
+conf_error_e conf_key_bool(const conf_t *conf, conf_key_t key, int *out)
+{
+    nonnull(out, "out");
 
-    return NULL;
+    const conf_entry_t *entry = conf_entry(conf, key);
+    if (!entry)
+        return -CONF_ERR_NOT_FOUND;
+    if (entry->bool_value < 0)
+        return -CONF_ERR_INVALID_VALUE;
+    *out = entry->bool_value;
+    return CONF_SUCCESS;
+}
+
+const char *conf_key_str(const conf_t *conf, conf_key_t key)
+{
+    const conf_entry_t *entry = conf_entry(conf, key);
+    return entry ? &conf->strings[entry->value] : NULL;
+}
+
+conf_error_e conf_get_int(const conf_t *conf, const char *key, int *out)
+{
+    return conf_key_int(conf, conf_find(conf, key), out);
+}
+
+conf_error_e conf_get_float(const conf_t *conf, const char *key, float *out)
+{
+    return conf_key_float(conf, conf_find(conf, key), out);
+}
+
+conf_error_e conf_get_bool(const conf_t *conf, const char *key, int *out)
+{
+    return conf_key_bool(conf, conf_find(conf, key), out);
+}
+
+const char *conf_get_str(const conf_t *conf, const char *key)
+{
+    return conf_key_str(conf, conf_find(conf, key));
 }
 
 int conf_get_int_or_default(const conf_t *conf, const char *key, int def)
@@ -207,3 +332,176 @@ const char *conf_get_str_or_default(const conf_t *conf, const char *key, const c
     const char *out = conf_get_str(conf, key);
     return (out != NULL) ? out : def;
 }
+
+void conf_live_init(conf_live_t *live)
+{
+    nonnull(live, "live");
+
+    atomic_init(&live->current, NULL);
+    atomic_init(&live->epoch, 1);
+    atomic_init(&live->reader_count, 0);
+    for (int i = 0; i < CONF_LIVE_MAX_READERS; i++)
+    {
+        atomic_init(&live->readers[i].epoch, UINT64_MAX);
+        atomic_init(&live->readers[i].used, false);
+    }
+    pthread_mutex_init(&live->lock, NULL);
+    live->retired = NULL;
+}
+
+static void conf_live_destroy(conf_t *conf)
+{
+    if (conf == NULL)
+        return;
+    conf_free(conf);
+    free(conf);
+}
+
+void conf_live_free(conf_live_t *live)
+{
+    nonnull(live, "live");
+
+    conf_live_destroy(atomic_load(&live->current));
+    atomic_store(&live->current, NULL);
+    while (live->retired)
+    {
+        conf_retired_t *next = live->retired->next;
+        conf_live_destroy(live->retired->conf);
+        free(live->retired);
+        live->retired = next;
+    }
+    pthread_mutex_destroy(&live->lock);
+}
+
+int conf_live_register(conf_live_t *live)
+{
+    nonnull(live, "live");
+
+    for (int reader = 0; reader < CONF_LIVE_MAX_READERS; reader++)
+    {
+        bool used = false;
+        if (!atomic_compare_exchange_strong(&live->readers[reader].used, &used, true))
+            continue;
+
+        // Counted before going online so a writer that misses the count published first
+        int count = atomic_load(&live->reader_count);
+        while (count <= reader && !atomic_compare_exchange_weak(&live->reader_count, &count, reader + 1))
+            ;
+        conf_live_online(live, reader);
+        return reader;
+    }
+    return -CONF_ERR_TOO_MANY_READERS;
+}
+
+void conf_live_unregister(conf_live_t *live, int reader)
+{
+    nonnull(live, "live");
+
+    conf_live_offline(live, reader);
+    atomic_store_explicit(&live->readers[reader].used, false, memory_order_release);
+}
+
+void conf_live_quiescent(conf_live_t *live, int reader)
+{
+    // Loads of the snapshot after this may still see the previous one, which is why it is only
+    // retired with the epoch after the swap
+    uint64_t epoch = atomic_load_explicit(&live->epoch, memory_order_acquire);
+    atomic_store_explicit(&live->readers[reader].epoch, epoch, memory_order_release);
+}
+
+void conf_live_offline(conf_live_t *live, int reader)
+{
+    atomic_store_explicit(&live->readers[reader].epoch, UINT64_MAX, memory_order_release);
+}
+
+void conf_live_online(conf_live_t *live, int reader)
+{
+    // The fence keeps the snapshot load that follows from moving ahead of the store: either a
+    // writer scanning readers sees this one online, or it swapped the snapshot before the load
+    atomic_store(&live->readers[reader].epoch, atomic_load(&live->epoch));
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+static int conf_live_reclaim_locked(conf_live_t *live)
+{
+    uint64_t oldest = UINT64_MAX;
+    int readers = min(atomic_load(&live->reader_count), CONF_LIVE_MAX_READERS);
+    for (int i = 0; i < readers; i++)
+        oldest = min(oldest, (uint64_t)atomic_load(&live->readers[i].epoch));
+
+    int waiting = 0;
+    for (conf_retired_t **r = &live->retired; *r;)
+    {
+        if ((*r)->epoch <= oldest)
+        {
+            conf_retired_t *done = *r;
+            *r = done->next;
+            conf_live_destroy(done->conf);
+            free(done);
+        }
+        else
+        {
+            waiting++;
+            r = &(*r)->next;
+        }
+    }
+    return waiting;
+}
+
+conf_error_e conf_live_publish(conf_live_t *live, conf_t *conf)
+{
+    nonnull(live, "live");
+    nonnull(conf, "conf");
+
+    conf_t *snapshot = malloc(sizeof(conf_t));
+    conf_retired_t *retired = malloc(sizeof(conf_retired_t));
+    if (snapshot == NULL || retired == NULL)
+    {
+        free(snapshot);
+        free(retired);
+        return -CONF_ERR_NOMEM;
+    }
+    *snapshot = *conf;
+    memset(conf, 0, sizeof(*conf));
+
+    pthread_mutex_lock(&live->lock);
+    conf_t *old = atomic_exchange(&live->current, snapshot);
+    if (old != NULL)
+    {
+        retired->conf = old;
+        retired->epoch = atomic_fetch_add(&live->epoch, 1) + 1;
+        retired->next = live->retired;
+        live->retired = retired;
+    }
+    else
+        free(retired);
+    conf_live_reclaim_locked(live);
+    pthread_mutex_unlock(&live->lock);
+
+    return CONF_SUCCESS;
+}
+
+conf_error_e conf_live_reload(conf_live_t *live, const char *filename)
+{
+    conf_t conf;
+
+    nonnull(live, "live");
+
+    conf_error_e err = conf_load(&conf, filename);
+    if (err)
+        return err;
+    err = conf_live_publish(live, &conf);
+    if (err)
+        conf_free(&conf);
+    return err;
+}
+
+int conf_live_reclaim(conf_live_t *live)
+{
+    nonnull(live, "live");
+
+    pthread_mutex_lock(&live->lock);
+    int waiting = conf_live_reclaim_locked(live);
+    pthread_mutex_unlock(&live->lock);
+    return waiting;
+}
@@ -31,3 +31,54 @@ uint16_t crc_ccitt_get(crc_ccitt_t *crc)
 
     return crc->crc ^ 0xffff;
 }
+
+// Multiplies two polynomials modulo the CCITT polynomial, bit-reflected (bit 15 is x^0)
+static uint16_t crc_ccitt_multmodp(uint16_t a, uint16_t b)
+{
+    uint16_t m = 1 << 15;
+    uint16_t p = 0;
+    for (;;)
+    {
+        if (a & m)
+        {
+            p ^= b;
+            if ((a & (m - 1)) == 0)
+                break;
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ 0x8408 : b >> 1;
+    }
+    return p;
+}
+
+// x^(8 * n) modulo the CCITT polynomial, by repeated squaring
+static uint16_t crc_ccitt_x8nmodp(int n)
+{
+    uint16_t p = 1 << 15;        // x^0
+    uint16_t square = 1 << 7;    // x^8
+    while (n)
+    {
+        if (n & 1)
+            p = crc_ccitt_multmodp(square, p);
+        square = crc_ccitt_multmodp(square, square);
+        n >>= 1;
+    }
+    return p;
+}
+
+uint16_t crc_ccitt_patch(uint16_t fcs, const uint8_t *delta, int delta_len, int trailing_len)
+{
+    nonnull(delta, "delta");
+    nonnegative(trailing_len, "trailing_len");
+
+    // CRC is affine in the message, so the change in FCS is the zero-init CRC of the delta,
+    // shifted through the unchanged trailing bytes
+    uint16_t crc = 0;
+    for (int i = 0; i < delta_len; i++)
+        crc = (crc >> 8) ^ CRC_CCITT_TABLE[(crc ^ delta[i]) & 0xff];
+
+    if (crc && trailing_len)
+        crc = crc_ccitt_multmodp(crc_ccitt_x8nmodp(trailing_len), crc);
+
+    return fcs ^ crc;
+}
@@ -0,0 +1,186 @@
+#include "dedupe.h"
+#include "common.h"
+#include <string.h>
+
+#define DEDUPE_NIL UINT32_MAX
+#define DEDUPE_MUL 0x9e3779b97f4a7c15ULL
+
+static inline uint64_t dedupe_mix(uint64_t h, uint64_t w)
+{
+    h = (h ^ w) * DEDUPE_MUL;
+    return h ^ (h >> 29);
+}
+
+static uint64_t dedupe_hash(uint64_t destination, uint64_t source, const uint8_t *info, int info_len)
+{
+    while (info_len > 0 && (info[info_len - 1] == '\r' || info[info_len - 1] == '\n' || info[info_len - 1] == ' '))
+        info_len--;
+
+    uint64_t h = dedupe_mix(dedupe_mix(info_len, destination), source);
+
+    int i = 0;
+    for (; i + 8 <= info_len; i += 8)
+    {
+        uint64_t w;
+        memcpy(&w, &info[i], 8);
+        h = dedupe_mix(h, w);
+    }
+    if (i < info_len)
+    {
+        uint64_t w = 0;
+        memcpy(&w, &info[i], info_len - i);
+        h = dedupe_mix(h, w);
+    }
+
+    h ^= h >> 32;
+    return h * DEDUPE_MUL;
+}
+
+uint64_t dedupe_hash_frame(const buffer_t *frame)
+{
+    assert_buffer_valid(frame);
+
+    int count = ax25_addr_count(frame);
+    int info_pos = count * AX25_ADDR_LEN + AX25_CONTROL_LEN + AX25_PROTOCOL_LEN;
+    if (count < 2 || frame->size < info_pos)
+        return 0;
+
+    return dedupe_hash(ax25_addr_key_wire(&frame->data[0]), ax25_addr_key_wire(&frame->data[AX25_ADDR_LEN]),
+                       &frame->data[info_pos], frame->size - info_pos);
+}
+
+uint64_t dedupe_hash_packet(const ax25_packet_t *packet)
+{
+    nonnull(packet, "packet");
+
+    return dedupe_hash(ax25_addr_key(&packet->destination), ax25_addr_key(&packet->source),
+                       packet->info, packet->info_len);
+}
+
+int dedupe_init(dedupe_t *dd, uint32_t capacity, uint32_t window_ms, uint32_t resolution_ms)
+{
+    nonnull(dd, "dd");
+    nonzero(capacity, "capacity");
+    nonzero(resolution_ms, "resolution_ms");
+    _assert(capacity < DEDUPE_NIL / 2, "capacity < DEDUPE_NIL / 2");
+
+    uint32_t buckets = 1;
+    while (buckets < capacity)
+        buckets <<= 1;
+
+    memset(dd, 0, sizeof(*dd));
+    dd->capacity = capacity;
+    dd->bucket_mask = buckets - 1;
+    dd->resolution_ms = resolution_ms;
+    dd->wheel_slots = max(1, (window_ms + resolution_ms - 1) / resolution_ms);
+
+    dd->entries = malloc(capacity * sizeof(dedupe_entry_t));
+    dd->buckets = malloc(buckets * sizeof(uint32_t));
+    dd->wheel = malloc(dd->wheel_slots * sizeof(uint32_t));
+    if (!dd->entries || !dd->buckets || !dd->wheel)
+    {
+        dedupe_free(dd);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < capacity; i++)
+        dd->entries[i].wheel_next = i + 1 < capacity ? i + 1 : DEDUPE_NIL;
+    dd->free_head = 0;
+    memset(dd->buckets, 0xff, buckets * sizeof(uint32_t));
+    memset(dd->wheel, 0xff, dd->wheel_slots * sizeof(uint32_t));
+
+    return 0;
+}
+
+void dedupe_free(dedupe_t *dd)
+{
+    nonnull(dd, "dd");
+
+    free(dd->entries);
+    free(dd->buckets);
+    free(dd->wheel);
+    memset(dd, 0, sizeof(*dd));
+}
+
+static void dedupe_unlink(dedupe_t *dd, uint32_t index)
+{
+    uint32_t *link = &dd->buckets[dd->entries[index].hash & dd->bucket_mask];
+    while (*link != index)
+        link = &dd->entries[*link].bucket_next;
+    *link = dd->entries[index].bucket_next;
+}
+
+static void dedupe_expire_slot(dedupe_t *dd, uint32_t slot)
+{
+    uint32_t index = dd->wheel[slot];
+    while (index != DEDUPE_NIL)
+    {
+        uint32_t next = dd->entries[index].wheel_next;
+        dedupe_unlink(dd, index);
+        dd->entries[index].wheel_next = dd->free_head;
+        dd->free_head = index;
+        dd->count--;
+        index = next;
+    }
+    dd->wheel[slot] = DEDUPE_NIL;
+}
+
+void dedupe_advance(dedupe_t *dd, uint64_t now_ms)
+{
+    nonnull(dd, "dd");
+
+    uint64_t tick = now_ms / dd->resolution_ms;
+    if (tick <= dd->tick)
+        return;
+
+    // The slot a tick maps to holds entries recorded one full window earlier
+    uint64_t from = max(dd->tick + 1, tick >= dd->wheel_slots ? tick - dd->wheel_slots + 1 : 0);
+    for (uint64_t t = from; t <= tick; t++)
+        dedupe_expire_slot(dd, t % dd->wheel_slots);
+    dd->tick = tick;
+}
+
+static uint32_t dedupe_find(const dedupe_t *dd, uint64_t hash)
+{
+    uint32_t index = dd->buckets[hash & dd->bucket_mask];
+    while (index != DEDUPE_NIL && dd->entries[index].hash != hash)
+        index = dd->entries[index].bucket_next;
+    return index;
+}
+
+bool dedupe_contains(dedupe_t *dd, uint64_t hash, uint64_t now_ms)
+{
+    nonnull(dd, "dd");
+
+    dedupe_advance(dd, now_ms);
+    return dedupe_find(dd, hash) != DEDUPE_NIL;
+}
+
+bool dedupe_check(dedupe_t *dd, uint64_t hash, uint64_t now_ms)
+{
+    nonnull(dd, "dd");
+
+    dedupe_advance(dd, now_ms);
+    if (dedupe_find(dd, hash) != DEDUPE_NIL)
+        return true;
+
+    // Full: expire the oldest slots early to stay within the memory bound
+    for (uint32_t i = 1; dd->free_head == DEDUPE_NIL && i <= dd->wheel_slots; i++)
+        dedupe_expire_slot(dd, (dd->tick + i) % dd->wheel_slots);
+
+    uint32_t index = dd->free_head;
+    dedupe_entry_t *entry = &dd->entries[index];
+    dd->free_head = entry->wheel_next;
+
+    uint32_t slot = dd->tick % dd->wheel_slots;
+    entry->hash = hash;
+    entry->wheel_next = dd->wheel[slot];
+    dd->wheel[slot] = index;
+
+    uint32_t *bucket = &dd->buckets[hash & dd->bucket_mask];
+    entry->bucket_next = *bucket;
+    *bucket = index;
+    dd->count++;
+
+    return false;
+}
@@ -0,0 +1,204 @@
+#include "digi.h"
+#include "crc.h"
+#include "common.h"
+#include <string.h>
+
+#define DIGI_SSID_BYTE AX25_ADDR_MAX_CALLSIGN_LEN
+#define DIGI_H_BIT 0x80
+#define DIGI_SSID_BITS 0x1e
+
+static void digi_addr_wire(uint8_t *out, const ax25_addr_t *addr)
+{
+    for (int i = 0; i < AX25_ADDR_MAX_CALLSIGN_LEN; i++)
+        out[i] = addr->callsign[i] << 1;
+    out[DIGI_SSID_BYTE] = (addr->ssid & 0x0f) << 1;
+}
+
+static inline bool digi_addr_equal(const uint8_t *addr, const uint8_t *wire)
+{
+    return memcmp(addr, wire, AX25_ADDR_MAX_CALLSIGN_LEN) == 0 &&
+           (addr[DIGI_SSID_BYTE] & DIGI_SSID_BITS) == wire[DIGI_SSID_BYTE];
+}
+
+static inline int digi_addr_ssid(const uint8_t *addr)
+{
+    return (addr[DIGI_SSID_BYTE] >> 1) & 0x0f;
+}
+
+static inline void digi_addr_set_ssid(uint8_t *addr, int ssid)
+{
+    addr[DIGI_SSID_BYTE] = (addr[DIGI_SSID_BYTE] & ~DIGI_SSID_BITS) | (ssid << 1);
+}
+
+// Replaces the callsign and SSID, keeping the reserved and extension bits
+static inline void digi_addr_set(uint8_t *addr, const uint8_t *wire)
+{
+    memcpy(addr, wire, AX25_ADDR_MAX_CALLSIGN_LEN);
+    digi_addr_set_ssid(addr, wire[DIGI_SSID_BYTE] >> 1);
+}
+
+// n of a WIDEn-N or TRACEn-N address, 0 if the address is neither
+static int digi_addr_hops(const uint8_t *addr, const char *prefix)
+{
+    int len = strlen(prefix);
+    for (int i = 0; i < len; i++)
+        if (addr[i] != (uint8_t)(prefix[i] << 1))
+            return 0;
+
+    int n = (addr[len] >> 1) - '0';
+    if (n < 1 || n > 7)
+        return 0;
+    for (int i = len + 1; i < AX25_ADDR_MAX_CALLSIGN_LEN; i++)
+        if (addr[i] != (AX25_ADDR_PAD << 1))
+            return 0;
+    return n;
+}
+
+static bool digi_is_ours(const digi_t *digi, const uint8_t *addr)
+{
+    if (digi_addr_equal(addr, digi->mycall))
+        return true;
+    for (int i = 0; i < digi->alias_count; i++)
+        if (digi_addr_equal(addr, digi->aliases[i]))
+            return true;
+    return false;
+}
+
+static void digi_insert_addr(buffer_t *frame, int index, const uint8_t *wire)
+{
+    uint8_t *at = &frame->data[index * AX25_ADDR_LEN];
+    memmove(at + AX25_ADDR_LEN, at, frame->size - index * AX25_ADDR_LEN);
+    frame->size += AX25_ADDR_LEN;
+
+    memcpy(at, wire, AX25_ADDR_LEN);
+    at[DIGI_SSID_BYTE] |= 0x60 | DIGI_H_BIT;
+}
+
+static void digi_remove_addrs(buffer_t *frame, int index, int count)
+{
+    uint8_t *at = &frame->data[index * AX25_ADDR_LEN];
+    int removed = count * AX25_ADDR_LEN;
+    memmove(at, at + removed, frame->size - index * AX25_ADDR_LEN - removed);
+    frame->size -= removed;
+}
+
+void digi_init(digi_t *digi, const ax25_addr_t *mycall)
+{
+    nonnull(digi, "digi");
+    nonnull(mycall, "mycall");
+
+    digi_addr_wire(digi->mycall, mycall);
+    digi->alias_count = 0;
+    digi->wide_max_n = 2;
+    digi->trace_max_n = 2;
+    digi->trace_wide = true;
+    digi->preempt = DIGI_PREEMPT_OFF;
+}
+
+digi_error_e digi_add_alias(digi_t *digi, const ax25_addr_t *alias)
+{
+    nonnull(digi, "digi");
+    nonnull(alias, "alias");
+
+    if (digi->alias_count >= DIGI_MAX_ALIASES)
+        return -DIGI_TOO_MANY_ALIASES;
+
+    digi_addr_wire(digi->aliases[digi->alias_count++], alias);
+    return DIGI_SUCCESS;
+}
+
+int digi_process(const digi_t *digi, buffer_t *frame, uint16_t *fcs)
+{
+    nonnull(digi, "digi");
+    assert_buffer_valid(frame);
+
+    int count = ax25_addr_count(frame);
+    if (count < 2 || frame->size < count * AX25_ADDR_LEN + AX25_CONTROL_LEN)
+        return -DIGI_MALFORMED;
+    if (count == 2)
+        return DIGI_IGNORE;
+
+    uint8_t *data = frame->data;
+    if (digi_addr_equal(&data[AX25_ADDR_LEN], digi->mycall))
+        return DIGI_IGNORE; // Own transmission heard back
+
+    int next = 2;
+    while (next < count && (data[next * AX25_ADDR_LEN + DIGI_SSID_BYTE] & DIGI_H_BIT))
+        next++;
+    if (next == count)
+        return DIGI_IGNORE;
+
+    int header_len = count * AX25_ADDR_LEN;
+    uint8_t original[AX25_MAX_ADDR_COUNT * AX25_ADDR_LEN];
+    memcpy(original, data, header_len);
+    int original_size = frame->size;
+
+    uint8_t *addr = &data[next * AX25_ADDR_LEN];
+    int wide = digi_addr_hops(addr, "WIDE");
+    int trace = digi_addr_hops(addr, "TRACE");
+    int hops_left = digi_addr_ssid(addr);
+
+    if (digi_is_ours(digi, addr))
+    {
+        digi_addr_set(addr, digi->mycall);
+        addr[DIGI_SSID_BYTE] |= DIGI_H_BIT;
+    }
+    else if ((wide && wide <= digi->wide_max_n) || (trace && trace <= digi->trace_max_n))
+    {
+        if (hops_left < 1 || hops_left > max(wide, trace))
+            return DIGI_IGNORE;
+
+        bool traced = trace || digi->trace_wide;
+        if (traced && count < AX25_MAX_ADDR_COUNT && frame->capacity >= frame->size + AX25_ADDR_LEN)
+        {
+            digi_insert_addr(frame, next, digi->mycall);
+            addr = &data[(next + 1) * AX25_ADDR_LEN];
+        }
+
+        digi_addr_set_ssid(addr, --hops_left);
+        if (hops_left == 0)
+            addr[DIGI_SSID_BYTE] |= DIGI_H_BIT;
+    }
+    else if (digi->preempt != DIGI_PREEMPT_OFF)
+    {
+        int ours = next + 1;
+        while (ours < count && !digi_is_ours(digi, &data[ours * AX25_ADDR_LEN]))
+            ours++;
+        if (ours == count || (data[ours * AX25_ADDR_LEN + DIGI_SSID_BYTE] & DIGI_H_BIT))
+            return DIGI_IGNORE;
+
+        if (digi->preempt == DIGI_PREEMPT_DROP)
+        {
+            digi_remove_addrs(frame, next, ours - next);
+            ours = next;
+        }
+        else
+            for (int i = next; i < ours; i++)
+                data[i * AX25_ADDR_LEN + DIGI_SSID_BYTE] |= DIGI_H_BIT;
+
+        addr = &data[ours * AX25_ADDR_LEN];
+        digi_addr_set(addr, digi->mycall);
+        addr[DIGI_SSID_BYTE] |= DIGI_H_BIT;
+    }
+    else
+        return DIGI_IGNORE;
+
+    if (fcs != NULL)
+    {
+        if (frame->size == original_size)
+        {
+            for (int i = 0; i < header_len; i++)
+                original[i] ^= data[i];
+            *fcs = crc_ccitt_patch(*fcs, original, header_len, frame->size - header_len);
+        }
+        else
+        {
+            crc_ccitt_t crc;
+            crc_ccitt_init(&crc);
+            crc_ccitt_update_buffer(&crc, data, frame->size);
+            *fcs = crc_ccitt_get(&crc);
+        }
+    }
+
+    return DIGI_REPEAT;
+}
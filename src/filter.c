@@ -0,0 +1,734 @@
+#include "filter.h"
+#include "common.h"
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define FILTER_NIL UINT32_MAX
+#define FILTER_MAX_ARGS 16
+#define FILTER_MAX_CALL_LEN 10
+#define FILTER_EARTH_RADIUS_KM 6371.0
+
+static int filter_char_index(char c)
+{
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A';
+    if (c >= 'a' && c <= 'z')
+        return c - 'a';
+    if (c >= '0' && c <= '9')
+        return 26 + c - '0';
+    if (c == '-')
+        return 36;
+    return -1;
+}
+
+static int filter_grow(void **array, int *capacity, int needed, size_t element_size)
+{
+    if (needed <= *capacity)
+        return 0;
+
+    int new_capacity = max(16, *capacity * 2);
+    while (new_capacity < needed)
+        new_capacity *= 2;
+
+    void *grown = realloc(*array, new_capacity * element_size);
+    if (grown == NULL)
+        return -1;
+    *array = grown;
+    *capacity = new_capacity;
+    return 0;
+}
+
+static int filter_trie_init(filter_trie_t *trie)
+{
+    trie->nodes = NULL;
+    trie->count = 0;
+    trie->capacity = 0;
+    if (filter_grow((void **)&trie->nodes, (int *)&trie->capacity, 1, sizeof(filter_trie_node_t)))
+        return -1;
+
+    memset(&trie->nodes[0], 0, sizeof(filter_trie_node_t));
+    trie->nodes[0].prefix_refs = FILTER_NIL;
+    trie->nodes[0].exact_refs = FILTER_NIL;
+    trie->count = 1;
+    return 0;
+}
+
+// Node for a pattern, created as needed. Returns 0 on allocation failure (the root is never a pattern node).
+static uint32_t filter_trie_insert(filter_trie_t *trie, const char *pattern, int len)
+{
+    uint32_t node = 0;
+    for (int i = 0; i < len; i++)
+    {
+        int c = filter_char_index(pattern[i]);
+        uint32_t child = trie->nodes[node].children[c];
+        if (child == 0)
+        {
+            if (filter_grow((void **)&trie->nodes, (int *)&trie->capacity, trie->count + 1, sizeof(filter_trie_node_t)))
+                return 0;
+            child = trie->count++;
+            memset(&trie->nodes[child], 0, sizeof(filter_trie_node_t));
+            trie->nodes[child].prefix_refs = FILTER_NIL;
+            trie->nodes[child].exact_refs = FILTER_NIL;
+            trie->nodes[node].children[c] = child;
+        }
+        node = child;
+    }
+    return node;
+}
+
+static int filter_add_ref(filter_set_t *set, uint32_t *head, int sub, bool negated)
+{
+    uint32_t index = set->free_refs;
+    if (index != FILTER_NIL)
+        set->free_refs = set->refs[index].next;
+    else
+    {
+        if (filter_grow((void **)&set->refs, (int *)&set->ref_capacity, set->ref_count + 1, sizeof(filter_ref_t)))
+            return -FILTER_ERR_NOMEM;
+        index = set->ref_count++;
+    }
+
+    filter_ref_t *ref = &set->refs[index];
+    ref->sub = sub;
+    ref->negated = negated;
+    ref->next = *head;
+    *head = index;
+    return FILTER_SUCCESS;
+}
+
+// Unlinks the subscription's refs from a list, returning them to the free list
+static void filter_remove_refs(filter_set_t *set, uint32_t *head, int sub)
+{
+    while (*head != FILTER_NIL)
+    {
+        uint32_t index = *head;
+        if (set->refs[index].sub != (uint32_t)sub)
+        {
+            head = &set->refs[index].next;
+            continue;
+        }
+        *head = set->refs[index].next;
+        set->refs[index].next = set->free_refs;
+        set->free_refs = index;
+    }
+}
+
+static void filter_trie_remove(filter_set_t *set, filter_trie_t *trie, int sub)
+{
+    for (uint32_t node = 1; node < trie->count; node++)
+    {
+        filter_remove_refs(set, &trie->nodes[node].prefix_refs, sub);
+        filter_remove_refs(set, &trie->nodes[node].exact_refs, sub);
+    }
+}
+
+static inline void filter_set_bit(uint64_t *bits, uint32_t index)
+{
+    bits[index >> 6] |= 1ULL << (index & 63);
+}
+
+static void filter_apply_refs(filter_set_t *set, uint32_t ref)
+{
+    while (ref != FILTER_NIL)
+    {
+        filter_set_bit(set->refs[ref].negated ? set->negative : set->positive, set->refs[ref].sub);
+        ref = set->refs[ref].next;
+    }
+}
+
+static void filter_trie_walk(filter_set_t *set, const filter_trie_t *trie, const char *str, int len)
+{
+    uint32_t node = 0;
+    for (int i = 0; i < len; i++)
+    {
+        int c = filter_char_index(str[i]);
+        if (c < 0)
+            return;
+        node = trie->nodes[node].children[c];
+        if (node == 0)
+            return;
+        filter_apply_refs(set, trie->nodes[node].prefix_refs);
+    }
+    filter_apply_refs(set, trie->nodes[node].exact_refs);
+}
+
+static int filter_addr_string(const ax25_addr_t *addr, char *out)
+{
+    int len = 0;
+    while (len < AX25_ADDR_MAX_CALLSIGN_LEN && addr->callsign[len] != AX25_ADDR_PAD)
+    {
+        out[len] = addr->callsign[len];
+        len++;
+    }
+    if (addr->ssid)
+    {
+        out[len++] = '-';
+        if (addr->ssid >= 10)
+            out[len++] = '1';
+        out[len++] = '0' + addr->ssid % 10;
+    }
+    return len;
+}
+
+static bool filter_valid_call(const char *arg, int len, bool wildcard)
+{
+    if (wildcard && len > 1 && arg[len - 1] == '*')
+        len--;
+    if (len == 0 || len > FILTER_MAX_CALL_LEN)
+        return false;
+    for (int i = 0; i < len; i++)
+        if (filter_char_index(arg[i]) < 0)
+            return false;
+    return true;
+}
+
+static int filter_type_letter(char c)
+{
+    const char *letters = "poimqstuwn";
+    const char *at = strchr(letters, c);
+    return (c != '\0' && at != NULL) ? 1 << (at - letters) : -1;
+}
+
+static bool filter_parse_double(const char *arg, int len, double *out)
+{
+    char tmp[32];
+    if (len <= 0 || len >= (int)sizeof(tmp))
+        return false;
+    memcpy(tmp, arg, len);
+    tmp[len] = '\0';
+
+    char *end;
+    *out = strtod(tmp, &end);
+    return *end == '\0';
+}
+
+// Storage a filter needs, counted while validating so that compiling it cannot fail halfway
+typedef struct filter_needs
+{
+    int refs;
+    int source_nodes;
+    int digi_nodes;
+    int types;
+    int ranges;
+} filter_needs_t;
+
+// Parses one term such as "-p/N0/K1", counting what it needs into needs, or compiles it
+// when needs is NULL
+static int filter_term(filter_set_t *set, int sub, const char *term, int len, filter_needs_t *needs)
+{
+    bool apply = needs == NULL;
+    bool negated = false;
+    if (len > 0 && term[0] == '-')
+    {
+        negated = true;
+        term++;
+        len--;
+    }
+    if (len < 3 || term[1] != '/')
+        return -FILTER_ERR_SYNTAX;
+
+    const char *args[FILTER_MAX_ARGS];
+    int arg_lens[FILTER_MAX_ARGS];
+    int arg_count = 0;
+    for (int i = 2, start = 2; i <= len; i++)
+    {
+        if (i == len || term[i] == '/')
+        {
+            if (arg_count == FILTER_MAX_ARGS || i == start)
+                return -FILTER_ERR_SYNTAX;
+            args[arg_count] = &term[start];
+            arg_lens[arg_count++] = i - start;
+            start = i + 1;
+        }
+    }
+
+    switch (term[0])
+    {
+    case 'p':
+    case 'b':
+    case 'd':
+    {
+        filter_trie_t *trie = term[0] == 'd' ? &set->digi_trie : &set->source_trie;
+        for (int i = 0; i < arg_count; i++)
+        {
+            if (!filter_valid_call(args[i], arg_lens[i], term[0] != 'p'))
+                return -FILTER_ERR_SYNTAX;
+            if (!apply)
+            {
+                needs->refs++;
+                *(term[0] == 'd' ? &needs->digi_nodes : &needs->source_nodes) += arg_lens[i];
+                continue;
+            }
+
+            bool prefix = term[0] == 'p' || args[i][arg_lens[i] - 1] == '*';
+            uint32_t node = filter_trie_insert(trie, args[i], arg_lens[i] - (args[i][arg_lens[i] - 1] == '*'));
+            if (node == 0)
+                return -FILTER_ERR_NOMEM;
+            uint32_t *head = prefix ? &trie->nodes[node].prefix_refs : &trie->nodes[node].exact_refs;
+            int ret = filter_add_ref(set, head, sub, negated);
+            if (ret)
+                return ret;
+        }
+        return FILTER_SUCCESS;
+    }
+
+    case 't':
+    {
+        if (arg_count != 1)
+            return -FILTER_ERR_SYNTAX;
+        int mask = 0;
+        for (int i = 0; i < arg_lens[0]; i++)
+        {
+            int bit = filter_type_letter(args[0][i]);
+            if (bit < 0)
+                return -FILTER_ERR_SYNTAX;
+            mask |= bit;
+        }
+        if (!apply)
+        {
+            needs->types++;
+            return FILTER_SUCCESS;
+        }
+
+        int n = set->type_count;
+        set->type_sub[n] = sub;
+        set->type_mask[n] = mask;
+        set->type_negated[n] = negated;
+        set->type_count++;
+        return FILTER_SUCCESS;
+    }
+
+    case 'r':
+    {
+        double lat, lon, dist;
+        if (arg_count != 3 || !filter_parse_double(args[0], arg_lens[0], &lat) ||
+            !filter_parse_double(args[1], arg_lens[1], &lon) || !filter_parse_double(args[2], arg_lens[2], &dist))
+            return -FILTER_ERR_SYNTAX;
+        if (lat < -90 || lat > 90 || lon < -180 || lon > 180 || dist < 0)
+            return -FILTER_ERR_SYNTAX;
+        if (!apply)
+        {
+            needs->ranges++;
+            return FILTER_SUCCESS;
+        }
+
+        int n = set->range_count;
+        set->range_sub[n] = sub;
+        set->range_sin_lat[n] = sin(lat * M_PI / 180);
+        set->range_cos_lat[n] = cos(lat * M_PI / 180);
+        set->range_sin_lon[n] = sin(lon * M_PI / 180);
+        set->range_cos_lon[n] = cos(lon * M_PI / 180);
+        set->range_cos_dist[n] = cos(min(dist / FILTER_EARTH_RADIUS_KM, M_PI));
+        set->range_negated[n] = negated;
+        set->range_count++;
+        return FILTER_SUCCESS;
+    }
+
+    default:
+        return -FILTER_ERR_SYNTAX;
+    }
+}
+
+static int filter_terms(filter_set_t *set, int sub, const char *filter, filter_needs_t *needs)
+{
+    const char *p = filter;
+    int terms = 0;
+    while (*p)
+    {
+        while (*p == ' ')
+            p++;
+        const char *start = p;
+        while (*p && *p != ' ')
+            p++;
+        if (p == start)
+            break;
+
+        int ret = filter_term(set, sub, start, p - start, needs);
+        if (ret)
+            return ret;
+        terms++;
+    }
+    return terms > 0 ? FILTER_SUCCESS : -FILTER_ERR_SYNTAX;
+}
+
+int filter_set_init(filter_set_t *set)
+{
+    nonnull(set, "set");
+
+    memset(set, 0, sizeof(*set));
+    set->free_refs = FILTER_NIL;
+    if (filter_trie_init(&set->source_trie) || filter_trie_init(&set->digi_trie))
+    {
+        filter_set_free(set);
+        return -FILTER_ERR_NOMEM;
+    }
+    return FILTER_SUCCESS;
+}
+
+void filter_set_free(filter_set_t *set)
+{
+    nonnull(set, "set");
+
+    free(set->source_trie.nodes);
+    free(set->digi_trie.nodes);
+    free(set->refs);
+    free(set->type_sub);
+    free(set->type_mask);
+    free(set->type_negated);
+    free(set->range_sub);
+    free(set->range_sin_lat);
+    free(set->range_cos_lat);
+    free(set->range_sin_lon);
+    free(set->range_cos_lon);
+    free(set->range_cos_dist);
+    free(set->range_negated);
+    free(set->positive);
+    free(set->negative);
+    free(set->active);
+    memset(set, 0, sizeof(*set));
+}
+
+// Grows parallel arrays together, capacity only changing once all of them have
+static int filter_grow_parallel(void **arrays[], const size_t sizes[], int count, int *capacity, int needed)
+{
+    if (needed <= *capacity)
+        return 0;
+
+    int new_capacity = max(16, *capacity * 2);
+    while (new_capacity < needed)
+        new_capacity *= 2;
+
+    for (int i = 0; i < count; i++)
+    {
+        void *grown = realloc(*arrays[i], new_capacity * sizes[i]);
+        if (grown == NULL)
+            return -1;
+        *arrays[i] = grown;
+    }
+    *capacity = new_capacity;
+    return 0;
+}
+
+// Makes room for a subscription at sub and everything in needs
+static int filter_reserve(filter_set_t *set, int sub, const filter_needs_t *needs)
+{
+    int words = (max(set->count, sub + 1) + 63) / 64;
+    void **bits[] = {(void **)&set->positive, (void **)&set->negative, (void **)&set->active};
+    const size_t bits_sizes[] = {sizeof(uint64_t), sizeof(uint64_t), 64};
+    void **types[] = {(void **)&set->type_sub, (void **)&set->type_mask, (void **)&set->type_negated};
+    const size_t type_sizes[] = {sizeof(uint32_t), sizeof(uint16_t), sizeof(uint8_t)};
+    void **ranges[] = {(void **)&set->range_sub, (void **)&set->range_sin_lat, (void **)&set->range_cos_lat,
+                       (void **)&set->range_sin_lon, (void **)&set->range_cos_lon, (void **)&set->range_cos_dist,
+                       (void **)&set->range_negated};
+    const size_t range_sizes[] = {sizeof(uint32_t), sizeof(double), sizeof(double), sizeof(double),
+                                  sizeof(double), sizeof(double), sizeof(uint8_t)};
+
+    int bits_capacity = set->bits_capacity;
+    if (filter_grow_parallel(bits, bits_sizes, 3, &bits_capacity, words))
+        return -FILTER_ERR_NOMEM;
+    if (bits_capacity > set->bits_capacity)
+        memset(&set->active[set->bits_capacity * 64], 0, (bits_capacity - set->bits_capacity) * 64);
+    set->bits_capacity = bits_capacity;
+
+    if (filter_grow_parallel(types, type_sizes, 3, &set->type_capacity, set->type_count + needs->types) ||
+        filter_grow_parallel(ranges, range_sizes, 7, &set->range_capacity, set->range_count + needs->ranges) ||
+        filter_grow((void **)&set->refs, (int *)&set->ref_capacity, set->ref_count + needs->refs, sizeof(filter_ref_t)) ||
+        filter_grow((void **)&set->source_trie.nodes, (int *)&set->source_trie.capacity,
+                    set->source_trie.count + needs->source_nodes, sizeof(filter_trie_node_t)) ||
+        filter_grow((void **)&set->digi_trie.nodes, (int *)&set->digi_trie.capacity,
+                    set->digi_trie.count + needs->digi_nodes, sizeof(filter_trie_node_t)))
+        return -FILTER_ERR_NOMEM;
+    return FILTER_SUCCESS;
+}
+
+// Drops every term of a subscription, its bits are then never set
+static void filter_strip(filter_set_t *set, int sub)
+{
+    filter_trie_remove(set, &set->source_trie, sub);
+    filter_trie_remove(set, &set->digi_trie, sub);
+
+    int n = 0;
+    for (int i = 0; i < set->type_count; i++)
+        if (set->type_sub[i] != (uint32_t)sub)
+        {
+            set->type_sub[n] = set->type_sub[i];
+            set->type_mask[n] = set->type_mask[i];
+            set->type_negated[n++] = set->type_negated[i];
+        }
+    set->type_count = n;
+
+    n = 0;
+    for (int i = 0; i < set->range_count; i++)
+        if (set->range_sub[i] != (uint32_t)sub)
+        {
+            set->range_sub[n] = set->range_sub[i];
+            set->range_sin_lat[n] = set->range_sin_lat[i];
+            set->range_cos_lat[n] = set->range_cos_lat[i];
+            set->range_sin_lon[n] = set->range_sin_lon[i];
+            set->range_cos_lon[n] = set->range_cos_lon[i];
+            set->range_cos_dist[n] = set->range_cos_dist[i];
+            set->range_negated[n++] = set->range_negated[i];
+        }
+    set->range_count = n;
+}
+
+// Validates and reserves, so that compiling into sub cannot fail
+static int filter_compile(filter_set_t *set, int sub, const char *filter, bool replace)
+{
+    filter_needs_t needs = {0};
+    int ret = filter_terms(set, sub, filter, &needs);
+    if (ret)
+        return ret;
+    ret = filter_reserve(set, sub, &needs);
+    if (ret)
+        return ret;
+
+    if (replace)
+        filter_strip(set, sub);
+    ret = filter_terms(set, sub, filter, NULL);
+    _assert(ret == FILTER_SUCCESS, "storage reserved");
+
+    set->active[sub] = 1;
+    set->count = max(set->count, sub + 1);
+    set->words = (set->count + 63) / 64;
+    return sub;
+}
+
+int filter_set_add(filter_set_t *set, const char *filter)
+{
+    nonnull(set, "set");
+    nonnull(filter, "filter");
+
+    // Slots of removed subscriptions are reused before the bitmaps grow
+    int sub = 0;
+    while (sub < set->count && set->active[sub])
+        sub++;
+    return filter_compile(set, sub, filter, false);
+}
+
+int filter_set_replace(filter_set_t *set, int sub, const char *filter)
+{
+    nonnull(set, "set");
+    nonnull(filter, "filter");
+
+    if (sub < 0 || sub >= set->count || !set->active[sub])
+        return -FILTER_ERR_NOT_FOUND;
+    return filter_compile(set, sub, filter, true);
+}
+
+int filter_set_remove(filter_set_t *set, int sub)
+{
+    nonnull(set, "set");
+
+    if (sub < 0 || sub >= set->count || !set->active[sub])
+        return -FILTER_ERR_NOT_FOUND;
+
+    filter_strip(set, sub);
+    set->active[sub] = 0;
+    return FILTER_SUCCESS;
+}
+
+int filter_packet_type(const ax25_packet_t *packet)
+{
+    nonnull(packet, "packet");
+
+    if (packet->info_len == 0)
+        return 0;
+
+    const uint8_t *info = packet->info;
+    switch (info[0])
+    {
+    case '!':
+    case '=':
+    case '/':
+    case '@':
+    {
+        // Uncompressed position with the weather station symbol
+        int pos = (info[0] == '/' || info[0] == '@') ? 8 : 1;
+        if (packet->info_len > pos + 18 && info[pos] >= '0' && info[pos] <= '9' && info[pos + 18] == '_')
+            return FILTER_TYPE_POSITION | FILTER_TYPE_WEATHER;
+        return FILTER_TYPE_POSITION;
+    }
+    case '\'':
+    case '`':
+    case '$':
+        return FILTER_TYPE_POSITION;
+    case ';':
+        return FILTER_TYPE_OBJECT;
+    case ')':
+        return FILTER_TYPE_ITEM;
+    case ':':
+        if (packet->info_len >= 4 && memcmp(&info[1], "NWS", 3) == 0)
+            return FILTER_TYPE_MESSAGE | FILTER_TYPE_NWS;
+        return FILTER_TYPE_MESSAGE;
+    case '?':
+        return FILTER_TYPE_QUERY;
+    case '>':
+        return FILTER_TYPE_STATUS;
+    case 'T':
+        return FILTER_TYPE_TELEMETRY;
+    case '{':
+        return FILTER_TYPE_USER;
+    case '_':
+    case '#':
+    case '*':
+        return FILTER_TYPE_WEATHER;
+    default:
+        return 0;
+    }
+}
+
+static bool filter_digits(const uint8_t *str, int len, double *out)
+{
+    double value = 0;
+    for (int i = 0; i < len; i++)
+    {
+        uint8_t c = str[i] == ' ' ? '0' : str[i]; // Position ambiguity
+        if (c < '0' || c > '9')
+            return false;
+        value = value * 10 + (c - '0');
+    }
+    *out = value;
+    return true;
+}
+
+static bool filter_base91(const uint8_t *str, double *out)
+{
+    double value = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        if (str[i] < 33 || str[i] > 124)
+            return false;
+        value = value * 91 + (str[i] - 33);
+    }
+    *out = value;
+    return true;
+}
+
+bool filter_packet_position(const ax25_packet_t *packet, double *lat, double *lon)
+{
+    nonnull(packet, "packet");
+    nonnull(lat, "lat");
+    nonnull(lon, "lon");
+
+    const uint8_t *info = packet->info;
+    int len = packet->info_len;
+    if (len == 0)
+        return false;
+
+    int pos;
+    switch (info[0])
+    {
+    case '!':
+    case '=':
+        pos = 1;
+        break;
+    case '/':
+    case '@':
+        pos = 8;
+        break;
+    case ';':
+        pos = 18;
+        break;
+    default:
+        return false;
+    }
+    if (pos >= len)
+        return false;
+
+    if (info[pos] >= '0' && info[pos] <= '9')
+    {
+        // DDMM.mmN/DDDMM.mmW
+        const uint8_t *s = &info[pos];
+        double deg, minutes, frac;
+        if (len < pos + 18 || s[4] != '.' || s[14] != '.')
+            return false;
+        if (!filter_digits(s, 2, &deg) || !filter_digits(s + 2, 2, &minutes) || !filter_digits(s + 5, 2, &frac))
+            return false;
+        *lat = deg + (minutes + frac / 100) / 60;
+        if (s[7] == 'S')
+            *lat = -*lat;
+        else if (s[7] != 'N')
+            return false;
+
+        if (!filter_digits(s + 9, 3, &deg) || !filter_digits(s + 12, 2, &minutes) || !filter_digits(s + 15, 2, &frac))
+            return false;
+        *lon = deg + (minutes + frac / 100) / 60;
+        if (s[17] == 'W')
+            *lon = -*lon;
+        else if (s[17] != 'E')
+            return false;
+    }
+    else
+    {
+        // Compressed: symbol table, 4 base91 latitude and 4 base91 longitude characters
+        double y, x;
+        if (len < pos + 9 || !filter_base91(&info[pos + 1], &y) || !filter_base91(&info[pos + 5], &x))
+            return false;
+        *lat = 90 - y / 380926;
+        *lon = -180 + x / 190463;
+    }
+
+    return *lat >= -90 && *lat <= 90 && *lon >= -180 && *lon <= 180;
+}
+
+int filter_set_match(filter_set_t *set, const ax25_packet_t *packet, uint64_t *out_bits)
+{
+    nonnull(set, "set");
+    nonnull(packet, "packet");
+    nonnull(out_bits, "out_bits");
+
+    if (set->count == 0)
+        return 0;
+
+    memset(set->positive, 0, set->words * sizeof(uint64_t));
+    memset(set->negative, 0, set->words * sizeof(uint64_t));
+
+    char call[FILTER_MAX_CALL_LEN];
+    int len = filter_addr_string(&packet->source, call);
+    filter_trie_walk(set, &set->source_trie, call, len);
+
+    if (set->digi_trie.count > 1)
+        for (int i = 0; i < packet->path_len; i++)
+            if (packet->path[i].repeated)
+            {
+                len = filter_addr_string(&packet->path[i], call);
+                filter_trie_walk(set, &set->digi_trie, call, len);
+            }
+
+    if (set->type_count)
+    {
+        uint16_t type = filter_packet_type(packet);
+        for (int i = 0; i < set->type_count; i++)
+        {
+            uint64_t hit = (set->type_mask[i] & type) != 0;
+            uint64_t *bits = set->type_negated[i] ? set->negative : set->positive;
+            bits[set->type_sub[i] >> 6] |= hit << (set->type_sub[i] & 63);
+        }
+    }
+
+    double lat, lon;
+    if (set->range_count && filter_packet_position(packet, &lat, &lon))
+    {
+        double sin_lat = sin(lat * M_PI / 180), cos_lat = cos(lat * M_PI / 180);
+        double sin_lon = sin(lon * M_PI / 180), cos_lon = cos(lon * M_PI / 180);
+        for (int i = 0; i < set->range_count; i++)
+        {
+            // Spherical law of cosines, cos(dlon) expanded so the loop has no calls
+            double cos_dlon = cos_lon * set->range_cos_lon[i] + sin_lon * set->range_sin_lon[i];
+            double cos_angle = sin_lat * set->range_sin_lat[i] + cos_lat * set->range_cos_lat[i] * cos_dlon;
+            uint64_t hit = cos_angle >= set->range_cos_dist[i];
+            uint64_t *bits = set->range_negated[i] ? set->negative : set->positive;
+            bits[set->range_sub[i] >> 6] |= hit << (set->range_sub[i] & 63);
+        }
+    }
+
+    int matches = 0;
+    for (int i = 0; i < set->words; i++)
+    {
+        out_bits[i] = set->positive[i] & ~set->negative[i];
+        matches += __builtin_popcountll(out_bits[i]);
+    }
+    return matches;
+}
@@ -0,0 +1,321 @@
+#include "g3ruh.h"
+#include "common.h"
+#include "dsp.h"
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+
+#define G3RUH_TAP_A 12
+#define G3RUH_TAP_B 17
+#define G3RUH_ROLLOFF 0.5f
+#define G3RUH_LOWPASS_HZ (0.75f * G3RUH_BAUD)
+#define G3RUH_LOWPASS_BITS 3
+#define G3RUH_DC_S 0.1f
+#define G3RUH_AGC_DECAY_S 0.25f
+#define G3RUH_PLL_INERTIA 0.75f
+
+void g3ruh_scrambler_init(g3ruh_scrambler_t *scr)
+{
+    nonnull(scr, "scr");
+
+    scr->history = 0;
+}
+
+// Shifts n new line bits into the history
+static inline uint64_t g3ruh_history(uint64_t history, uint64_t line, int n)
+{
+    return n == 64 ? line : (history >> n) | (line << (64 - n));
+}
+
+static inline uint64_t g3ruh_mask(int n)
+{
+    return n == 64 ? ~0ULL : (1ULL << n) - 1;
+}
+
+uint64_t g3ruh_scramble(g3ruh_scrambler_t *scr, uint64_t data, int n)
+{
+    nonnull(scr, "scr");
+    _assert(n >= 1 && n <= 64, "1 <= n <= 64");
+
+    // Line bit i is data i ^ line i - 12 ^ line i - 17. Feedback from the previous word is known
+    // up front; within the word each pass settles 12 more bits, the shortest feedback delay.
+    uint64_t base = data ^ (scr->history >> (64 - G3RUH_TAP_A)) ^ (scr->history >> (64 - G3RUH_TAP_B));
+    uint64_t line = base;
+    for (int settled = G3RUH_TAP_A; settled < n; settled += G3RUH_TAP_A)
+        line = base ^ (line << G3RUH_TAP_A) ^ (line << G3RUH_TAP_B);
+
+    line &= g3ruh_mask(n);
+    scr->history = g3ruh_history(scr->history, line, n);
+    return line;
+}
+
+uint64_t g3ruh_descramble(g3ruh_scrambler_t *scr, uint64_t line, int n)
+{
+    nonnull(scr, "scr");
+    _assert(n >= 1 && n <= 64, "1 <= n <= 64");
+
+    line &= g3ruh_mask(n);
+    uint64_t data = line ^ (line << G3RUH_TAP_A) ^ (scr->history >> (64 - G3RUH_TAP_A)) ^
+                    (line << G3RUH_TAP_B) ^ (scr->history >> (64 - G3RUH_TAP_B));
+
+    scr->history = g3ruh_history(scr->history, line, n);
+    return data & g3ruh_mask(n);
+}
+
+// Packs up to 64 bits stored one per byte
+static inline uint64_t g3ruh_pack(const uint8_t *bits, int n)
+{
+    uint64_t word = 0;
+    int i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)&bits[i]);
+        v = _mm_cmpgt_epi8(v, _mm_setzero_si128());
+        word |= (uint64_t)(uint16_t)_mm_movemask_epi8(v) << i;
+    }
+#endif
+    for (; i < n; i++)
+        word |= (uint64_t)(bits[i] != 0) << i;
+    return word;
+}
+
+static inline void g3ruh_unpack(uint64_t word, uint8_t *bits, int n)
+{
+    for (int i = 0; i < n; i++)
+        bits[i] = (word >> i) & 1;
+}
+
+static int g3ruh_process_bits(g3ruh_scrambler_t *scr, const buffer_t *in_buf, buffer_t *out_buf, bool scramble)
+{
+    nonnull(scr, "scr");
+    assert_buffer_valid(in_buf);
+    assert_buffer_valid(out_buf);
+
+    if (out_buf->capacity < in_buf->size)
+        return -G3RUH_BUF_TOO_SMALL;
+
+    for (int i = 0; i < in_buf->size; i += 64)
+    {
+        int n = min(64, in_buf->size - i);
+        uint64_t word = g3ruh_pack(&in_buf->data[i], n);
+        word = scramble ? g3ruh_scramble(scr, word, n) : g3ruh_descramble(scr, word, n);
+        g3ruh_unpack(word, &out_buf->data[i], n);
+    }
+
+    out_buf->size = in_buf->size;
+    return out_buf->size;
+}
+
+int g3ruh_scramble_bits(g3ruh_scrambler_t *scr, const buffer_t *in_buf, buffer_t *out_buf)
+{
+    return g3ruh_process_bits(scr, in_buf, out_buf, true);
+}
+
+int g3ruh_descramble_bits(g3ruh_scrambler_t *scr, const buffer_t *in_buf, buffer_t *out_buf)
+{
+    return g3ruh_process_bits(scr, in_buf, out_buf, false);
+}
+
+// Raised cosine pulse sampled at G3RUH_PULSE_PHASES offsets within a bit, for the symbols in
+// the modulator's history (oldest first)
+static float g3ruh_pulse[G3RUH_PULSE_PHASES][G3RUH_PULSE_SPAN];
+static pthread_once_t g3ruh_pulse_once = PTHREAD_ONCE_INIT;
+
+static float g3ruh_raised_cosine(float t)
+{
+    float sinc = t == 0 ? 1 : sinf(M_PI * t) / (M_PI * t);
+    float d = 2 * G3RUH_ROLLOFF * t;
+    if (fabsf(d) == 1)
+        return M_PI / 4 * sinc;
+    return sinc * cosf(M_PI * G3RUH_ROLLOFF * t) / (1 - d * d);
+}
+
+static void g3ruh_pulse_init(void)
+{
+    for (int p = 0; p < G3RUH_PULSE_PHASES; p++)
+        for (int j = 0; j < G3RUH_PULSE_SPAN; j++)
+        {
+            // Time from symbol j, the output being half the span behind the latest symbol
+            float t = (float)p / G3RUH_PULSE_PHASES + (G3RUH_PULSE_SPAN / 2 - 1) - j;
+            g3ruh_pulse[p][j] = g3ruh_raised_cosine(t);
+        }
+}
+
+int g3ruh_modulator_init(g3ruh_modulator_t *mod, int sample_rate, float amplitude)
+{
+    nonnull(mod, "mod");
+
+    if (sample_rate < G3RUH_MIN_RATE || sample_rate > G3RUH_MAX_RATE)
+        return -G3RUH_INVALID_RATE;
+
+    pthread_once(&g3ruh_pulse_once, g3ruh_pulse_init);
+
+    memset(mod, 0, sizeof(*mod));
+    mod->sample_rate = sample_rate;
+    mod->amplitude = amplitude;
+
+    return 0;
+}
+
+int g3ruh_modulator_samples(const g3ruh_modulator_t *mod, int bits)
+{
+    nonnull(mod, "mod");
+    nonnegative(bits, "bits");
+
+    int64_t end = (int64_t)bits * mod->sample_rate;
+    if (end <= mod->bit_phase)
+        return 0;
+    int64_t samples = (end - mod->bit_phase + G3RUH_BAUD - 1) / G3RUH_BAUD;
+    return samples > INT32_MAX ? INT32_MAX : (int)samples;
+}
+
+int g3ruh_modulator_process(g3ruh_modulator_t *mod, const buffer_t *bits_buf, float_buffer_t *out_buf)
+{
+    nonnull(mod, "mod");
+    assert_buffer_valid(bits_buf);
+    assert_buffer_valid(out_buf);
+
+    int total = g3ruh_modulator_samples(mod, bits_buf->size);
+    if (total > out_buf->capacity)
+        return -G3RUH_BUF_TOO_SMALL;
+
+    float *out = out_buf->data;
+    float *symbols = mod->symbols;
+    for (int i = 0; i < bits_buf->size; i++)
+    {
+        memmove(symbols, &symbols[1], (G3RUH_PULSE_SPAN - 1) * sizeof(float));
+        symbols[G3RUH_PULSE_SPAN - 1] = bits_buf->data[i] ? mod->amplitude : -mod->amplitude;
+
+        for (; mod->bit_phase < mod->sample_rate; mod->bit_phase += G3RUH_BAUD)
+        {
+            const float *pulse = g3ruh_pulse[(int64_t)mod->bit_phase * G3RUH_PULSE_PHASES / mod->sample_rate];
+            float y = 0;
+            for (int j = 0; j < G3RUH_PULSE_SPAN; j++)
+                y += symbols[j] * pulse[j];
+            *out++ = y;
+        }
+        mod->bit_phase -= mod->sample_rate;
+    }
+
+    out_buf->size = total;
+    return total;
+}
+
+int g3ruh_demodulator_init(g3ruh_demodulator_t *demod, int sample_rate)
+{
+    nonnull(demod, "demod");
+
+    if (sample_rate < G3RUH_MIN_RATE || sample_rate > G3RUH_MAX_RATE)
+        return -G3RUH_INVALID_RATE;
+
+    memset(demod, 0, sizeof(*demod));
+    demod->sample_rate = sample_rate;
+
+    int taps = (G3RUH_LOWPASS_BITS * sample_rate / G3RUH_BAUD) | 1;
+    demod->taps = dsp_pad4(taps);
+    demod->lowpass = dsp_alloc_floats(demod->taps);
+    demod->raw = dsp_alloc_floats(demod->taps - 1 + G3RUH_DEMOD_CHUNK);
+    if (!demod->lowpass || !demod->raw)
+    {
+        g3ruh_demodulator_free(demod);
+        return -G3RUH_NOMEM;
+    }
+
+    // Windowed sinc with unity gain at DC
+    float fc = G3RUH_LOWPASS_HZ / sample_rate;
+    float center = (taps - 1) / 2.0f, sum = 0;
+    for (int k = 0; k < taps; k++)
+    {
+        float t = k - center;
+        float window = 0.54f - 0.46f * cosf(2 * M_PI * k / (taps - 1));
+        float h = window * (t == 0 ? 2 * fc : sinf(2 * M_PI * fc * t) / (M_PI * t));
+        demod->lowpass[demod->taps - 1 - k] = h;
+        sum += h;
+    }
+    for (int k = 0; k < demod->taps; k++)
+        demod->lowpass[k] /= sum;
+
+    demod->dc_rate = 1.0f / (sample_rate * G3RUH_DC_S);
+    demod->agc_attack = 0.5f;
+    demod->agc_decay = 1.0f / (sample_rate * G3RUH_AGC_DECAY_S);
+    demod->pll_step = (uint32_t)llround((double)G3RUH_BAUD / sample_rate * 4294967296.0);
+    demod->pll_inertia = G3RUH_PLL_INERTIA;
+
+    return 0;
+}
+
+void g3ruh_demodulator_free(g3ruh_demodulator_t *demod)
+{
+    nonnull(demod, "demod");
+
+    free(demod->lowpass);
+    free(demod->raw);
+    demod->lowpass = demod->raw = NULL;
+}
+
+int g3ruh_demodulator_bits(const g3ruh_demodulator_t *demod, int samples)
+{
+    nonnull(demod, "demod");
+    nonnegative(samples, "samples");
+
+    // Transitions pull the bit clock forward, so bits can come as often as every half bit
+    return (int)((int64_t)2 * samples * G3RUH_BAUD / demod->sample_rate) + 2;
+}
+
+int g3ruh_demodulator_process(g3ruh_demodulator_t *demod, const float_buffer_t *audio_buf, buffer_t *out_bits_buf)
+{
+    nonnull(demod, "demod");
+    assert_buffer_valid(audio_buf);
+    assert_buffer_valid(out_bits_buf);
+
+    if (g3ruh_demodulator_bits(demod, audio_buf->size) > out_bits_buf->capacity)
+        return -G3RUH_BUF_TOO_SMALL;
+
+    int hist = demod->taps - 1;
+    float *raw = demod->raw;
+    uint8_t *bits = out_bits_buf->data;
+    int count = 0;
+
+    float dc = demod->dc;
+    float level = demod->level;
+    float last = demod->last;
+    uint32_t pll = demod->pll;
+
+    for (int pos = 0; pos < audio_buf->size; pos += G3RUH_DEMOD_CHUNK)
+    {
+        int n = min(G3RUH_DEMOD_CHUNK, audio_buf->size - pos);
+        memcpy(&raw[hist], &audio_buf->data[pos], n * sizeof(float));
+
+        for (int i = 0; i < n; i++)
+        {
+            float y = dsp_dot(&raw[i], demod->lowpass, demod->taps);
+
+            // Scrambled data has no DC, whatever remains is discriminator offset
+            dc += (y - dc) * demod->dc_rate;
+            y -= dc;
+            float amplitude = fabsf(y);
+            level += (amplitude - level) * (amplitude > level ? demod->agc_attack : demod->agc_decay);
+            float d = y / (level + 1e-9f);
+
+            if ((d > 0) != (last > 0))
+                pll = (uint32_t)(int32_t)((int32_t)pll * demod->pll_inertia);
+            last = d;
+
+            uint32_t next = pll + demod->pll_step;
+            if ((int32_t)pll >= 0 && (int32_t)next < 0)
+                bits[count++] = d > 0;
+            pll = next;
+        }
+
+        memmove(raw, &raw[n], hist * sizeof(float));
+    }
+
+    demod->dc = dc;
+    demod->level = level;
+    demod->last = last;
+    demod->pll = pll;
+
+    out_bits_buf->size = count;
+    return count;
+}
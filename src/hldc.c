@@ -60,6 +60,9 @@ hldc_error_e hldc_framer_process(hldc_framer_t *framer, const buffer_t *frame_bu
     for (int i = 0; i < framer->head_flags; i++)
         hldc_framer_add_byte_unstuffed(framer, out_bits_buf, HLDC_FLAG);
 
+    // Flags end any run of ones, stuffing starts over with each frame
+    framer->ones_count = 0;
+
     // Frame data
     for (int i = 0; i < frame_buf->size; i++)
         hldc_framer_add_byte_stuffed(framer, out_bits_buf, frame_buf->data[i]);
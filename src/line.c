@@ -1,48 +1,173 @@
 #include "line.h"
 #include "common.h"
+#include <stdlib.h>
+#include <string.h>
 
-void line_reader_init(line_reader_t *lr, line_callback_t *line_callback)
+void line_reader_init(line_reader_t *lr, line_callback_t *line_callback, void *ctx)
 {
     nonnull(lr, "lr");
     nonnull(line_callback, "line_callback");
 
+    lr->arena = NULL;
+    lr->arena_capacity = 0;
+    lr->max_line = READ_BUF_SIZE;
     lr->buf_pos = 0;
     lr->line_callback = line_callback;
+    lr->batch_callback = NULL;
+    lr->ctx = ctx;
     lr->invalid = false;
+    lr->dropped = 0;
+    lr->batch_count = 0;
 }
 
-void line_reader_process(line_reader_t *lr, char ch)
+void line_reader_init_batch(line_reader_t *lr, line_batch_callback_t *batch_callback, void *ctx)
 {
     nonnull(lr, "lr");
+    nonnull(batch_callback, "batch_callback");
 
-    if (ch == '\n')
-    {
-        if (lr->buf_pos == 0)
-            return; // Blank line
-        if (lr->buf_pos <= READ_BUF_SIZE && lr->buf[lr->buf_pos - 1] == '\r')
-            lr->buf_pos--; // Handle CRLF delimitation
-        if (lr->buf_pos == 0)
-            return; // Blank line, but CRLF delimited
-
-        // Convert internal buffer to buffer_t for callback
-        buffer_t line_buf = {
-            .data = (unsigned char *)lr->buf,
-            .capacity = READ_BUF_SIZE,
-            .size = lr->buf_pos};
-
-        if (!lr->invalid && lr->line_callback)
-            lr->line_callback(&line_buf);
+    lr->arena = NULL;
+    lr->arena_capacity = 0;
+    lr->max_line = READ_BUF_SIZE;
+    lr->buf_pos = 0;
+    lr->line_callback = NULL;
+    lr->batch_callback = batch_callback;
+    lr->ctx = ctx;
+    lr->invalid = false;
+    lr->dropped = 0;
+    lr->batch_count = 0;
+}
 
+void line_reader_set_max_line(line_reader_t *lr, size_t max_line)
+{
+    nonnull(lr, "lr");
+    nonzero(max_line, "max_line");
+
+    // A stored fragment already over the new cap belongs to an over-long line
+    if (lr->buf_pos > max_line)
+    {
         lr->buf_pos = 0;
-        lr->invalid = false;
+        lr->invalid = true;
+        lr->dropped++;
+    }
+    lr->max_line = max_line;
+}
+
+void line_reader_free(line_reader_t *lr)
+{
+    nonnull(lr, "lr");
+
+    free(lr->arena);
+    lr->arena = NULL;
+    lr->arena_capacity = 0;
+    lr->buf_pos = 0;
+}
+
+static uint8_t *line_reader_storage(line_reader_t *lr)
+{
+    return lr->arena ? lr->arena : (uint8_t *)lr->buf;
+}
+
+static void line_reader_flush(line_reader_t *lr)
+{
+    if (lr->batch_count == 0)
+        return;
+
+    if (lr->batch_callback)
+        lr->batch_callback(lr->ctx, lr->batch, lr->batch_count);
+    else
+        for (int i = 0; i < lr->batch_count; i++)
+            lr->line_callback(lr->ctx, &lr->batch[i]);
+    lr->batch_count = 0;
+}
+
+// Queues a line without its delimiter for the callback, skipping blank and over-long lines
+static void line_reader_emit(line_reader_t *lr, const uint8_t *data, size_t len)
+{
+    if (len > lr->max_line)
+    {
+        lr->dropped++;
         return;
     }
+    if (len > 0 && data[len - 1] == '\r')
+        len--; // Handle CRLF delimitation
+    if (len == 0)
+        return; // Blank line
+
+    if (lr->batch_count == LINE_READER_BATCH)
+        line_reader_flush(lr);
+    lr->batch[lr->batch_count++] = (buffer_t){
+        .data = (unsigned char *)data,
+        .capacity = len,
+        .size = len};
+}
 
-    if (!lr->invalid)
+// Stores the start of a line that continues in a later block
+static void line_reader_append(line_reader_t *lr, const uint8_t *data, size_t len)
+{
+    if (lr->invalid)
+        return;
+    if (len > lr->max_line - lr->buf_pos)
     {
-        if (lr->buf_pos < READ_BUF_SIZE)
-            lr->buf[lr->buf_pos++] = ch;
-        else
+        lr->invalid = true;
+        lr->dropped++;
+        return;
+    }
+
+    size_t needed = lr->buf_pos + len;
+    size_t capacity = lr->arena ? lr->arena_capacity : READ_BUF_SIZE;
+    if (needed > capacity)
+    {
+        size_t new_capacity = min(max(needed, capacity * 2), lr->max_line);
+        uint8_t *arena = realloc(lr->arena, new_capacity);
+        if (arena == NULL)
+        {
             lr->invalid = true;
+            lr->dropped++;
+            return;
+        }
+        if (lr->arena == NULL)
+            memcpy(arena, lr->buf, lr->buf_pos);
+        lr->arena = arena;
+        lr->arena_capacity = new_capacity;
+    }
+
+    memcpy(&line_reader_storage(lr)[lr->buf_pos], data, len);
+    lr->buf_pos += len;
+}
+
+void line_reader_process(line_reader_t *lr, char ch)
+{
+    line_reader_process_buffer(lr, (const uint8_t *)&ch, 1);
+}
+
+void line_reader_process_buffer(line_reader_t *lr, const uint8_t *data, size_t len)
+{
+    nonnull(lr, "lr");
+    _assert(data != NULL || len == 0, "data not NULL");
+
+    const uint8_t *end = data + len;
+    while (data < end)
+    {
+        const uint8_t *newline = memchr(data, '\n', end - data);
+        if (newline == NULL)
+            break;
+
+        if (lr->buf_pos == 0 && !lr->invalid)
+            line_reader_emit(lr, data, newline - data);
+        else
+        {
+            // Only the first line of a block can complete a stored fragment, so the storage is
+            // not reused before the batch is delivered
+            line_reader_append(lr, data, newline - data);
+            if (!lr->invalid)
+                line_reader_emit(lr, line_reader_storage(lr), lr->buf_pos);
+            lr->buf_pos = 0;
+            lr->invalid = false;
+        }
+        data = newline + 1;
     }
+
+    line_reader_flush(lr);
+    if (data < end)
+        line_reader_append(lr, data, end - data);
 }
@@ -0,0 +1,145 @@
+#include "resample.h"
+#include "common.h"
+#include "dsp.h"
+#include <math.h>
+#include <string.h>
+
+#define RESAMPLER_CUTOFF 0.42f // Of the lower rate, leaving room for the transition band
+#define RESAMPLER_KAISER_BETA 8.0
+
+static int resampler_gcd(int a, int b)
+{
+    while (b)
+    {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static double resampler_bessel_i0(double x)
+{
+    double sum = 1, term = 1;
+    for (int k = 1; k < 32; k++)
+    {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+// Kaiser windowed sinc at in_rate * up, dealt out to the phases so that phase p holds taps
+// p, p + up, p + 2 up, ... in reverse
+static void resampler_design(resampler_t *rs, int length)
+{
+    double fc = RESAMPLER_CUTOFF * min(rs->in_rate, rs->out_rate) / ((double)rs->in_rate * rs->up);
+    double center = (length - 1) / 2.0, sum = 0;
+    for (int i = 0; i < length; i++)
+    {
+        double t = i - center;
+        double r = 2 * t / (length - 1);
+        double window = resampler_bessel_i0(RESAMPLER_KAISER_BETA * sqrt(fmax(0, 1 - r * r))) /
+                        resampler_bessel_i0(RESAMPLER_KAISER_BETA);
+        double h = window * (t == 0 ? 2 * fc : sin(2 * M_PI * fc * t) / (M_PI * t));
+        rs->bank[(i % rs->up) * rs->taps + rs->taps - 1 - i / rs->up] = h;
+        sum += h;
+    }
+
+    // Unity gain at DC through every phase
+    for (int i = 0; i < rs->up * rs->taps; i++)
+        rs->bank[i] *= rs->up / sum;
+}
+
+int resampler_init(resampler_t *rs, int in_rate, int out_rate)
+{
+    nonnull(rs, "rs");
+
+    if (in_rate <= 0 || out_rate <= 0)
+        return -RESAMPLER_INVALID_RATE;
+
+    int gcd = resampler_gcd(in_rate, out_rate);
+    if (out_rate / gcd > RESAMPLER_MAX_PHASES)
+        return -RESAMPLER_INVALID_RATE;
+
+    memset(rs, 0, sizeof(*rs));
+    rs->in_rate = in_rate;
+    rs->out_rate = out_rate;
+    rs->up = out_rate / gcd;
+    rs->down = in_rate / gcd;
+
+    // Decimating narrows the passband relative to the input, so the filter grows with it
+    int taps = (int)ceil(RESAMPLER_TAPS * fmax(1, (double)rs->down / rs->up));
+    rs->taps = dsp_pad4(taps);
+    rs->bank = dsp_alloc_floats(rs->up * rs->taps);
+    rs->raw = dsp_alloc_floats(rs->taps - 1 + RESAMPLER_CHUNK);
+    if (!rs->bank || !rs->raw)
+    {
+        resampler_free(rs);
+        return -RESAMPLER_NOMEM;
+    }
+
+    resampler_design(rs, taps * rs->up);
+    return 0;
+}
+
+void resampler_free(resampler_t *rs)
+{
+    nonnull(rs, "rs");
+
+    free(rs->bank);
+    free(rs->raw);
+    rs->bank = rs->raw = NULL;
+}
+
+int resampler_samples(const resampler_t *rs, int in_samples)
+{
+    nonnull(rs, "rs");
+    nonnegative(in_samples, "in_samples");
+
+    return (int)((int64_t)in_samples * rs->up / rs->down) + 1;
+}
+
+int resampler_process(resampler_t *rs, const float_buffer_t *in_buf, float_buffer_t *out_buf)
+{
+    nonnull(rs, "rs");
+    assert_buffer_valid(in_buf);
+    assert_buffer_valid(out_buf);
+
+    if (resampler_samples(rs, in_buf->size) > out_buf->capacity)
+        return -RESAMPLER_BUF_TOO_SMALL;
+
+    int hist = rs->taps - 1;
+    int step = rs->down / rs->up;
+    int step_phase = rs->down % rs->up;
+    float *raw = rs->raw;
+    float *out = out_buf->data;
+    int count = 0;
+
+    int phase = rs->phase;
+    int next = rs->next;
+    for (int pos = 0; pos < in_buf->size; pos += RESAMPLER_CHUNK)
+    {
+        int n = min(RESAMPLER_CHUNK, in_buf->size - pos);
+        memcpy(&raw[hist], &in_buf->data[pos], n * sizeof(float));
+
+        for (; next < n; next += step)
+        {
+            out[count++] = dsp_dot(&raw[next], &rs->bank[phase * rs->taps], rs->taps);
+            phase += step_phase;
+            if (phase >= rs->up)
+            {
+                phase -= rs->up;
+                next++;
+            }
+        }
+        next -= n;
+
+        memmove(raw, &raw[n], hist * sizeof(float));
+    }
+    rs->phase = phase;
+    rs->next = next;
+
+    out_buf->size = count;
+    return count;
+}
@@ -1,41 +1,84 @@
 #include "tnc2.h"
 #include "common.h"
 #include <string.h>
-#include <stdio.h>
-#include <ctype.h>
 #include <limits.h>
 
-int tnc2_addr_to_string(const ax25_addr_t *addr, buffer_t *out_buf)
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Longest valid header, 10 addresses like "CALLSN-15*" and their separators, fits in the block
+#define TNC2_HEADER_BLOCK_LEN 128
+
+// SSID suffixes, so formatting needs no integer conversion
+static const char tnc2_ssid_text[16][4] = {
+    "", "-1", "-2", "-3", "-4", "-5", "-6", "-7", "-8", "-9", "-10", "-11", "-12", "-13", "-14", "-15"};
+static const uint8_t tnc2_ssid_len[16] = {0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3};
+
+static inline int tnc2_callsign_len(const ax25_addr_t *addr)
 {
-    nonnull(addr, "addr");
-    assert_buffer_valid(out_buf);
+    const char *pad = memchr(addr->callsign, AX25_ADDR_PAD, AX25_ADDR_MAX_CALLSIGN_LEN);
+    return pad ? pad - addr->callsign : AX25_ADDR_MAX_CALLSIGN_LEN;
+}
 
-    int len = 0;
-    for (int i = 0; i < AX25_ADDR_MAX_CALLSIGN_LEN; i++)
-    {
-        char c = addr->callsign[i];
-        if (c == AX25_ADDR_PAD)
-            break;
-        if (!buf_has_capacity_ge(out_buf, len + 1))
-            return -1;
-        out_buf->data[len++] = c;
-    }
-    if (addr->ssid)
-    {
-        int remaining = out_buf->capacity - len;
-        int n = snprintf((char *)out_buf->data + len, remaining, "-%d", addr->ssid);
-        if (n >= remaining)
-            return -1;
-        len += n;
-    }
+// Formatted length of an address, -1 when the SSID is out of range
+static inline int tnc2_addr_len(const ax25_addr_t *addr)
+{
+    if ((unsigned)addr->ssid > 15)
+        return -1;
+    return tnc2_callsign_len(addr) + tnc2_ssid_len[addr->ssid] + (addr->repeated ? 1 : 0);
+}
+
+static inline uint8_t *tnc2_addr_write(const ax25_addr_t *addr, uint8_t *p)
+{
+    int len = tnc2_callsign_len(addr);
+    memcpy(p, addr->callsign, len);
+    p += len;
+    memcpy(p, tnc2_ssid_text[addr->ssid], tnc2_ssid_len[addr->ssid]);
+    p += tnc2_ssid_len[addr->ssid];
     if (addr->repeated)
+        *p++ = '*';
+    return p;
+}
+
+static uint8_t *tnc2_packet_write(const ax25_packet_t *packet, uint8_t *p)
+{
+    p = tnc2_addr_write(&packet->source, p);
+    *p++ = '>';
+    p = tnc2_addr_write(&packet->destination, p);
+    for (int i = 0; i < packet->path_len; i++)
     {
-        if (!buf_has_capacity_ge(out_buf, len + 1))
-            return -1;
-        out_buf->data[len++] = '*';
+        *p++ = ',';
+        p = tnc2_addr_write(&packet->path[i], p);
     }
-    if (buf_has_capacity_ge(out_buf, len + 1))
-        out_buf->data[len] = '\0';
+    *p++ = ':';
+    memcpy(p, packet->info, packet->info_len);
+    return p + packet->info_len;
+}
+
+// ASCII only, unlike isalnum() these do not depend on the locale
+static inline bool tnc2_is_digit(uint8_t c)
+{
+    return (uint8_t)(c - '0') < 10;
+}
+
+static inline bool tnc2_is_alnum(uint8_t c)
+{
+    return tnc2_is_digit(c) || (uint8_t)((c | 0x20) - 'a') < 26;
+}
+
+int tnc2_addr_to_string(const ax25_addr_t *addr, buffer_t *out_buf)
+{
+    nonnull(addr, "addr");
+    assert_buffer_valid(out_buf);
+
+    // A lone address is always terminated
+    int len = tnc2_addr_len(addr);
+    if (len < 0 || out_buf->capacity < len + 1)
+        return -1;
+
+    tnc2_addr_write(addr, out_buf->data);
+    out_buf->data[len] = '\0';
     out_buf->size = len;
     return len;
 }
@@ -59,7 +102,7 @@ int tnc2_string_to_addr(ax25_addr_t *addr, const buffer_t *buf)
             return -1;
         if (c == '-' || c == '*' || c == ',' || c == '>' || c == ':')
             break;
-        if (!isalnum(c))
+        if (!tnc2_is_alnum(c))
             return -1;
         addr->callsign[callsign_len++] = c;
         pos++;
@@ -73,7 +116,7 @@ int tnc2_string_to_addr(ax25_addr_t *addr, const buffer_t *buf)
         pos++;
         int ssid = 0;
         int has_digit = 0;
-        while (pos < buf->size && isdigit((unsigned char)buf->data[pos]))
+        while (pos < buf->size && tnc2_is_digit(buf->data[pos]))
         {
             int digit = buf->data[pos] - '0';
             if (ssid > (15 - digit) / 10)
@@ -96,58 +139,161 @@ int tnc2_string_to_addr(ax25_addr_t *addr, const buffer_t *buf)
     return (int)pos;
 }
 
-int tnc2_packet_to_string(const ax25_packet_t *packet, buffer_t *out_buf)
+int tnc2_packet_string_len(const ax25_packet_t *packet)
 {
     nonnull(packet, "packet");
-    assert_buffer_valid(out_buf);
-
-    int pos = 0;
 
-    buffer_t addr_buf = {
-        .data = &out_buf->data[pos],
-        .capacity = out_buf->capacity - pos,
-        .size = 0};
-    int n = tnc2_addr_to_string(&packet->source, &addr_buf);
-    if (n < 0)
+    if (packet->path_len > AX25_MAX_PATH_LEN)
         return -1;
-    pos += n;
 
-    if (!buf_has_capacity_ge(out_buf, pos + 1))
-        return -1;
-    out_buf->data[pos++] = '>';
-
-    for (int i = -1; i < (int)packet->path_len; i++)
+    // Separators: '>', one ',' per digipeater and ':'
+    int len = 2 + packet->path_len + packet->info_len;
+    for (int i = -2; i < packet->path_len; i++)
     {
-        if (i >= 0)
-        {
-            if (!buf_has_capacity_ge(out_buf, pos + 1))
-                return -1;
-            out_buf->data[pos++] = ',';
-        }
-        const ax25_addr_t *addr = (i == -1) ? &packet->destination : &packet->path[i];
-        addr_buf.data = &out_buf->data[pos];
-        addr_buf.capacity = out_buf->capacity - pos;
-        addr_buf.size = 0;
-        n = tnc2_addr_to_string(addr, &addr_buf);
+        const ax25_addr_t *addr = i == -2 ? &packet->source : i == -1 ? &packet->destination : &packet->path[i];
+        int n = tnc2_addr_len(addr);
         if (n < 0)
             return -1;
-        pos += n;
+        len += n;
     }
+    return len;
+}
 
-    if (!buf_has_capacity_ge(out_buf, pos + 1))
-        return -1;
-    out_buf->data[pos++] = ':';
+int tnc2_packet_to_string(const ax25_packet_t *packet, buffer_t *out_buf)
+{
+    nonnull(packet, "packet");
+    assert_buffer_valid(out_buf);
 
-    if (!buf_has_capacity_ge(out_buf, pos + packet->info_len))
+    int len = tnc2_packet_string_len(packet);
+    if (len < 0 || out_buf->capacity < len)
         return -1;
-    memcpy(&out_buf->data[pos], packet->info, packet->info_len);
-    pos += packet->info_len;
 
-    if (buf_has_capacity_ge(out_buf, pos + 1))
-        out_buf->data[pos] = '\0';
-    out_buf->size = pos;
+    tnc2_packet_write(packet, out_buf->data);
+    if (out_buf->capacity > len)
+        out_buf->data[len] = '\0';
+    out_buf->size = len;
+    return len;
+}
+
+int tnc2_packets_to_lines(const ax25_packet_t *const *packets, int count, buffer_t *out_buf)
+{
+    nonnull(packets, "packets");
+    assert_buffer_valid(out_buf);
 
-    return pos;
+    int i = 0;
+    for (; i < count; i++)
+    {
+        int len = tnc2_packet_string_len(packets[i]);
+        if (len < 0 || out_buf->capacity - out_buf->size < len + 1)
+            break;
+        uint8_t *p = tnc2_packet_write(packets[i], &out_buf->data[out_buf->size]);
+        *p = '\n';
+        out_buf->size += len + 1;
+    }
+    return i;
+}
+
+// Bitmaps over the header block: bit i of word i / 64 is set for byte i
+typedef struct tnc2_header_scan
+{
+    uint64_t colon[2];
+    uint64_t greater[2];
+    uint64_t comma[2];
+    uint64_t invalid[2]; // Not allowed in an address or between addresses
+} tnc2_header_scan_t;
+
+#if defined(__SSE2__)
+
+static inline __m128i tnc2_in_range(__m128i v, char lo, char hi)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+}
+
+static void tnc2_header_scan(const uint8_t *block, tnc2_header_scan_t *scan)
+{
+    memset(scan, 0, sizeof(*scan));
+    for (int i = 0; i < TNC2_HEADER_BLOCK_LEN; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(block + i));
+        __m128i colon = _mm_cmpeq_epi8(v, _mm_set1_epi8(':'));
+        __m128i greater = _mm_cmpeq_epi8(v, _mm_set1_epi8('>'));
+        __m128i comma = _mm_cmpeq_epi8(v, _mm_set1_epi8(','));
+
+        // Bytes above 0x7f are negative and fall outside every range
+        __m128i valid = _mm_or_si128(tnc2_in_range(v, '0', '9'), tnc2_in_range(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z'));
+        valid = _mm_or_si128(valid, _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('-')), _mm_cmpeq_epi8(v, _mm_set1_epi8('*'))));
+        valid = _mm_or_si128(valid, _mm_or_si128(greater, comma));
+
+        int word = i / 64, shift = i % 64;
+        scan->colon[word] |= (uint64_t)(uint16_t)_mm_movemask_epi8(colon) << shift;
+        scan->greater[word] |= (uint64_t)(uint16_t)_mm_movemask_epi8(greater) << shift;
+        scan->comma[word] |= (uint64_t)(uint16_t)_mm_movemask_epi8(comma) << shift;
+        scan->invalid[word] |= (uint64_t)(uint16_t)~_mm_movemask_epi8(valid) << shift;
+    }
+}
+
+#else
+
+static void tnc2_header_scan(const uint8_t *block, tnc2_header_scan_t *scan)
+{
+    memset(scan, 0, sizeof(*scan));
+    for (int i = 0; i < TNC2_HEADER_BLOCK_LEN; i++)
+    {
+        uint8_t c = block[i];
+        uint64_t bit = 1ULL << (i % 64);
+        if (c == ':')
+            scan->colon[i / 64] |= bit;
+        else if (c == '>')
+            scan->greater[i / 64] |= bit;
+        else if (c == ',')
+            scan->comma[i / 64] |= bit;
+        else if (!tnc2_is_alnum(c) && c != '-' && c != '*')
+            scan->invalid[i / 64] |= bit;
+    }
+}
+
+#endif
+
+// Index of the lowest set bit of a 128-bit map, -1 if none
+static inline int tnc2_first_bit(const uint64_t *bits)
+{
+    if (bits[0])
+        return __builtin_ctzll(bits[0]);
+    if (bits[1])
+        return 64 + __builtin_ctzll(bits[1]);
+    return -1;
+}
+
+// An address occupying a whole field: CALL, CALL-SSID, either followed by '*'. The header scan
+// has already limited the field to alphanumerics, '-' and '*'.
+static int tnc2_field_to_addr(ax25_addr_t *addr, const uint8_t *field, int len)
+{
+    addr->repeated = len > 0 && field[len - 1] == '*';
+    if (addr->repeated)
+        len--;
+
+    int callsign_len = 0;
+    while (callsign_len < len && tnc2_is_alnum(field[callsign_len]))
+        callsign_len++;
+    if (callsign_len == 0 || callsign_len > AX25_ADDR_MAX_CALLSIGN_LEN)
+        return -1;
+    memset(addr->callsign, AX25_ADDR_PAD, AX25_ADDR_MAX_CALLSIGN_LEN);
+    memcpy(addr->callsign, field, callsign_len);
+
+    addr->ssid = 0;
+    if (callsign_len == len)
+        return 0;
+    if (field[callsign_len] != '-' || callsign_len + 1 == len)
+        return -1;
+    for (int i = callsign_len + 1; i < len; i++)
+    {
+        if (!tnc2_is_digit(field[i]))
+            return -1;
+        addr->ssid = addr->ssid * 10 + field[i] - '0';
+        if (addr->ssid > 15)
+            return -1;
+    }
+    return 0;
 }
 
 int tnc2_string_to_packet(ax25_packet_t *packet, const buffer_t *buf)
@@ -155,60 +301,159 @@ int tnc2_string_to_packet(ax25_packet_t *packet, const buffer_t *buf)
     nonnull(packet, "packet");
     assert_buffer_valid(buf);
 
-    ax25_packet_init(packet);
+    ax25_packet_reset(packet);
 
-    size_t pos = 0;
+    // Zero padded so that vector loads stay within the block
+    uint8_t block[TNC2_HEADER_BLOCK_LEN];
+    int block_len = min(buf->size, TNC2_HEADER_BLOCK_LEN);
+    memset(block + block_len, 0, TNC2_HEADER_BLOCK_LEN - block_len);
+    memcpy(block, buf->data, block_len);
 
-    buffer_t addr_buf = {
-        .data = &buf->data[pos],
-        .capacity = buf->size - pos,
-        .size = buf->size - pos};
-    int n = tnc2_string_to_addr(&packet->source, &addr_buf);
-    if (n <= 0)
-        return -1;
-    pos += n;
+    tnc2_header_scan_t scan;
+    tnc2_header_scan(block, &scan);
 
-    if (pos >= buf->size || buf->data[pos] != '>')
+    // The header ends at the first ':', everything before it must be addresses and separators
+    int colon = tnc2_first_bit(scan.colon);
+    if (colon < 0)
+        return -1;
+    uint64_t header[2] = {
+        colon >= 64 ? ~0ULL : (1ULL << colon) - 1,
+        colon >= 64 ? (1ULL << (colon - 64)) - 1 : 0};
+    for (int w = 0; w < 2; w++)
+    {
+        scan.invalid[w] &= header[w];
+        scan.greater[w] &= header[w];
+        scan.comma[w] &= header[w];
+    }
+    if (scan.invalid[0] | scan.invalid[1])
         return -1;
-    pos++;
 
-    addr_buf.data = &buf->data[pos];
-    addr_buf.capacity = buf->size - pos;
-    addr_buf.size = buf->size - pos;
-    n = tnc2_string_to_addr(&packet->destination, &addr_buf);
-    if (n <= 0)
+    // Exactly one '>', ahead of any ','
+    int greater = tnc2_first_bit(scan.greater);
+    int comma = tnc2_first_bit(scan.comma);
+    if (greater < 0 || __builtin_popcountll(scan.greater[0]) + __builtin_popcountll(scan.greater[1]) != 1 ||
+        (comma >= 0 && comma < greater))
+        return -1;
+    if (__builtin_popcountll(scan.comma[0]) + __builtin_popcountll(scan.comma[1]) > AX25_MAX_PATH_LEN)
         return -1;
-    pos += n;
 
-    packet->path_len = 0;
+    if (tnc2_field_to_addr(&packet->source, block, greater))
+        return -1;
 
-    while (pos < buf->size && buf->data[pos] == ',')
+    int start = greater + 1;
+    ax25_addr_t *addr = &packet->destination;
+    while (comma >= 0)
     {
-        pos++;
-        if (packet->path_len >= AX25_MAX_PATH_LEN)
-            return -1;
-
-        addr_buf.data = &buf->data[pos];
-        addr_buf.capacity = buf->size - pos;
-        addr_buf.size = buf->size - pos;
-        n = tnc2_string_to_addr(&packet->path[packet->path_len], &addr_buf);
-        if (n <= 0)
+        if (tnc2_field_to_addr(addr, &block[start], comma - start))
             return -1;
-        pos += n;
-        packet->path_len++;
+        addr = &packet->path[packet->path_len++];
+        start = comma + 1;
+        scan.comma[comma / 64] &= ~(1ULL << (comma % 64));
+        comma = tnc2_first_bit(scan.comma);
     }
-
-    if (pos >= buf->size || buf->data[pos] != ':')
+    if (tnc2_field_to_addr(addr, &block[start], colon - start))
         return -1;
-    pos++;
 
-    size_t info_len = buf->size - pos;
-    if (info_len > AX25_MAX_INFO_LEN)
+    int pos = colon + 1;
+    int info_len = buf->size - pos;
+    if (info_len > packet->info_capacity)
         return -1;
 
     if (info_len > 0)
         memcpy(packet->info, &buf->data[pos], info_len);
-    packet->info_len = (uint16_t)info_len;
+    packet->info_len = info_len;
 
     return 0;
 }
+
+static inline bool tnc2_is_q_construct(const tnc2_span_t *span)
+{
+    return span->len == 3 && span->data[0] == 'q' && span->data[1] >= 'A' && span->data[1] <= 'Z' &&
+           tnc2_is_alnum(span->data[2]);
+}
+
+// Non-empty and printable, without the separators
+static inline bool tnc2_view_field_valid(const tnc2_span_t *span)
+{
+    if (span->len == 0)
+        return false;
+    for (int i = 0; i < span->len; i++)
+    {
+        uint8_t c = span->data[i];
+        if (c <= ' ' || c >= 0x7f || c == '>')
+            return false;
+    }
+    return true;
+}
+
+int tnc2_view_parse(tnc2_view_t *view, const uint8_t *data, int len)
+{
+    nonnull(view, "view");
+    _assert(data != NULL || len == 0, "data not NULL");
+
+    if (len <= 0)
+        return -1;
+    const uint8_t *colon = memchr(data, ':', len);
+    if (colon == NULL)
+        return -1;
+    int header_len = colon - data;
+    const uint8_t *greater = memchr(data, '>', header_len);
+    if (greater == NULL)
+        return -1;
+
+    view->header = (tnc2_span_t){data, header_len};
+    view->source = (tnc2_span_t){data, greater - data};
+    if (memchr(data, ',', view->source.len) || !tnc2_view_field_valid(&view->source))
+        return -1;
+
+    view->path_len = 0;
+    view->q_index = -1;
+    view->q_construct = (tnc2_span_t){NULL, 0};
+    view->q_gate = (tnc2_span_t){NULL, 0};
+
+    const uint8_t *p = greater + 1;
+    tnc2_span_t *field = &view->destination;
+    for (;;)
+    {
+        const uint8_t *comma = memchr(p, ',', colon - p);
+        *field = (tnc2_span_t){p, (comma ? comma : colon) - p};
+        if (!tnc2_view_field_valid(field))
+            return -1;
+        if (field != &view->destination && view->q_index < 0 && tnc2_is_q_construct(field))
+        {
+            view->q_index = view->path_len - 1;
+            view->q_construct = *field;
+        }
+        if (comma == NULL)
+            break;
+        if (view->path_len == TNC2_VIEW_MAX_PATH)
+            return -1;
+        field = &view->path[view->path_len++];
+        p = comma + 1;
+    }
+    if (view->q_index >= 0 && view->q_index + 1 < view->path_len)
+        view->q_gate = view->path[view->q_index + 1];
+
+    view->info = (tnc2_span_t){colon + 1, len - header_len - 1};
+    view->third_party = view->info.len > 0 && view->info.data[0] == '}';
+    if (view->third_party)
+        view->inner = (tnc2_span_t){view->info.data + 1, view->info.len - 1};
+    else
+        view->inner = (tnc2_span_t){NULL, 0};
+
+    return 0;
+}
+
+bool tnc2_span_equal(const tnc2_span_t *span, const char *str)
+{
+    nonnull(span, "span");
+    nonnull(str, "str");
+
+    size_t len = strlen(str);
+    return (size_t)span->len == len && memcmp(span->data, str, len) == 0;
+}
+
+ax25_packet_t *tnc2_string_to_pool_packet(ax25_pool_cache_t *cache, const buffer_t *buf)
+{
+    return ax25_pool_decode(cache, tnc2_string_to_packet, buf);
+}
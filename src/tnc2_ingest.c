@@ -0,0 +1,270 @@
+#include "tnc2_ingest.h"
+#include "tnc2.h"
+#include "common.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define TNC2_INGEST_MAX_THREADS 256
+
+typedef struct tnc2_ingest_job
+{
+    const uint8_t *data;
+    size_t len;
+    size_t chunk_size;
+    uint64_t chunk_count;
+    bool ordered;
+    tnc2_ingest_sink_t *sink;
+    void *ctx;
+
+    atomic_uint_fast64_t next_chunk;
+    atomic_bool failed;
+
+    // Ordered delivery: the worker holding chunk n waits until n chunks were delivered
+    pthread_mutex_t lock;
+    pthread_cond_t turn;
+    uint64_t delivered;
+} tnc2_ingest_job_t;
+
+typedef struct tnc2_ingest_worker
+{
+    tnc2_ingest_job_t *job;
+    int index;
+    pthread_t thread;
+
+    // Arena reused for every chunk: packets and the info bytes they point to
+    ax25_packet_t *packets;
+    int packet_capacity;
+    uint8_t *info;
+    size_t info_capacity;
+
+    tnc2_ingest_stats_t stats;
+} tnc2_ingest_worker_t;
+
+void tnc2_ingest_config_init(tnc2_ingest_config_t *config)
+{
+    nonnull(config, "config");
+
+    config->threads = 0;
+    config->chunk_size = 1 << 20;
+    config->ordered = false;
+}
+
+// A line belongs to the chunk its first byte falls in
+static size_t tnc2_ingest_chunk_start(const tnc2_ingest_job_t *job, uint64_t chunk)
+{
+    if (chunk == 0)
+        return 0;
+    size_t pos = chunk * job->chunk_size - 1;
+    if (pos >= job->len)
+        return job->len;
+    const uint8_t *newline = memchr(&job->data[pos], '\n', job->len - pos);
+    return newline ? (size_t)(newline - job->data) + 1 : job->len;
+}
+
+// Parses the lines in [start, end) into the worker's arena, returns the packet count or -1
+static int tnc2_ingest_parse(tnc2_ingest_worker_t *worker, size_t start, size_t end)
+{
+    const uint8_t *data = worker->job->data;
+
+    // Info fields are never longer than the chunk
+    if (worker->info_capacity < end - start)
+    {
+        uint8_t *info = realloc(worker->info, end - start);
+        if (info == NULL)
+            return -1;
+        worker->info = info;
+        worker->info_capacity = end - start;
+    }
+
+    int count = 0;
+    size_t info_used = 0;
+    for (size_t pos = start; pos < end;)
+    {
+        const uint8_t *newline = memchr(&data[pos], '\n', end - pos);
+        size_t line_end = newline ? (size_t)(newline - data) : end;
+        size_t len = line_end - pos;
+        if (len > 0 && data[line_end - 1] == '\r')
+            len--;
+
+        if (len > 0)
+        {
+            worker->stats.lines++;
+            if (count == worker->packet_capacity)
+            {
+                int capacity = max(64, worker->packet_capacity * 2);
+                ax25_packet_t *packets = realloc(worker->packets, capacity * sizeof(ax25_packet_t));
+                if (packets == NULL)
+                    return -1;
+                worker->packets = packets;
+                worker->packet_capacity = capacity;
+            }
+
+            ax25_packet_t *packet = &worker->packets[count];
+            ax25_packet_init(packet, &worker->info[info_used], min(len, UINT16_MAX));
+            buffer_t line = {.data = (unsigned char *)&data[pos], .capacity = len, .size = len};
+            if (len <= INT_MAX && tnc2_string_to_packet(packet, &line) == 0)
+            {
+                info_used += packet->info_len;
+                count++;
+            }
+            else
+                worker->stats.errors++;
+        }
+        pos = line_end + 1;
+    }
+
+    worker->stats.packets += count;
+    return count;
+}
+
+static void tnc2_ingest_deliver(tnc2_ingest_worker_t *worker, uint64_t chunk, int count)
+{
+    tnc2_ingest_job_t *job = worker->job;
+    if (!job->ordered)
+    {
+        if (count > 0)
+            job->sink(job->ctx, worker->index, chunk, worker->packets, count);
+        return;
+    }
+
+    pthread_mutex_lock(&job->lock);
+    while (job->delivered != chunk)
+        pthread_cond_wait(&job->turn, &job->lock);
+    if (count > 0 && !atomic_load(&job->failed))
+        job->sink(job->ctx, worker->index, chunk, worker->packets, count);
+    job->delivered++;
+    pthread_cond_broadcast(&job->turn);
+    pthread_mutex_unlock(&job->lock);
+}
+
+static void *tnc2_ingest_run(void *arg)
+{
+    tnc2_ingest_worker_t *worker = arg;
+    tnc2_ingest_job_t *job = worker->job;
+
+    for (;;)
+    {
+        uint64_t chunk = atomic_fetch_add(&job->next_chunk, 1);
+        if (chunk >= job->chunk_count)
+            break;
+
+        // After a failure chunks are still claimed and passed on, so ordered workers never wait
+        // for a chunk nobody will deliver
+        int count = 0;
+        if (!atomic_load(&job->failed))
+        {
+            count = tnc2_ingest_parse(worker, tnc2_ingest_chunk_start(job, chunk), tnc2_ingest_chunk_start(job, chunk + 1));
+            if (count < 0)
+            {
+                atomic_store(&job->failed, true);
+                count = 0;
+            }
+        }
+        tnc2_ingest_deliver(worker, chunk, count);
+    }
+    return NULL;
+}
+
+int tnc2_ingest_buffer(const uint8_t *data, size_t len, const tnc2_ingest_config_t *config,
+                       tnc2_ingest_sink_t *sink, void *ctx, tnc2_ingest_stats_t *out_stats)
+{
+    _assert(data != NULL || len == 0, "data not NULL");
+    nonnull(config, "config");
+    nonnull(sink, "sink");
+    nonzero(config->chunk_size, "chunk_size");
+    nonnegative(config->threads, "threads");
+
+    tnc2_ingest_job_t job = {
+        .data = data,
+        .len = len,
+        .chunk_size = config->chunk_size,
+        .chunk_count = (len + config->chunk_size - 1) / config->chunk_size,
+        .ordered = config->ordered,
+        .sink = sink,
+        .ctx = ctx,
+    };
+    atomic_init(&job.next_chunk, 0);
+    atomic_init(&job.failed, false);
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.turn, NULL);
+
+    int threads = config->threads ? config->threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    threads = max(1, min(min(threads, TNC2_INGEST_MAX_THREADS), (int)min(job.chunk_count, (uint64_t)INT_MAX)));
+
+    tnc2_ingest_worker_t *workers = calloc(threads, sizeof(tnc2_ingest_worker_t));
+    if (workers == NULL)
+        return -TNC2_INGEST_NOMEM;
+
+    // The calling thread is worker 0
+    int started = 1;
+    for (int i = 0; i < threads; i++)
+    {
+        workers[i].job = &job;
+        workers[i].index = i;
+    }
+    for (; started < threads; started++)
+        if (pthread_create(&workers[started].thread, NULL, tnc2_ingest_run, &workers[started]))
+            break;
+    tnc2_ingest_run(&workers[0]);
+
+    tnc2_ingest_stats_t stats = {0};
+    for (int i = 0; i < threads; i++)
+    {
+        if (i > 0 && i < started)
+            pthread_join(workers[i].thread, NULL);
+        stats.lines += workers[i].stats.lines;
+        stats.packets += workers[i].stats.packets;
+        stats.errors += workers[i].stats.errors;
+        free(workers[i].packets);
+        free(workers[i].info);
+    }
+    free(workers);
+    pthread_mutex_destroy(&job.lock);
+    pthread_cond_destroy(&job.turn);
+
+    if (out_stats != NULL)
+        *out_stats = stats;
+    return atomic_load(&job.failed) ? -TNC2_INGEST_NOMEM : 0;
+}
+
+int tnc2_ingest_file(const char *path, const tnc2_ingest_config_t *config,
+                     tnc2_ingest_sink_t *sink, void *ctx, tnc2_ingest_stats_t *out_stats)
+{
+    nonnull(path, "path");
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -TNC2_INGEST_IO;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+    {
+        close(fd);
+        return -TNC2_INGEST_IO;
+    }
+
+    size_t len = st.st_size;
+    void *data = NULL;
+    if (len > 0)
+    {
+        data = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            close(fd);
+            return -TNC2_INGEST_IO;
+        }
+        madvise(data, len, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    int ret = tnc2_ingest_buffer(data, len, config, sink, ctx, out_stats);
+    if (data != NULL)
+        munmap(data, len);
+    return ret;
+}
@@ -0,0 +1,260 @@
+#ifndef LINK_SIM_H
+#define LINK_SIM_H
+
+#include "ax25_link.h"
+#include "common.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LINK_SIM_MAX_FRAMES 1024
+#define LINK_SIM_MAX_DATA 32768
+#define LINK_SIM_TXDELAY_MS 100
+#define LINK_SIM_BAUD 9600
+#define LINK_SIM_FRAMING_BITS 48 // FCS and flags
+
+typedef struct link_sim link_sim_t;
+
+typedef struct link_sim_end
+{
+    link_sim_t *sim;
+    int index;
+} link_sim_end_t;
+
+typedef struct link_sim_frame
+{
+    uint64_t at;
+    int to;
+    int size;
+    uint8_t data[AX25_PACKET_LEN_FOR(256) + 1];
+} link_sim_frame_t;
+
+// Two stations sharing a half duplex channel that loses frames at random
+struct link_sim
+{
+    ax25_link_t links[2];
+    link_sim_end_t ends[2];
+    link_sim_frame_t frames[LINK_SIM_MAX_FRAMES];
+    int frame_count;
+    uint64_t now;
+    uint64_t channel_free;
+    uint64_t tx_done[2]; // When the last frame of each station is off the air, 0 when idle
+    uint32_t rng;
+    int baud;
+    int loss_permille;
+    double ber;
+    uint32_t busy_period_ms; // Other stations hold the channel busy_ms out of every busy_period_ms
+    uint32_t busy_ms;
+    int sent;
+    int dropped;
+    uint8_t received[2][LINK_SIM_MAX_DATA];
+    int received_len[2];
+    int events[2][4];
+};
+
+static uint32_t link_sim_random(link_sim_t *sim)
+{
+    sim->rng ^= sim->rng << 13;
+    sim->rng ^= sim->rng >> 17;
+    sim->rng ^= sim->rng << 5;
+    return sim->rng;
+}
+
+static void link_sim_output(void *ctx, const buffer_t *frame)
+{
+    link_sim_end_t *end = ctx;
+    link_sim_t *sim = end->sim;
+
+    // Frames queue behind whatever is on the air, keying up costs TXDELAY
+    uint64_t start = sim->now >= sim->channel_free ? sim->now + LINK_SIM_TXDELAY_MS : sim->channel_free;
+    if (sim->busy_period_ms && start % sim->busy_period_ms < sim->busy_ms)
+        start += sim->busy_ms - start % sim->busy_period_ms + LINK_SIM_TXDELAY_MS;
+
+    int bits = frame->size * 8 + LINK_SIM_FRAMING_BITS;
+    sim->channel_free = start + (uint64_t)bits * 1000 / sim->baud;
+    sim->tx_done[end->index] = sim->channel_free;
+    sim->sent++;
+
+    bool lost = (int)(link_sim_random(sim) % 1000) < sim->loss_permille;
+    if (sim->ber > 0)
+        lost |= link_sim_random(sim) / 4294967296.0 < 1 - pow(1 - sim->ber, bits);
+    if (lost || sim->frame_count == LINK_SIM_MAX_FRAMES)
+    {
+        sim->dropped++;
+        return;
+    }
+
+    link_sim_frame_t *f = &sim->frames[sim->frame_count++];
+    f->at = sim->channel_free;
+    f->to = 1 - end->index;
+    f->size = frame->size;
+    memcpy(f->data, frame->data, frame->size);
+}
+
+static void link_sim_receive(void *ctx, const uint8_t *data, int len)
+{
+    link_sim_end_t *end = ctx;
+    link_sim_t *sim = end->sim;
+    int n = min(len, LINK_SIM_MAX_DATA - sim->received_len[end->index]);
+    memcpy(&sim->received[end->index][sim->received_len[end->index]], data, n);
+    sim->received_len[end->index] += n;
+}
+
+static void link_sim_event(void *ctx, ax25_link_event_e event)
+{
+    link_sim_end_t *end = ctx;
+    end->sim->events[end->index][event]++;
+}
+
+static void link_sim_init(link_sim_t *sim, const ax25_link_config_t *a, const ax25_link_config_t *b, int loss_permille)
+{
+    memset(sim, 0, sizeof(*sim));
+    sim->rng = 0x2545f491;
+    sim->now = 1000;
+    sim->baud = LINK_SIM_BAUD;
+    sim->loss_permille = loss_permille;
+
+    ax25_addr_t calls[2];
+    ax25_addr_init_with(&calls[0], "N0CALL", 1, false);
+    ax25_addr_init_with(&calls[1], "N0CALL", 2, false);
+    const ax25_link_config_t *configs[2] = {a, b};
+    for (int i = 0; i < 2; i++)
+    {
+        ax25_link_config_t config = *configs[i];
+        config.tx_complete = true;
+        sim->ends[i].sim = sim;
+        sim->ends[i].index = i;
+        ax25_link_init(&sim->links[i], &calls[i], &calls[1 - i], &config,
+                       link_sim_output, link_sim_receive, link_sim_event, &sim->ends[i]);
+    }
+}
+
+static void link_sim_free(link_sim_t *sim)
+{
+    ax25_link_free(&sim->links[0]);
+    ax25_link_free(&sim->links[1]);
+}
+
+// Advances simulated time to until, delivering frames and running timers on the way
+static void link_sim_run(link_sim_t *sim, uint64_t until)
+{
+    while (sim->now < until)
+    {
+        uint64_t next = 0;
+        for (int i = 0; i < sim->frame_count; i++)
+            if (next == 0 || sim->frames[i].at < next)
+                next = sim->frames[i].at;
+        for (int i = 0; i < 2; i++)
+        {
+            uint64_t deadline = ax25_link_next_deadline(&sim->links[i]);
+            if (deadline && (next == 0 || deadline < next))
+                next = deadline;
+            if (sim->tx_done[i] && (next == 0 || sim->tx_done[i] < next))
+                next = sim->tx_done[i];
+        }
+        if (next == 0 || next > until)
+        {
+            sim->now = until;
+            break;
+        }
+        sim->now = max(sim->now, next);
+
+        for (int i = 0; i < 2; i++)
+        {
+            if (sim->tx_done[i] && sim->tx_done[i] <= sim->now)
+            {
+                sim->tx_done[i] = 0;
+                ax25_link_transmitted(&sim->links[i], sim->now);
+            }
+        }
+
+        // Deliver in arrival order, frames sent meanwhile are appended
+        for (int i = 0; i < sim->frame_count;)
+        {
+            if (sim->frames[i].at > sim->now)
+            {
+                i++;
+                continue;
+            }
+            link_sim_frame_t frame = sim->frames[i];
+            memmove(&sim->frames[i], &sim->frames[i + 1], (sim->frame_count - i - 1) * sizeof(link_sim_frame_t));
+            sim->frame_count--;
+
+            buffer_t buf = {.data = frame.data, .capacity = frame.size, .size = frame.size};
+            ax25_link_receive(&sim->links[frame.to], &buf, sim->now);
+            i = 0;
+        }
+        ax25_link_tick(&sim->links[0], sim->now);
+        ax25_link_tick(&sim->links[1], sim->now);
+    }
+}
+
+#define LINK_TRANSFER_LEN 16384
+#define LINK_TRANSFER_LIMIT_MS 20000000
+
+static void link_transfer_data(uint8_t *data)
+{
+    for (int i = 0; i < LINK_TRANSFER_LEN; i++)
+        data[i] = i * 7 + (i >> 8);
+}
+
+// Connects and moves a bulk transfer from station 0 to 1, returns the milliseconds it took
+static uint64_t link_sim_transfer(link_sim_t *sim, const uint8_t *data)
+{
+    uint64_t started = sim->now;
+    ax25_link_connect(&sim->links[0], sim->now);
+    int queued = 0;
+    while (sim->received_len[1] < LINK_TRANSFER_LEN && sim->now < LINK_TRANSFER_LIMIT_MS &&
+           sim->events[0][AX25_LINK_EVENT_FAILED] == 0)
+    {
+        queued += ax25_link_send(&sim->links[0], data + queued, LINK_TRANSFER_LEN - queued, sim->now);
+        link_sim_run(sim, sim->now + 100);
+    }
+    return sim->now - started;
+}
+
+typedef struct link_scenario
+{
+    const char *name;
+    int baud;
+    int loss_permille;
+    double ber;
+    uint32_t busy_period_ms;
+    uint32_t busy_ms;
+} link_scenario_t;
+
+#define LINK_SCENARIOS 7
+
+static const link_scenario_t link_scenarios[LINK_SCENARIOS] = {
+    {"clean 9600", 9600, 0, 0, 0, 0},
+    {"clean 1200", 1200, 0, 0, 0, 0},
+    {"5% loss 9600", 9600, 50, 0, 0, 0},
+    {"ber 1e-4 9600", 9600, 0, 1e-4, 0, 0},
+    {"ber 3e-4 1200", 1200, 0, 3e-4, 0, 0},
+    {"busy 40% 9600", 9600, 0, 0, 5000, 2000},
+    {"busy + ber 9600", 9600, 20, 1e-4, 5000, 2000},
+};
+
+// Goodput in bytes per second of a bulk transfer, 0 if the data did not get through intact
+static double link_goodput(const ax25_link_config_t *config, const link_scenario_t *scenario, ax25_link_t *out_link)
+{
+    link_sim_t *sim = malloc(sizeof(link_sim_t));
+    link_sim_init(sim, config, config, scenario->loss_permille);
+    sim->baud = scenario->baud;
+    sim->ber = scenario->ber;
+    sim->busy_period_ms = scenario->busy_period_ms;
+    sim->busy_ms = scenario->busy_ms;
+
+    uint8_t data[LINK_TRANSFER_LEN];
+    link_transfer_data(data);
+    uint64_t elapsed = link_sim_transfer(sim, data);
+
+    bool intact = sim->received_len[1] == LINK_TRANSFER_LEN && memcmp(sim->received[1], data, LINK_TRANSFER_LEN) == 0;
+    if (out_link != NULL)
+        *out_link = sim->links[0];
+    link_sim_free(sim);
+    free(sim);
+    return intact ? LINK_TRANSFER_LEN * 1000.0 / elapsed : 0;
+}
+
+#endif
@@ -1,9 +1,23 @@
 #include "test.h"
 #include "test_ax25.h"
+#include "test_ax25_table.h"
+#include "test_ax25_pool.h"
 #include "test_tnc2.h"
 #include "test_hldc.h"
+#include "test_nrzi.h"
 #include "test_kiss.h"
 #include "test_line.h"
+#include "test_digi.h"
+#include "test_dedupe.h"
+#include "test_filter.h"
+#include "test_ax25_link.h"
+#include "test_ax25_seg.h"
+#include "test_tnc2_ingest.h"
+#include "test_conf.h"
+#include "test_afsk.h"
+#include "test_g3ruh.h"
+#include "test_resample.h"
+#include "test_channelizer.h"
 
 int main(void)
 {
@@ -20,6 +34,22 @@ int main(void)
     test_packet_init();
     test_packet_pack();
     test_packet_pack_unpack();
+    test_packet_addr_count();
+    test_packet_pack_unpack_full_path();
+    test_packet_info_capacity();
+    end_module();
+
+    begin_module("Packet Table");
+    test_ax25_addr_key();
+    test_ax25_table_unpack();
+    test_ax25_table_full();
+    end_module();
+
+    begin_module("Packet Pool");
+    test_pool_alloc_release();
+    test_pool_cache();
+    test_pool_decode();
+    test_pool_threads();
     end_module();
 
     begin_module("TNC2");
@@ -41,15 +71,28 @@ int main(void)
     test_tnc2_edge_case_mixed_valid_invalid_chars();
     test_tnc2_edge_case_boundary_digits();
     test_tnc2_edge_case_callsign_padding();
+    test_tnc2_info_capacity();
+    test_tnc2_format_ssids();
+    test_tnc2_packets_to_lines();
+    test_tnc2_header_limits();
+    test_tnc2_view_third_party();
+    test_tnc2_ingest_ordered();
+    test_tnc2_ingest_unordered();
     end_module();
 
     begin_module("HLDC");
     test_hldc_framer_init();
     test_hldc_framer_flag_scaling();
     test_hldc_framer_bit_stuffing();
+    test_hldc_back_to_back();
     test_hldc_deframer_init();
     end_module();
 
+    begin_module("NRZI");
+    test_nrzi_words_exhaustive();
+    test_nrzi_words_stream();
+    end_module();
+
     begin_module("KISS");
     test_kiss_decoder_init();
     test_kiss_decoder_empty_frames();
@@ -72,6 +115,75 @@ int main(void)
     test_lr_multiple_lines();
     test_lr_binary_data();
     test_lr_line_too_long();
+    test_lr_buffer_views();
+    test_lr_buffer_matches_bytes();
+    test_lr_context_batches();
+    end_module();
+
+    begin_module("Digipeater");
+    test_digi_wide();
+    test_digi_trace_and_alias();
+    test_digi_preempt();
+    test_digi_fcs_patch();
+    end_module();
+
+    begin_module("Dedupe");
+    test_dedupe_hash();
+    test_dedupe_window();
+    test_dedupe_bounded();
+    end_module();
+
+    begin_module("Filter");
+    test_filter_compile();
+    test_filter_callsigns();
+    test_filter_types();
+    test_filter_range();
+    test_filter_many();
+    test_filter_remove_replace();
+    end_module();
+
+    begin_module("Connected Mode");
+    test_link_xid_negotiation();
+    test_link_connect_failures();
+    test_link_transfer_clean();
+    test_link_transfer_lossy_modulo8();
+    test_link_transfer_lossy_srej();
+    test_link_adaptive_estimates();
+    test_link_adaptive_goodput();
+    end_module();
+
+    begin_module("Segmentation");
+    test_seg_split_join();
+    test_seg_reassembly_errors();
+    end_module();
+
+    begin_module("Config");
+    test_conf_load();
+    test_conf_many_entries();
+    test_conf_live_reclaim();
+    test_conf_live_concurrent();
+    end_module();
+
+    begin_module("AFSK");
+    test_afsk_modulator_tones();
+    test_afsk_modulator_continuity();
+    test_afsk_demodulator_loopback();
+    test_afsk_slicer_ensemble();
+    end_module();
+
+    begin_module("G3RUH");
+    test_g3ruh_scrambler();
+    test_g3ruh_modem_loopback();
+    end_module();
+
+    begin_module("Resampler");
+    test_resample_rates();
+    test_resample_afsk();
+    end_module();
+
+    begin_module("Channelizer");
+    test_channelizer_tones();
+    test_channelizer_receiver();
     end_module();
 
     int failed = end_suite();
@@ -0,0 +1,300 @@
+#ifndef TEST_AFSK_H
+#define TEST_AFSK_H
+
+#include "test.h"
+#include <math.h>
+#include <string.h>
+#include "afsk.h"
+#include "hldc.h"
+
+// Power of one frequency in the samples (Goertzel)
+static float afsk_test_power(const float *samples, int n, float hz, int sample_rate)
+{
+    float coeff = 2 * cosf(2 * M_PI * hz / sample_rate);
+    float s1 = 0, s2 = 0;
+    for (int i = 0; i < n; i++)
+    {
+        float s = samples[i] + coeff * s1 - s2;
+        s2 = s1;
+        s1 = s;
+    }
+    return (s1 * s1 + s2 * s2 - coeff * s1 * s2) / n;
+}
+
+void test_afsk_modulator_tones()
+{
+    const int rates[] = {8000, 11025, 22050, 44100, 48000};
+    static uint8_t bits[AFSK_BAUD];
+    static float samples[48000];
+    buffer_t bits_buf = {.data = bits, .capacity = sizeof(bits), .size = sizeof(bits)};
+    float_buffer_t out = {.data = samples, .capacity = 48000, .size = 0};
+
+    for (int r = 0; r < 5; r++)
+    {
+        afsk_modulator_t mod;
+        assert_equal_int(afsk_modulator_init(&mod, rates[r], 0.5f), 0, "init");
+
+        // One second of bits is one second of samples, whatever the samples per bit
+        for (int level = 0; level <= 1; level++)
+        {
+            memset(bits, level, sizeof(bits));
+            assert_equal_int(afsk_modulator_samples(&mod, sizeof(bits)), rates[r], "sample count");
+            assert_equal_int(afsk_modulator_process(&mod, &bits_buf, &out), rates[r], "one second");
+            float mark = afsk_test_power(samples, out.size, AFSK_MARK_HZ, rates[r]);
+            float space = afsk_test_power(samples, out.size, AFSK_SPACE_HZ, rates[r]);
+            assert_true(level ? mark > 1000 * space : space > 1000 * mark, "tone for level");
+        }
+    }
+
+    afsk_modulator_t mod;
+    assert_equal_int(afsk_modulator_init(&mod, 4000, 1), -AFSK_INVALID_RATE, "rate too low");
+}
+
+void test_afsk_modulator_continuity()
+{
+    // A framed packet in uneven blocks is phase continuous and matches modulating it whole
+    uint8_t frame[64];
+    for (int i = 0; i < (int)sizeof(frame); i++)
+        frame[i] = i * 37;
+    uint8_t bits_data[2048];
+    buffer_t frame_buf = {.data = frame, .capacity = sizeof(frame), .size = sizeof(frame)};
+    buffer_t bits_buf = {.data = bits_data, .capacity = sizeof(bits_data), .size = 0};
+    hldc_framer_t framer;
+    hldc_framer_init(&framer, 8, 2);
+    hldc_framer_process(&framer, &frame_buf, &bits_buf, NULL);
+
+    static float whole[2048 * 40], parts[2048 * 40];
+    afsk_modulator_t mod;
+    afsk_modulator_init(&mod, 44100, 1);
+    float_buffer_t out = {.data = whole, .capacity = 2048 * 40, .size = 0};
+    int total = afsk_modulator_process(&mod, &bits_buf, &out);
+    assert_true(total > 0, "modulated");
+
+    afsk_modulator_init(&mod, 44100, 1);
+    int pos = 0;
+    for (int start = 0, len = 1; start < bits_buf.size; start += len, len = len % 13 + 1)
+    {
+        buffer_t part = {.data = &bits_data[start], .capacity = min(len, bits_buf.size - start), .size = min(len, bits_buf.size - start)};
+        float_buffer_t part_out = {.data = &parts[pos], .capacity = 2048 * 40 - pos, .size = 0};
+        pos += afsk_modulator_process(&mod, &part, &part_out);
+    }
+    assert_equal_int(pos, total, "same length in blocks");
+    assert_memory(parts, whole, total * sizeof(float), "same samples in blocks");
+
+    // No jumps larger than the highest tone allows
+    float limit = 2 * M_PI * AFSK_SPACE_HZ / 44100 * 1.01f;
+    float worst = 0;
+    for (int i = 1; i < total; i++)
+        worst = fmaxf(worst, fabsf(whole[i] - whole[i - 1]));
+    assert_true(worst <= limit, "phase continuous");
+
+    // 16 bit output follows the float samples
+    static int16_t pcm[2048 * 40];
+    afsk_modulator_init(&mod, 44100, 1);
+    assert_equal_int(afsk_modulator_process_s16(&mod, &bits_buf, pcm, 10), -AFSK_BUF_TOO_SMALL, "s16 too small");
+    assert_equal_int(afsk_modulator_process_s16(&mod, &bits_buf, pcm, 2048 * 40), total, "s16 length");
+    int off = 0;
+    for (int i = 0; i < total; i++)
+        if (fabsf(pcm[i] - whole[i] * INT16_MAX) > 1)
+            off++;
+    assert_equal_int(off, 0, "s16 matches float");
+
+    out.capacity = 10;
+    out.size = 0;
+    assert_equal_int(afsk_modulator_process(&mod, &bits_buf, &out), -AFSK_BUF_TOO_SMALL, "too small");
+}
+
+typedef struct afsk_test_channel
+{
+    uint32_t seed;
+    float noise;      // Peak of uniform noise added to each sample
+    float mark_gain;  // Tone twist, as with pre-emphasized audio
+    float space_gain;
+} afsk_test_channel_t;
+
+static float afsk_test_noise(afsk_test_channel_t *ch)
+{
+    ch->seed = ch->seed * 1664525 + 1013904223;
+    return ((ch->seed >> 8) / 16777216.0f * 2 - 1) * ch->noise;
+}
+
+// Uniform noise peak for a given Eb/N0 in dB with tones of the given amplitude
+static float afsk_test_ebn0(float amplitude, float db, int sample_rate)
+{
+    float eb = amplitude * amplitude / 2 / AFSK_BAUD;
+    float n0 = eb / powf(10, db / 10);
+    return sqrtf(3 * n0 * sample_rate / 2);
+}
+
+// Frames packets, modulates them back to back and returns the sample count
+static int afsk_test_render(afsk_test_channel_t *ch, int sample_rate, int packets, float *out, int capacity)
+{
+    afsk_modulator_t mark, space;
+    afsk_modulator_init(&mark, sample_rate, ch->mark_gain);
+    afsk_modulator_init(&space, sample_rate, ch->space_gain);
+    hldc_framer_t framer;
+    hldc_framer_init(&framer, 16, 4);
+
+    int total = 0;
+    for (int p = 0; p < packets; p++)
+    {
+        uint8_t frame[40];
+        for (int i = 0; i < (int)sizeof(frame); i++)
+            frame[i] = p * 31 + i * 7;
+        uint8_t bits_data[1024];
+        buffer_t frame_buf = {.data = frame, .capacity = sizeof(frame), .size = sizeof(frame)};
+        buffer_t bits_buf = {.data = bits_data, .capacity = sizeof(bits_data), .size = 0};
+        hldc_framer_process(&framer, &frame_buf, &bits_buf, NULL);
+
+        // Both modulators stay in step, each sample takes the gain of the tone being sent
+        for (int i = 0; i < bits_buf.size; i++)
+        {
+            buffer_t bit = {.data = &bits_data[i], .capacity = 1, .size = 1};
+            float_buffer_t m = {.data = &out[total], .capacity = capacity - total, .size = 0};
+            static float scratch[256];
+            float_buffer_t sp = {.data = scratch, .capacity = 256, .size = 0};
+            int n = afsk_modulator_process(&mark, &bit, &m);
+            afsk_modulator_process(&space, &bit, &sp);
+            if (n < 0)
+                return total;
+            if (!bits_data[i])
+                memcpy(&out[total], scratch, n * sizeof(float));
+            total += n;
+        }
+    }
+    for (int i = 0; i < total; i++)
+        out[i] += afsk_test_noise(ch);
+    return total;
+}
+
+// Demodulates in uneven blocks and counts the valid frames
+static int afsk_test_decode(const float *audio, int len, int sample_rate)
+{
+    afsk_demodulator_t demod;
+    afsk_demodulator_init(&demod, sample_rate);
+    hldc_deframer_t deframer;
+    hldc_deframer_init(&deframer);
+
+    int frames = 0;
+    uint8_t bits[1024];
+    uint8_t frame[512];
+    for (int pos = 0, block = 100; pos < len; pos += block, block = block % 700 + 97)
+    {
+        float_buffer_t in = {.data = (float *)&audio[pos], .capacity = min(block, len - pos), .size = min(block, len - pos)};
+        buffer_t out = {.data = bits, .capacity = sizeof(bits), .size = 0};
+        int n = afsk_demodulator_process(&demod, &in, &out);
+        for (int i = 0; i < n; i++)
+        {
+            buffer_t frame_buf = {.data = frame, .capacity = sizeof(frame), .size = 0};
+            hldc_deframer_process(&deframer, bits[i], &frame_buf, NULL);
+            if (frame_buf.size == 40)
+                frames++;
+        }
+    }
+    afsk_demodulator_free(&demod);
+    return frames;
+}
+
+void test_afsk_demodulator_loopback()
+{
+    const int rates[] = {8000, 11025, 22050, 44100, 48000};
+    static float audio[48000 * 40];
+
+    for (int r = 0; r < 5; r++)
+    {
+        afsk_test_channel_t clean = {.seed = 1, .noise = 0, .mark_gain = 0.5f, .space_gain = 0.5f};
+        int len = afsk_test_render(&clean, rates[r], 20, audio, 48000 * 40);
+        assert_equal_int(afsk_test_decode(audio, len, rates[r]), 20, "clean frames decoded");
+
+        afsk_test_channel_t noisy = {.seed = 2, .noise = afsk_test_ebn0(0.5f, 12, rates[r]), .mark_gain = 0.5f, .space_gain = 0.5f};
+        len = afsk_test_render(&noisy, rates[r], 50, audio, 48000 * 40);
+        assert_true(afsk_test_decode(audio, len, rates[r]) >= 45, "frames decoded at 12 dB Eb/N0");
+    }
+
+    // Level independent
+    afsk_test_channel_t quiet = {.seed = 3, .noise = 0.001f, .mark_gain = 0.005f, .space_gain = 0.005f};
+    int len = afsk_test_render(&quiet, 44100, 10, audio, 48000 * 40);
+    assert_equal_int(afsk_test_decode(audio, len, 44100), 10, "quiet frames decoded");
+
+    afsk_demodulator_t demod;
+    afsk_demodulator_init(&demod, 44100);
+    uint8_t bits[4];
+    buffer_t out = {.data = bits, .capacity = sizeof(bits), .size = 0};
+    float_buffer_t in = {.data = audio, .capacity = 1000, .size = 1000};
+    assert_equal_int(afsk_demodulator_process(&demod, &in, &out), -AFSK_BUF_TOO_SMALL, "bits too small");
+    afsk_demodulator_free(&demod);
+}
+
+typedef struct afsk_test_rx
+{
+    int frames;
+    int by_slicer[AFSK_MAX_SLICERS];
+    uint32_t decoded[AFSK_MAX_SLICERS];
+    uint8_t seen[256]; // By first byte, which tells the rendered packets apart
+    int duplicates;
+} afsk_test_rx_t;
+
+static void afsk_test_frame(void *ctx, const buffer_t *frame_buf, int slicer)
+{
+    afsk_test_rx_t *rx = ctx;
+    if (frame_buf->size == 40)
+    {
+        rx->frames++;
+        rx->by_slicer[slicer]++;
+        if (rx->seen[frame_buf->data[0]]++)
+            rx->duplicates++;
+    }
+}
+
+static int afsk_test_receive(const float *audio, int len, int sample_rate, int slicers, afsk_test_rx_t *out)
+{
+    afsk_receiver_t rx;
+    memset(out, 0, sizeof(*out));
+    assert_equal_int(afsk_receiver_init(&rx, sample_rate, slicers, afsk_test_frame, out), 0, "receiver init");
+    int delivered = 0;
+    for (int pos = 0; pos < len; pos += 1000)
+    {
+        float_buffer_t in = {.data = (float *)&audio[pos], .capacity = min(1000, len - pos), .size = min(1000, len - pos)};
+        delivered += afsk_receiver_process(&rx, &in);
+    }
+    assert_equal_int(delivered, out->frames, "delivered count");
+    memcpy(out->decoded, rx.decoded, sizeof(out->decoded));
+    afsk_receiver_free(&rx);
+    return out->frames;
+}
+
+void test_afsk_slicer_ensemble()
+{
+    static float audio[48000 * 40];
+    afsk_test_rx_t single, ensemble;
+
+    // Balanced tones: each frame reported once although most slicers decode it
+    afsk_test_channel_t flat = {.seed = 4, .noise = afsk_test_ebn0(0.5f, 14, 44100), .mark_gain = 0.5f, .space_gain = 0.5f};
+    int len = afsk_test_render(&flat, 44100, 40, audio, 48000 * 40);
+    afsk_test_receive(audio, len, 44100, 1, &single);
+    afsk_test_receive(audio, len, 44100, AFSK_MAX_SLICERS, &ensemble);
+    assert_true(ensemble.frames >= single.frames, "ensemble not worse");
+    assert_equal_int(ensemble.duplicates, 0, "duplicates suppressed");
+
+    // Twist either way, as from de-emphasized or pre-emphasized audio
+    const float twists[][2] = {{0.5f, 0.25f}, {0.25f, 0.5f}};
+    for (int t = 0; t < 2; t++)
+    {
+        afsk_test_channel_t twisted = {.seed = 5, .mark_gain = twists[t][0], .space_gain = twists[t][1]};
+        twisted.noise = afsk_test_ebn0(0.5f, 14, 44100);
+        len = afsk_test_render(&twisted, 44100, 40, audio, 48000 * 40);
+        afsk_test_receive(audio, len, 44100, 1, &single);
+        afsk_test_receive(audio, len, 44100, AFSK_MAX_SLICERS, &ensemble);
+        assert_true(ensemble.frames >= single.frames + 10, "ensemble decodes more with twist");
+        assert_equal_int(ensemble.duplicates, 0, "no duplicates with twist");
+
+        // The slicers weighing the weak tone up decode most
+        int best = 0;
+        for (int i = 1; i < AFSK_MAX_SLICERS; i++)
+            if (ensemble.decoded[i] > ensemble.decoded[best])
+                best = i;
+        assert_true(t == 0 ? best > AFSK_MAX_SLICERS / 2 : best < AFSK_MAX_SLICERS / 2, "slicer matches twist");
+    }
+}
+
+#endif
@@ -69,7 +69,8 @@ void test_addr_unpack()
 void test_packet_init()
 {
     ax25_packet_t packet;
-    ax25_packet_init(&packet);
+    uint8_t packet_info[AX25_MAX_INFO_LEN];
+    ax25_packet_init(&packet, packet_info, sizeof(packet_info));
     assert_memory(packet.source.callsign, "      ", 6, "packet init source");
     assert_memory(packet.destination.callsign, "      ", 6, "packet init dest");
     assert_equal_int(packet.path_len, 0, "init path_len");
@@ -81,7 +82,8 @@ void test_packet_init()
 void test_packet_pack()
 {
     ax25_packet_t packet;
-    ax25_packet_init(&packet);
+    uint8_t packet_info[AX25_MAX_INFO_LEN];
+    ax25_packet_init(&packet, packet_info, sizeof(packet_info));
     ax25_addr_init_with(&packet.source, "SRC", 1, 0);
     ax25_addr_init_with(&packet.destination, "DST", 2, 0);
     packet.path_len = 1;
@@ -97,7 +99,8 @@ void test_packet_pack_unpack()
 {
     // Create original packet
     ax25_packet_t original;
-    ax25_packet_init(&original);
+    uint8_t original_info[AX25_MAX_INFO_LEN];
+    ax25_packet_init(&original, original_info, sizeof(original_info));
     ax25_addr_init_with(&original.source, "SOURCE", 1, 0);
     ax25_addr_init_with(&original.destination, "DEST", 2, 0);
     original.path_len = 1;
@@ -117,6 +120,8 @@ void test_packet_pack_unpack()
 
     // Unpack
     ax25_packet_t unpacked;
+    uint8_t unpacked_info[AX25_MAX_INFO_LEN];
+    ax25_packet_init(&unpacked, unpacked_info, sizeof(unpacked_info));
     ax25_error_e unpack_result = ax25_packet_unpack(&unpacked, &buf);
     assert_equal_int(unpack_result, AX25_SUCCESS, "unpack success");
 
@@ -140,4 +145,124 @@ void test_packet_pack_unpack()
     assert_memory(unpacked.info, original.info, original.info_len, "info");
 }
 
+void test_packet_addr_count()
+{
+    ax25_packet_t packet;
+    uint8_t packet_info[AX25_MAX_INFO_LEN];
+    ax25_packet_init(&packet, packet_info, sizeof(packet_info));
+    ax25_addr_init_with(&packet.source, "SRC", 1, 0);
+    ax25_addr_init_with(&packet.destination, "DST", 2, 0);
+
+    uint8_t buf_data[AX25_MAX_PACKET_LEN];
+    buffer_t buf = {.data = buf_data, .capacity = sizeof(buf_data), .size = 0};
+
+    for (int path_len = 0; path_len <= AX25_MAX_PATH_LEN; path_len++)
+    {
+        packet.path_len = path_len;
+        for (int i = 0; i < path_len; i++)
+            ax25_addr_init_with(&packet.path[i], "WIDE", i, i % 2);
+        assert_equal_int(ax25_packet_pack(&packet, &buf), AX25_SUCCESS, "addr count pack");
+        assert_equal_int(ax25_addr_count(&buf), 2 + path_len, "addr count");
+    }
+
+    // No end-of-address bit at all: every available address is consumed
+    memset(buf_data, 'A' << 1, sizeof(buf_data));
+    buf.size = 3 * AX25_ADDR_LEN + 2;
+    assert_equal_int(ax25_addr_count(&buf), 3, "addr count without last bit");
+    buf.size = sizeof(buf_data);
+    assert_equal_int(ax25_addr_count(&buf), AX25_MAX_ADDR_COUNT, "addr count capped");
+
+    buf.size = AX25_ADDR_LEN;
+    assert_true(ax25_addr_count(&buf) < 0, "addr count too short");
+}
+
+void test_packet_pack_unpack_full_path()
+{
+    ax25_packet_t original, unpacked;
+    uint8_t original_info[AX25_MAX_INFO_LEN];
+    uint8_t unpacked_info[AX25_MAX_INFO_LEN];
+    ax25_packet_init(&original, original_info, sizeof(original_info));
+    ax25_packet_init(&unpacked, unpacked_info, sizeof(unpacked_info));
+    ax25_addr_init_with(&original.source, "N0CALL", 15, 0);
+    ax25_addr_init_with(&original.destination, "APRS", 0, 0);
+    original.path_len = AX25_MAX_PATH_LEN;
+    const char *digis[] = {"A", "BB", "CCC", "DDDD", "EEEEE", "FFFFFF", "WIDE1", "WIDE2"};
+    for (int i = 0; i < AX25_MAX_PATH_LEN; i++)
+        ax25_addr_init_with(&original.path[i], digis[i], i, i < 3);
+    memcpy(original.info, ">status", 7);
+    original.info_len = 7;
+
+    uint8_t buf_data[AX25_MAX_PACKET_LEN];
+    buffer_t buf = {.data = buf_data, .capacity = sizeof(buf_data), .size = 0};
+    assert_equal_int(ax25_packet_pack(&original, &buf), AX25_SUCCESS, "full path pack");
+    assert_equal_int(buf.size, ax25_packet_len(&original), "full path packed length");
+    assert_equal_int(buf.data[AX25_ADDR_LEN * 2 - 1] & 1, 0, "source not last");
+    assert_equal_int(buf.data[AX25_ADDR_LEN * AX25_MAX_ADDR_COUNT - 1] & 1, 1, "last digi marked last");
+
+    // Packed addresses match the single-address encoder
+    uint8_t addr_data[AX25_ADDR_LEN];
+    buffer_t addr_buf = {.data = addr_data, .capacity = sizeof(addr_data), .size = 0};
+    ax25_addr_pack(&original.path[3], &addr_buf);
+    assert_memory(&buf.data[5 * AX25_ADDR_LEN], addr_data, AX25_ADDR_LEN, "full path digi bytes");
+
+    assert_equal_int(ax25_packet_unpack(&unpacked, &buf), AX25_SUCCESS, "full path unpack");
+    assert_equal_int(unpacked.path_len, AX25_MAX_PATH_LEN, "full path len");
+    for (int i = 0; i < AX25_MAX_PATH_LEN; i++)
+    {
+        assert_memory(unpacked.path[i].callsign, original.path[i].callsign, 6, "full path callsign");
+        assert_equal_int(unpacked.path[i].ssid, i, "full path ssid");
+        assert_equal_int(unpacked.path[i].repeated, i < 3, "full path repeated");
+    }
+    assert_equal_int(unpacked.source.ssid, 15, "full path source ssid");
+    assert_equal_int(unpacked.info_len, 7, "full path info len");
+    assert_memory(unpacked.info, ">status", 7, "full path info");
+}
+
+void test_packet_info_capacity()
+{
+    static uint8_t large_info[1024];
+    static uint8_t small_info[32];
+    static uint8_t buf_data[AX25_PACKET_LEN_FOR(1024)];
+    ax25_packet_t large, small;
+    ax25_packet_init(&large, large_info, sizeof(large_info));
+    ax25_packet_init(&small, small_info, sizeof(small_info));
+    assert_equal_int(large.info_capacity, 1024, "init info capacity");
+
+    ax25_addr_init_with(&large.source, "SRC", 0, 0);
+    ax25_addr_init_with(&large.destination, "DST", 0, 0);
+    memset(large.info, 'X', 600);
+    large.info_len = 600;
+
+    buffer_t buf = {.data = buf_data, .capacity = sizeof(buf_data), .size = 0};
+    assert_equal_int(ax25_packet_pack(&large, &buf), AX25_SUCCESS, "pack beyond default info length");
+
+    ax25_packet_t unpacked;
+    uint8_t *unpacked_info = malloc(600);
+    ax25_packet_init(&unpacked, unpacked_info, 600);
+    assert_equal_int(ax25_packet_unpack(&unpacked, &buf), AX25_SUCCESS, "unpack into exact capacity");
+    assert_equal_int(unpacked.info_len, 600, "unpack not truncated");
+    assert_memory(unpacked.info, large.info, 600, "unpack large info");
+    free(unpacked_info);
+
+    assert_equal_int(ax25_packet_unpack(&small, &buf), -AX25_INFO_TOO_LARGE, "unpack rejects over capacity");
+
+    small.info_len = 33;
+    assert_equal_int(ax25_packet_pack(&small, &buf), -AX25_INFO_TOO_LARGE, "pack rejects over capacity");
+
+    ax25_packet_reset(&large);
+    assert_equal_int(large.info_len, 0, "reset info len");
+    assert_true(large.info == large_info && large.info_capacity == 1024, "reset keeps storage");
+
+    // Packets without an information field need no storage
+    ax25_packet_t empty;
+    ax25_packet_init(&empty, NULL, 0);
+    empty.source = large.source;
+    empty.destination = large.destination;
+    buf.size = 0;
+    assert_equal_int(ax25_packet_pack(&empty, &buf), AX25_SUCCESS, "pack without info storage");
+    empty.info_len = 1;
+    assert_equal_int(ax25_packet_unpack(&empty, &buf), AX25_SUCCESS, "unpack without info storage");
+    assert_equal_int(empty.info_len, 0, "empty info");
+}
+
 #endif
@@ -0,0 +1,173 @@
+#ifndef TEST_AX25_LINK_H
+#define TEST_AX25_LINK_H
+
+#include "test.h"
+#include <string.h>
+#include "link_sim.h"
+
+void test_link_xid_negotiation()
+{
+    ax25_link_config_t a, b;
+    ax25_link_config_init(&a);
+    ax25_link_config_init(&b);
+    b.paclen = 128;
+    b.window = 16;
+
+    link_sim_t *sim = malloc(sizeof(link_sim_t));
+    link_sim_init(sim, &a, &b, 0);
+    ax25_link_connect(&sim->links[0], sim->now);
+    link_sim_run(sim, sim->now + 10000);
+
+    for (int i = 0; i < 2; i++)
+    {
+        assert_equal_int(sim->links[i].state, AX25_LINK_CONNECTED, "link connected");
+        assert_equal_int(sim->links[i].modulus, 128, "modulo 128 agreed");
+        assert_true(sim->links[i].srej, "srej agreed");
+        assert_equal_int(sim->links[i].window, 16, "smaller window agreed");
+        assert_equal_int(sim->links[i].paclen, 128, "smaller paclen agreed");
+        assert_equal_int(sim->events[i][AX25_LINK_EVENT_CONNECTED], 1, "connected event");
+    }
+    link_sim_free(sim);
+
+    // Peer limited to modulo 8 without selective reject
+    b.modulo128 = false;
+    b.srej = false;
+    link_sim_init(sim, &a, &b, 0);
+    ax25_link_connect(&sim->links[0], sim->now);
+    link_sim_run(sim, sim->now + 10000);
+    assert_equal_int(sim->links[0].state, AX25_LINK_CONNECTED, "modulo 8 link connected");
+    assert_equal_int(sim->links[0].modulus, 8, "modulo 8 agreed");
+    assert_equal_int(sim->links[1].modulus, 8, "modulo 8 on peer");
+    assert_true(!sim->links[0].srej, "no srej");
+    assert_equal_int(sim->links[0].window, 7, "window limited by modulus");
+    link_sim_free(sim);
+
+    // Without XID, SABME to a modulo 8 station falls back to SABM
+    a.xid = false;
+    link_sim_init(sim, &a, &b, 0);
+    ax25_link_connect(&sim->links[0], sim->now);
+    link_sim_run(sim, sim->now + 10000);
+    assert_equal_int(sim->links[0].state, AX25_LINK_CONNECTED, "fallback link connected");
+    assert_equal_int(sim->links[0].modulus, 8, "fallback to modulo 8");
+    link_sim_free(sim);
+    free(sim);
+}
+
+void test_link_connect_failures()
+{
+    ax25_link_config_t a;
+    ax25_link_config_init(&a);
+    a.retries = 3;
+    a.xid = false;
+
+    link_sim_t *sim = malloc(sizeof(link_sim_t));
+    link_sim_init(sim, &a, &a, 1000); // Nothing gets through
+    ax25_link_connect(&sim->links[0], sim->now);
+    link_sim_run(sim, sim->now + 60000);
+    assert_equal_int(sim->links[0].state, AX25_LINK_DISCONNECTED, "gave up");
+    assert_equal_int(sim->events[0][AX25_LINK_EVENT_FAILED], 1, "failed event");
+    assert_equal_int(sim->sent, 4, "SABME sent 1 + N2 times");
+    link_sim_free(sim);
+
+    // Disconnect request answered with DM when not connected
+    link_sim_init(sim, &a, &a, 0);
+    assert_equal_int(ax25_link_disconnect(&sim->links[0], sim->now), -AX25_LINK_NOT_CONNECTED, "not connected");
+    link_sim_free(sim);
+    free(sim);
+}
+
+static void link_transfer(bool modulo128, bool srej, int loss_permille)
+{
+    ax25_link_config_t config;
+    ax25_link_config_init(&config);
+    config.modulo128 = modulo128;
+    config.srej = srej;
+    config.paclen = 128;
+    config.t1_ms = 10000;
+
+    link_sim_t *sim = malloc(sizeof(link_sim_t));
+    link_sim_init(sim, &config, &config, loss_permille);
+
+    uint8_t data[LINK_TRANSFER_LEN];
+    link_transfer_data(data);
+    link_sim_transfer(sim, data);
+
+    assert_equal_int(sim->received_len[1], sizeof(data), "all data received");
+    assert_true(memcmp(sim->received[1], data, sizeof(data)) == 0, "data received in order");
+    assert_equal_int(sim->events[0][AX25_LINK_EVENT_FAILED], 0, "link held up");
+    assert_true(loss_permille == 0 || sim->dropped > 0, "frames were lost");
+
+    while (ax25_link_pending(&sim->links[0]) > 0 && sim->now < LINK_TRANSFER_LIMIT_MS)
+        link_sim_run(sim, sim->now + 1000);
+    ax25_link_disconnect(&sim->links[0], sim->now);
+    link_sim_run(sim, sim->now + 60000);
+    assert_equal_int(sim->links[0].state, AX25_LINK_DISCONNECTED, "disconnected");
+    assert_equal_int(sim->links[1].state, AX25_LINK_DISCONNECTED, "peer disconnected");
+    assert_equal_int(sim->events[1][AX25_LINK_EVENT_DISCONNECTED], 1, "peer disconnect event");
+
+    link_sim_free(sim);
+    free(sim);
+}
+
+void test_link_transfer_clean()
+{
+    link_transfer(true, true, 0);
+}
+
+void test_link_transfer_lossy_modulo8()
+{
+    link_transfer(false, false, 100);
+}
+
+void test_link_transfer_lossy_srej()
+{
+    link_transfer(true, true, 100);
+    link_transfer(false, true, 200);
+}
+
+void test_link_adaptive_estimates()
+{
+    ax25_link_config_t config;
+    ax25_link_config_init(&config);
+    config.t1_ms = 30000;
+
+    // Round trip of a clean link is learned, T1 drops from its initial value
+    link_scenario_t clean = {"clean", 9600, 0, 0, 0, 0};
+    ax25_link_t link;
+    assert_true(link_goodput(&config, &clean, &link) > 0, "clean transfer");
+    assert_true(link.srtt > 0, "round trip measured");
+    assert_true(link.t1_ms < config.t1_ms && link.t1_ms >= config.t1_min_ms, "T1 follows the round trip");
+    assert_true(link.t1_ms > (uint32_t)(link.srtt >> 3), "T1 above the round trip");
+    assert_equal_int(link.paclen, config.paclen, "paclen stays at maximum");
+
+    // Bit errors make long frames unlikely to survive, paclen comes down
+    link_scenario_t noisy = {"noisy", 9600, 0, 2e-4, 0, 0};
+    assert_true(link_goodput(&config, &noisy, &link) > 0, "noisy transfer");
+    assert_true(link.paclen < config.paclen, "paclen reduced");
+    assert_true(link.paclen >= config.paclen_min, "paclen above minimum");
+}
+
+void test_link_adaptive_goodput()
+{
+    // No single FRACK suits every channel: a short one gives up on slow links and resends
+    // whole windows, a long one idles after every lost frame
+    ax25_link_config_t fast, slow, adaptive;
+    ax25_link_config_init(&fast);
+    fast.adaptive = false;
+    slow = fast;
+    slow.t1_ms = 15000;
+    ax25_link_config_init(&adaptive);
+
+    for (int i = 0; i < LINK_SCENARIOS; i++)
+    {
+        double fast_goodput = link_goodput(&fast, &link_scenarios[i], NULL);
+        double slow_goodput = link_goodput(&slow, &link_scenarios[i], NULL);
+        double adaptive_goodput = link_goodput(&adaptive, &link_scenarios[i], NULL);
+
+        assert_true(fast_goodput > 0 && slow_goodput > 0, "static T1 transfers complete");
+        assert_true(adaptive_goodput > 0, "adaptive transfer completes");
+        assert_true(adaptive_goodput >= 0.8 * max(fast_goodput, slow_goodput), "adaptive close to the better static T1");
+    }
+}
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef TEST_AX25_POOL_H
+#define TEST_AX25_POOL_H
+
+#include "test.h"
+#include <string.h>
+#include <pthread.h>
+#include "ax25_pool.h"
+#include "tnc2.h"
+
+#define POOL_TEST_THREADS 4
+#define POOL_TEST_ROUNDS 20000
+
+void test_pool_alloc_release()
+{
+    ax25_pool_t pool;
+    assert_equal_int(ax25_pool_init(&pool, 4, AX25_MAX_INFO_LEN), 0, "pool init");
+    assert_equal_int(ax25_pool_available(&pool), 4, "pool all available");
+
+    ax25_packet_t *packets[4];
+    for (int i = 0; i < 4; i++)
+        packets[i] = ax25_pool_alloc(&pool);
+    assert_true(packets[0] && packets[1] && packets[2] && packets[3], "pool alloc all");
+    assert_true(ax25_pool_alloc(&pool) == NULL, "pool exhausted");
+    assert_equal_int(packets[0]->control, 0x03, "pool packet initialized");
+    assert_equal_int(packets[0]->info_capacity, AX25_MAX_INFO_LEN, "pool packet info capacity");
+    assert_true(packets[1]->info >= packets[0]->info + AX25_MAX_INFO_LEN || packets[0]->info >= packets[1]->info + AX25_MAX_INFO_LEN, "pool info storage disjoint");
+    assert_equal_int(ax25_pool_refs(packets[0]), 1, "pool packet single ref");
+
+    // Shared by two consumers, returned after the last release
+    ax25_pool_retain(packets[0]);
+    assert_equal_int(ax25_pool_refs(packets[0]), 2, "pool retain");
+    ax25_pool_release(&pool, packets[0]);
+    assert_equal_int(ax25_pool_available(&pool), 0, "pool not returned while referenced");
+    ax25_pool_release(&pool, packets[0]);
+    assert_equal_int(ax25_pool_available(&pool), 1, "pool returned on last release");
+
+    assert_true(ax25_pool_alloc(&pool) == packets[0], "pool reuses entry");
+
+    ax25_pool_free(&pool);
+}
+
+void test_pool_cache()
+{
+    ax25_pool_t pool;
+    ax25_pool_init(&pool, 100, AX25_MAX_INFO_LEN);
+
+    ax25_pool_cache_t cache;
+    ax25_pool_cache_init(&cache, &pool);
+
+    ax25_packet_t *packets[100];
+    for (int i = 0; i < 100; i++)
+        packets[i] = ax25_pool_cache_alloc(&cache);
+    assert_true(packets[99] != NULL, "cache alloc whole pool");
+    assert_true(ax25_pool_cache_alloc(&cache) == NULL, "cache exhausted");
+
+    for (int i = 0; i < 100; i++)
+        ax25_pool_cache_release(&cache, packets[i]);
+    assert_true(cache.count <= AX25_POOL_CACHE_SIZE, "cache bounded");
+    assert_equal_int(ax25_pool_available(&pool) + cache.count, 100, "cache and pool hold all entries");
+
+    ax25_pool_cache_flush(&cache);
+    assert_equal_int(ax25_pool_available(&pool), 100, "cache flushed");
+
+    ax25_pool_free(&pool);
+}
+
+void test_pool_decode()
+{
+    ax25_pool_t pool;
+    ax25_pool_init(&pool, 2, AX25_MAX_INFO_LEN);
+    ax25_pool_cache_t cache;
+    ax25_pool_cache_init(&cache, &pool);
+
+    const char *str = "N0CALL>APRS,WIDE1-1:>hello";
+    buffer_t buf = {.data = (unsigned char *)str, .capacity = strlen(str), .size = strlen(str)};
+    ax25_packet_t *packet = tnc2_string_to_pool_packet(&cache, &buf);
+    assert_true(packet != NULL, "pool tnc2 decode");
+    assert_equal_int(packet->path_len, 1, "pool tnc2 path");
+
+    uint8_t frame_data[AX25_MAX_PACKET_LEN];
+    buffer_t frame = {.data = frame_data, .capacity = sizeof(frame_data), .size = 0};
+    ax25_packet_pack(packet, &frame);
+    ax25_packet_t *unpacked = ax25_pool_unpack(&cache, &frame);
+    assert_true(unpacked != NULL && unpacked != packet, "pool unpack");
+    assert_equal_int(unpacked->info_len, 6, "pool unpack info");
+
+    buf.size = 5;
+    ax25_pool_cache_release(&cache, unpacked);
+    assert_true(tnc2_string_to_pool_packet(&cache, &buf) == NULL, "pool decode failure");
+    assert_equal_int(cache.count, 1, "pool decode failure returns entry");
+
+    ax25_pool_cache_release(&cache, packet);
+    ax25_pool_cache_flush(&cache);
+    assert_equal_int(ax25_pool_available(&pool), 2, "pool decode all returned");
+    ax25_pool_free(&pool);
+}
+
+static ax25_pool_t pool_test_shared;
+
+static void *pool_test_worker(void *arg)
+{
+    ax25_pool_cache_t cache;
+    ax25_pool_cache_init(&cache, &pool_test_shared);
+    long failures = 0;
+
+    for (int i = 0; i < POOL_TEST_ROUNDS; i++)
+    {
+        ax25_packet_t *packet = (i % 2) ? ax25_pool_cache_alloc(&cache) : ax25_pool_alloc(&pool_test_shared);
+        if (packet == NULL)
+            continue;
+        packet->info_len = (uint16_t)(long)arg;
+        ax25_pool_retain(packet);
+        if (packet->info_len != (uint16_t)(long)arg)
+            failures++;
+        ax25_pool_release(&pool_test_shared, packet);
+        ax25_pool_cache_release(&cache, packet);
+    }
+
+    ax25_pool_cache_flush(&cache);
+    return (void *)failures;
+}
+
+void test_pool_threads()
+{
+    ax25_pool_init(&pool_test_shared, 64, 32);
+
+    pthread_t threads[POOL_TEST_THREADS];
+    for (long i = 0; i < POOL_TEST_THREADS; i++)
+        pthread_create(&threads[i], NULL, pool_test_worker, (void *)(i + 1));
+
+    long failures = 0;
+    for (int i = 0; i < POOL_TEST_THREADS; i++)
+    {
+        void *ret;
+        pthread_join(threads[i], &ret);
+        failures += (long)ret;
+    }
+
+    assert_equal_int(failures, 0, "pool threads no shared entries");
+    assert_equal_int(ax25_pool_available(&pool_test_shared), 64, "pool threads all returned");
+    ax25_pool_free(&pool_test_shared);
+}
+
+#endif
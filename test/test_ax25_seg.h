@@ -0,0 +1,170 @@
+#ifndef TEST_AX25_SEG_H
+#define TEST_AX25_SEG_H
+
+#include "test.h"
+#include <string.h>
+#include "ax25_seg.h"
+
+static void seg_test_header(ax25_packet_t *packet, const char *source)
+{
+    ax25_packet_reset(packet);
+    ax25_addr_init_with(&packet->source, source, 0, false);
+    ax25_addr_init_with(&packet->destination, "APRS", 0, false);
+    packet->control = 0x03;
+}
+
+// Packs the next segment into a frame and unpacks it again, as a receiver would see it
+static int seg_test_next(ax25_segmenter_t *seg, const char *source, ax25_packet_t *out_packet)
+{
+    uint8_t info[AX25_MAX_INFO_LEN];
+    ax25_packet_t header;
+    ax25_packet_init(&header, info, sizeof(info));
+    seg_test_header(&header, source);
+
+    uint8_t frame_data[AX25_MAX_PACKET_LEN];
+    buffer_t frame = {.data = frame_data, .capacity = sizeof(frame_data), .size = 0};
+    int ret = ax25_segmenter_pack(seg, &header, &frame);
+    if (ret <= 0)
+        return ret;
+    if (ax25_packet_unpack(out_packet, &frame))
+        return -100;
+    return ret;
+}
+
+void test_seg_split_join()
+{
+    uint8_t message[1000];
+    for (int i = 0; i < (int)sizeof(message); i++)
+        message[i] = i * 7;
+
+    ax25_segmenter_t seg;
+    assert_equal_int(ax25_segmenter_init(&seg, 0xf0, message, sizeof(message), AX25_MAX_INFO_LEN), 4, "segment count");
+
+    // Scatter output references the message
+    ax25_seg_iov_t iov[2];
+    assert_equal_int(ax25_segmenter_next(&seg, iov), AX25_MAX_INFO_LEN, "first segment full");
+    assert_equal_int(iov[0].len, 2, "first header with pid");
+    assert_equal_int(iov[0].data[0], AX25_SEG_FIRST | 3, "first header");
+    assert_equal_int(iov[0].data[1], 0xf0, "original pid");
+    assert_true(iov[1].data == message, "first slice not copied");
+    assert_equal_int(ax25_segmenter_next(&seg, iov), AX25_MAX_INFO_LEN, "second segment full");
+    assert_equal_int(iov[0].data[0], 2, "second header");
+    assert_true(iov[1].data == message + AX25_MAX_INFO_LEN - 2, "second slice follows");
+
+    ax25_reassembler_t reasm;
+    assert_equal_int(ax25_reassembler_init(&reasm, 4, 4096, 30000), 0, "reassembler init");
+
+    uint8_t info[AX25_MAX_INFO_LEN];
+    ax25_packet_t packet;
+    ax25_packet_init(&packet, info, sizeof(info));
+    ax25_seg_message_t out;
+
+    ax25_segmenter_init(&seg, 0xf0, message, sizeof(message), AX25_MAX_INFO_LEN);
+    int frames = 0, ret;
+    while ((ret = seg_test_next(&seg, "N0CALL", &packet)) > 0)
+    {
+        frames++;
+        assert_equal_int(packet.protocol, AX25_SEG_PID, "segment pid");
+        int done = ax25_reassembler_process(&reasm, &packet, 1000 * frames, &out);
+        assert_equal_int(done, frames == 4 ? 1 : 0, "complete after the last segment");
+    }
+    assert_equal_int(ret, 0, "segmenter drained");
+    assert_equal_int(frames, 4, "four frames");
+    assert_equal_int(out.len, sizeof(message), "reassembled length");
+    assert_equal_int(out.pid, 0xf0, "reassembled pid");
+    assert_memory(out.data, message, sizeof(message), "reassembled data");
+
+    // Short and empty messages still go as one segment
+    assert_equal_int(ax25_segmenter_init(&seg, 0xcc, message, 10, AX25_MAX_INFO_LEN), 1, "one segment");
+    seg_test_next(&seg, "N0CALL", &packet);
+    assert_equal_int(ax25_reassembler_process(&reasm, &packet, 0, &out), 1, "single segment complete");
+    assert_equal_int(out.len, 10, "single segment length");
+    assert_equal_int(ax25_segmenter_init(&seg, 0xcc, NULL, 0, AX25_MAX_INFO_LEN), 1, "empty message");
+    seg_test_next(&seg, "N0CALL", &packet);
+    assert_equal_int(ax25_reassembler_process(&reasm, &packet, 0, &out), 1, "empty message complete");
+    assert_equal_int(out.len, 0, "empty message length");
+
+    // At most 128 segments
+    static uint8_t big[128 * AX25_MAX_INFO_LEN];
+    int max_len = AX25_SEG_MAX_SEGMENTS * (AX25_MAX_INFO_LEN - 1) - 1;
+    assert_equal_int(ax25_segmenter_init(&seg, 0xf0, big, max_len, AX25_MAX_INFO_LEN), 128, "largest message");
+    assert_equal_int(ax25_segmenter_init(&seg, 0xf0, big, max_len + 1, AX25_MAX_INFO_LEN), -AX25_SEG_TOO_LARGE, "message too large");
+
+    ax25_reassembler_free(&reasm);
+}
+
+void test_seg_reassembly_errors()
+{
+    uint8_t message[500];
+    memset(message, 'x', sizeof(message));
+
+    uint8_t info[4][AX25_MAX_INFO_LEN];
+    ax25_packet_t packets[4];
+    for (int i = 0; i < 4; i++)
+        ax25_packet_init(&packets[i], info[i], sizeof(info[i]));
+
+    ax25_segmenter_t seg;
+    ax25_segmenter_init(&seg, 0xf0, message, sizeof(message), 128);
+    for (int i = 0; i < 4; i++)
+        seg_test_next(&seg, "N0CALL", &packets[i]);
+
+    ax25_reassembler_t reasm;
+    ax25_reassembler_init(&reasm, 2, 1024, 10000);
+    ax25_seg_message_t out;
+
+    // Duplicates are ignored, gaps drop the message
+    assert_equal_int(ax25_reassembler_process(&reasm, &packets[0], 0, &out), 0, "first");
+    assert_equal_int(ax25_reassembler_process(&reasm, &packets[0], 0, &out), 0, "first again restarts");
+    assert_equal_int(ax25_reassembler_process(&reasm, &packets[1], 0, &out), 0, "second");
+    assert_equal_int(ax25_reassembler_process(&reasm, &packets[1], 0, &out), 0, "duplicate ignored");
+    assert_equal_int(ax25_reassembler_process(&reasm, &packets[3], 0, &out), -AX25_SEG_OUT_OF_ORDER, "gap");
+    assert_equal_int(ax25_reassembler_process(&reasm, &packets[2], 0, &out), -AX25_SEG_OUT_OF_ORDER, "dropped after gap");
+
+    // Segments too far apart time out
+    ax25_reassembler_process(&reasm, &packets[0], 0, &out);
+    assert_equal_int(ax25_reassembler_process(&reasm, &packets[1], 9999, &out), 0, "within timeout");
+    assert_equal_int(ax25_reassembler_process(&reasm, &packets[2], 20000, &out), -AX25_SEG_OUT_OF_ORDER, "timed out");
+
+    // Stations are reassembled independently, the one idle longest gives way when slots run out
+    ax25_packet_t other[4];
+    uint8_t other_info[4][AX25_MAX_INFO_LEN];
+    for (int i = 0; i < 4; i++)
+        ax25_packet_init(&other[i], other_info[i], sizeof(other_info[i]));
+    ax25_segmenter_init(&seg, 0xf0, message, sizeof(message), 128);
+    for (int i = 0; i < 4; i++)
+        seg_test_next(&seg, "N1CALL", &other[i]);
+
+    ax25_reassembler_process(&reasm, &packets[0], 30000, &out);
+    ax25_reassembler_process(&reasm, &other[0], 30001, &out);
+    ax25_reassembler_process(&reasm, &packets[1], 30002, &out);
+    ax25_reassembler_process(&reasm, &other[1], 30003, &out);
+    ax25_reassembler_process(&reasm, &packets[2], 30004, &out);
+    ax25_reassembler_process(&reasm, &other[2], 30005, &out);
+    assert_equal_int(ax25_reassembler_process(&reasm, &packets[3], 30006, &out), 1, "interleaved complete");
+    assert_equal_int(out.len, sizeof(message), "interleaved length");
+    assert_memory(out.data, message, sizeof(message), "interleaved data");
+    assert_equal_int(ax25_reassembler_process(&reasm, &other[3], 30007, &out), 1, "other complete");
+    assert_true(out.source == ax25_addr_key(&other[0].source), "other source");
+
+    ax25_packet_t third = packets[0];
+    ax25_addr_init_with(&third.source, "N2CALL", 0, false);
+    ax25_reassembler_process(&reasm, &packets[0], 40000, &out);
+    ax25_reassembler_process(&reasm, &other[0], 40001, &out);
+    ax25_reassembler_process(&reasm, &third, 40002, &out);
+    assert_equal_int(ax25_reassembler_process(&reasm, &packets[1], 40003, &out), -AX25_SEG_OUT_OF_ORDER, "oldest evicted");
+    assert_equal_int(ax25_reassembler_process(&reasm, &other[1], 40004, &out), 0, "newer kept");
+
+    // Messages over the slot size are refused
+    ax25_reassembler_free(&reasm);
+    ax25_reassembler_init(&reasm, 1, 300, 10000);
+    ax25_reassembler_process(&reasm, &packets[0], 0, &out);
+    ax25_reassembler_process(&reasm, &packets[1], 0, &out);
+    assert_equal_int(ax25_reassembler_process(&reasm, &packets[2], 0, &out), -AX25_SEG_TOO_LARGE, "over max_len");
+
+    packets[0].protocol = 0xf0;
+    assert_equal_int(ax25_reassembler_process(&reasm, &packets[0], 0, &out), -AX25_SEG_MALFORMED, "not a segment");
+
+    ax25_reassembler_free(&reasm);
+}
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef TEST_AX25_TABLE_H
+#define TEST_AX25_TABLE_H
+
+#include "test.h"
+#include <string.h>
+#include "ax25.h"
+#include "ax25_table.h"
+
+#define TABLE_TEST_FRAMES 150
+
+static int table_test_pack(uint8_t *data, int capacity, const char *source, int ssid, const char *digi, const char *info)
+{
+    ax25_packet_t packet;
+    uint8_t packet_info[AX25_MAX_INFO_LEN];
+    ax25_packet_init(&packet, packet_info, sizeof(packet_info));
+    ax25_addr_init_with(&packet.source, source, ssid, 0);
+    ax25_addr_init_with(&packet.destination, "APRS", 0, 0);
+    if (digi)
+    {
+        packet.path_len = 2;
+        ax25_addr_init_with(&packet.path[0], digi, 0, 1);
+        ax25_addr_init_with(&packet.path[1], "WIDE2", 1, 0);
+    }
+    packet.info_len = strlen(info);
+    memcpy(packet.info, info, packet.info_len);
+
+    buffer_t buf = {.data = data, .capacity = capacity, .size = 0};
+    ax25_packet_pack(&packet, &buf);
+    return buf.size;
+}
+
+void test_ax25_addr_key()
+{
+    ax25_addr_t a, b;
+    ax25_addr_init_with(&a, "N0CALL", 9, 1);
+    uint64_t key = ax25_addr_key(&a);
+    ax25_addr_from_key(&b, key);
+    assert_memory(b.callsign, "N0CALL", 6, "key roundtrip callsign");
+    assert_equal_int(b.ssid, 9, "key roundtrip ssid");
+
+    uint8_t wire_data[AX25_ADDR_LEN];
+    buffer_t wire = {.data = wire_data, .capacity = sizeof(wire_data), .size = 0};
+    ax25_addr_pack(&a, &wire);
+    assert_true(ax25_addr_key_wire(wire_data) == key, "wire key equals addr key");
+
+    ax25_addr_init_with(&b, "N0CALM", 0, 0);
+    assert_true(ax25_addr_key(&b) > key, "keys ordered by callsign");
+    assert_true((ax25_addr_key(&a) & AX25_KEY_CALLSIGN_MASK) == (key & AX25_KEY_CALLSIGN_MASK), "callsign mask");
+}
+
+void test_ax25_table_unpack()
+{
+    static uint8_t data[TABLE_TEST_FRAMES][AX25_MAX_PACKET_LEN];
+    buffer_t frames[TABLE_TEST_FRAMES];
+    for (int i = 0; i < TABLE_TEST_FRAMES; i++)
+    {
+        const char *source = (i % 3 == 0) ? "N0CALL" : "OTHER";
+        const char *digi = (i % 5 == 0) ? "DIGI" : NULL;
+        frames[i].data = data[i];
+        frames[i].capacity = AX25_MAX_PACKET_LEN;
+        frames[i].size = table_test_pack(data[i], AX25_MAX_PACKET_LEN, source, i % 16, digi, "!4903.50N/07201.75W-");
+    }
+    frames[7].size = 10; // Malformed, skipped
+
+    ax25_table_t table;
+    assert_equal_int(ax25_table_init(&table, 256, 256 * 32), 0, "table init");
+    int consumed = ax25_table_unpack(&table, frames, TABLE_TEST_FRAMES);
+    assert_equal_int(consumed, TABLE_TEST_FRAMES, "table consumed all");
+    assert_equal_int(table.count, TABLE_TEST_FRAMES - 1, "table rows without malformed");
+
+    ax25_packet_t packet;
+    uint8_t packet_info[AX25_MAX_INFO_LEN];
+    ax25_packet_init(&packet, packet_info, sizeof(packet_info));
+    assert_equal_int(ax25_table_get(&table, 0, &packet), AX25_SUCCESS, "table get");
+    assert_memory(packet.source.callsign, "N0CALL", 6, "table get source");
+    assert_equal_int(packet.path_len, 2, "table get path len");
+    assert_equal_int(packet.path[0].repeated, 1, "table get path repeated");
+    assert_equal_int(packet.path[1].repeated, 0, "table get path not repeated");
+    assert_equal_int(packet.info_len, 20, "table get info len");
+    assert_memory(packet.info, "!4903.50N/07201.75W-", 20, "table get info");
+    assert_memory(ax25_table_info(&table, 5), "!4903.50N/07201.75W-", 20, "table info view");
+
+    ax25_addr_t addr;
+    ax25_addr_init_with(&addr, "N0CALL", 0, 0);
+    int rows[TABLE_TEST_FRAMES];
+    int n = ax25_table_select_source(&table, ax25_addr_key(&addr), AX25_KEY_CALLSIGN_MASK, rows, TABLE_TEST_FRAMES);
+    assert_equal_int(n, TABLE_TEST_FRAMES / 3, "select source any ssid");
+    assert_equal_int(rows[1], 3, "select source row order");
+
+    n = ax25_table_select_source(&table, ax25_addr_key(&addr), ~0ULL, rows, TABLE_TEST_FRAMES);
+    assert_equal_int(n, 4, "select source exact ssid");
+
+    n = ax25_table_select_source(&table, ax25_addr_key(&addr), AX25_KEY_CALLSIGN_MASK, rows, 4);
+    assert_equal_int(n, 4, "select limited by max rows");
+
+    ax25_addr_init_with(&addr, "DIGI", 0, 0);
+    n = ax25_table_select_path(&table, ax25_addr_key(&addr), ~0ULL, rows, TABLE_TEST_FRAMES);
+    assert_equal_int(n, TABLE_TEST_FRAMES / 5, "select path");
+
+    ax25_table_clear(&table);
+    assert_equal_int(table.count, 0, "table clear");
+    ax25_table_free(&table);
+}
+
+void test_ax25_table_full()
+{
+    uint8_t data[4][AX25_MAX_PACKET_LEN];
+    buffer_t frames[4];
+    for (int i = 0; i < 4; i++)
+    {
+        frames[i].data = data[i];
+        frames[i].capacity = AX25_MAX_PACKET_LEN;
+        frames[i].size = table_test_pack(data[i], AX25_MAX_PACKET_LEN, "SRC", 0, NULL, "0123456789");
+    }
+
+    ax25_table_t table;
+    ax25_table_init(&table, 3, 25);
+    assert_equal_int(ax25_table_unpack(&table, frames, 4), 2, "arena full stops unpack");
+    assert_equal_int(table.count, 2, "arena full rows");
+    ax25_table_free(&table);
+
+    ax25_table_init(&table, 3, 1000);
+    assert_equal_int(ax25_table_unpack(&table, frames, 4), 3, "table full stops unpack");
+    ax25_table_free(&table);
+}
+
+#endif
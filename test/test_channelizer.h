@@ -0,0 +1,197 @@
+#ifndef TEST_CHANNELIZER_H
+#define TEST_CHANNELIZER_H
+
+#include "test.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "channelizer.h"
+#include "hldc.h"
+
+// A tone at offset hz lands in its own channel at full level, shifted to the channel centre
+void test_channelizer_tones()
+{
+    const int channels = 8, rate = 100000, len = 20000;
+    static float iq[2 * 20000], out[2 * 8 * (20000 / 4 + 1)], parts[2 * 8 * (20000 / 4 + 1)];
+    float spacing = (float)rate / channels;
+
+    for (int k = 0; k < channels; k++)
+    {
+        double hz = (k < channels / 2 ? k : k - channels) * spacing + 0.2 * spacing;
+        for (int i = 0; i < len; i++)
+        {
+            double phase = 2 * M_PI * fmod(hz * i, rate) / rate;
+            iq[2 * i] = cos(phase);
+            iq[2 * i + 1] = sin(phase);
+        }
+
+        channelizer_t ch;
+        assert_equal_int(channelizer_init(&ch, channels), 0, "init");
+        float_buffer_t iq_buf = {.data = iq, .capacity = 2 * len, .size = 2 * len};
+        float_buffer_t out_buf = {.data = out, .capacity = sizeof(out) / sizeof(float), .size = 0};
+        int blocks = channelizer_process(&ch, &iq_buf, &out_buf);
+        assert_equal_int(blocks, len / (channels / 2), "block count");
+
+        // Power per channel after the filter settles, and the phase step in channel k
+        double power[8] = {0}, step_re = 0, step_im = 0;
+        for (int b = 100; b < blocks; b++)
+            for (int c = 0; c < channels; c++)
+            {
+                float re = out[(b * channels + c) * 2], im = out[(b * channels + c) * 2 + 1];
+                power[c] += (re * re + im * im) / (blocks - 100);
+                if (c == k)
+                {
+                    float last_re = out[((b - 1) * channels + c) * 2], last_im = out[((b - 1) * channels + c) * 2 + 1];
+                    step_re += re * last_re + im * last_im;
+                    step_im += im * last_re - re * last_im;
+                }
+            }
+        assert_true(fabs(power[k] - 1) < 0.02, "passband gain");
+        double worst = 0;
+        for (int c = 0; c < channels; c++)
+            if (c != k)
+                worst = fmax(worst, power[c]);
+        assert_true(worst < 1e-5, "other channels rejected");
+        float offset = atan2f(step_im, step_re) / (2 * M_PI) * 2 * spacing;
+        assert_true(fabsf(offset - 0.2f * spacing) < 1, "offset from centre");
+
+        // Blocks of any size give the same output
+        channelizer_free(&ch);
+        channelizer_init(&ch, channels);
+        int total = 0;
+        for (int pos = 0, n = 1; pos < len; pos += n, n = n % 1500 + 13)
+        {
+            int part = min(n, len - pos);
+            float_buffer_t in = {.data = &iq[2 * pos], .capacity = 2 * part, .size = 2 * part};
+            float_buffer_t part_out = {.data = &parts[total * 2 * channels], .capacity = sizeof(parts) / sizeof(float) - total * 2 * channels, .size = 0};
+            total += channelizer_process(&ch, &in, &part_out);
+        }
+        assert_equal_int(total, blocks, "same blocks in parts");
+        assert_memory(parts, out, blocks * 2 * channels * sizeof(float), "same output in parts");
+        channelizer_free(&ch);
+    }
+
+    channelizer_t ch;
+    assert_equal_int(channelizer_init(&ch, 12), -CHANNELIZER_INVALID_CHANNELS, "not a power of two");
+    assert_equal_int(channelizer_init(&ch, 2), -CHANNELIZER_INVALID_CHANNELS, "too few channels");
+    channelizer_init(&ch, 8);
+    float_buffer_t iq_buf = {.data = iq, .capacity = 2 * len, .size = 2 * len};
+    float_buffer_t small = {.data = out, .capacity = 100, .size = 0};
+    assert_equal_int(channelizer_process(&ch, &iq_buf, &small), -CHANNELIZER_BUF_TOO_SMALL, "too small");
+    channelizer_free(&ch);
+}
+
+typedef struct channelizer_test_count
+{
+    int frames[8];
+    int wrong; // Frames whose content is not from the station on that channel
+} channelizer_test_count_t;
+
+static void channelizer_test_frame(void *ctx, const buffer_t *frame_buf, int channel)
+{
+    channelizer_test_count_t *count = ctx;
+    count->frames[channel]++;
+    if (frame_buf->size != 40 || frame_buf->data[0] != channel)
+        count->wrong++;
+}
+
+// Narrowband FM AFSK stations at the centres of their channels, each sending frames that start
+// with its channel number
+static int channelizer_test_render(const int *stations, int station_count, int frames, int rate, int channels,
+                                   float *iq, int capacity)
+{
+    static float audio[100000 * 4];
+    int len = 0;
+    for (int s = 0; s < station_count; s++)
+    {
+        afsk_modulator_t mod;
+        afsk_modulator_init(&mod, rate, 1);
+        hldc_framer_t framer;
+        hldc_framer_init(&framer, 16, 4);
+        int total = 0;
+        for (int p = 0; p < frames; p++)
+        {
+            uint8_t frame[40], bits_data[1024];
+            for (int i = 0; i < (int)sizeof(frame); i++)
+                frame[i] = i == 0 ? stations[s] : p * 31 + i * 7 + s;
+            buffer_t frame_buf = {.data = frame, .capacity = sizeof(frame), .size = sizeof(frame)};
+            buffer_t bits_buf = {.data = bits_data, .capacity = sizeof(bits_data), .size = 0};
+            hldc_framer_process(&framer, &frame_buf, &bits_buf, NULL);
+            float_buffer_t out = {.data = &audio[total], .capacity = (int)(sizeof(audio) / sizeof(float)) - total, .size = 0};
+            int n = afsk_modulator_process(&mod, &bits_buf, &out);
+            if (n < 0)
+                break;
+            total += n;
+        }
+
+        // 3 kHz deviation around the channel centre
+        int k = stations[s];
+        double centre = (k < channels / 2 ? k : k - channels) * (double)rate / channels;
+        double phase = 0;
+        for (int i = 0; i < total && i < capacity / 2; i++)
+        {
+            phase = fmod(phase + 2 * M_PI * (centre + 3000 * audio[i]) / rate, 2 * M_PI);
+            iq[2 * i] += 0.3f * cos(phase);
+            iq[2 * i + 1] += 0.3f * sin(phase);
+        }
+        len = max(len, min(total, capacity / 2));
+    }
+    return len;
+}
+
+void test_channelizer_receiver()
+{
+    // Three stations at once with a strong carrier between two of them, through a cf32 file
+    const int rate = 100000, channels = 8;
+    const int stations[] = {1, 3, 6};
+    static float iq[2 * 100000 * 4];
+    memset(iq, 0, sizeof(iq));
+    int len = channelizer_test_render(stations, 3, 6, rate, channels, iq, sizeof(iq) / sizeof(float));
+    uint32_t seed = 3;
+    for (int i = 0; i < len; i++)
+    {
+        double carrier = 2 * M_PI * fmod(2.0 * rate / channels * i, rate) / rate;
+        iq[2 * i] += 3 * cos(carrier);
+        iq[2 * i + 1] += 3 * sin(carrier);
+        for (int j = 0; j < 2; j++)
+        {
+            seed = seed * 1664525 + 1013904223;
+            iq[2 * i + j] += ((seed >> 8) / 16777216.0f * 2 - 1) * 0.05f;
+        }
+    }
+
+    FILE *file = tmpfile();
+    assert_true(file != NULL, "temporary file");
+    if (file == NULL)
+        return;
+    fwrite(iq, sizeof(float), 2 * len, file);
+    rewind(file);
+
+    channelizer_test_count_t count = {0};
+    channelizer_receiver_t rx;
+    assert_equal_int(channelizer_receiver_init(&rx, rate, channels, 1, channelizer_test_frame, &count), 0, "receiver init");
+    static float block[2 * 4099];
+    size_t n;
+    int delivered = 0;
+    while ((n = fread(block, 2 * sizeof(float), 4099, file)) > 0)
+    {
+        float_buffer_t block_buf = {.data = block, .capacity = 2 * n, .size = 2 * n};
+        delivered += channelizer_receiver_process(&rx, &block_buf);
+    }
+    fclose(file);
+    channelizer_receiver_free(&rx);
+
+    assert_equal_int(count.frames[1], 6, "channel 1 frames");
+    assert_equal_int(count.frames[3], 6, "channel 3 frames");
+    assert_equal_int(count.frames[6], 6, "channel 6 frames");
+    assert_equal_int(delivered, 18, "no frames elsewhere");
+    assert_equal_int(count.wrong, 0, "frames on their own channel");
+
+    // Channel rate must be a whole number and suit the AFSK demodulator
+    assert_equal_int(channelizer_receiver_init(&rx, 100001, 8, 1, channelizer_test_frame, &count), -CHANNELIZER_INVALID_RATE, "fractional channel rate");
+    assert_equal_int(channelizer_receiver_init(&rx, 2048000, 8, 1, channelizer_test_frame, &count), -CHANNELIZER_INVALID_RATE, "channel rate too high");
+    assert_equal_int(channelizer_receiver_init(&rx, 2048000, 64, 1, channelizer_test_frame, &count), 0, "wideband");
+    channelizer_receiver_free(&rx);
+}
+
+#endif
@@ -0,0 +1,226 @@
+#ifndef TEST_CONF_H
+#define TEST_CONF_H
+
+#include "test.h"
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include "conf.h"
+
+void test_conf_load()
+{
+    char path[] = "/tmp/tnc_test_conf_XXXXXX";
+    int fd = mkstemp(path);
+    assert_true(fd >= 0, "temp file");
+    const char *text = "# comment\n"
+                       "  callsign = N0CALL-1  \r\n"
+                       "\n"
+                       "txdelay=300\n"
+                       "persist = 0.25\n"
+                       "fullduplex = true\n"
+                       "broken line\n"
+                       "=no key\n"
+                       "txdelay = 500\n"
+                       "debug=maybe";
+    assert_equal_int(write(fd, text, strlen(text)), strlen(text), "write conf");
+    close(fd);
+
+    conf_t conf;
+    assert_equal_int(conf_load(&conf, path), CONF_SUCCESS, "load");
+    unlink(path);
+    assert_equal_int(conf.count, 5, "entry count");
+
+    int i;
+    float f;
+    assert_string(conf_get_str(&conf, "callsign"), "N0CALL-1", "string value");
+    assert_equal_int(conf_get_int(&conf, "txdelay", &i), CONF_SUCCESS, "int found");
+    assert_equal_int(i, 300, "first entry wins");
+    assert_equal_int(conf_get_float(&conf, "persist", &f), CONF_SUCCESS, "float found");
+    assert_true(f == 0.25f, "float value");
+    assert_equal_int(conf_get_bool(&conf, "fullduplex", &i), CONF_SUCCESS, "bool found");
+    assert_equal_int(i, 1, "bool value");
+    assert_equal_int(conf_get_bool(&conf, "debug", &i), -CONF_ERR_INVALID_VALUE, "invalid bool");
+    assert_equal_int(conf_get_int(&conf, "missing", &i), -CONF_ERR_NOT_FOUND, "missing key");
+    assert_true(conf_get_str(&conf, "missing") == NULL, "missing string");
+    assert_equal_int(conf_get_int_or_default(&conf, "missing", 7), 7, "default");
+
+    // Handles resolve once and read without a lookup
+    conf_key_t key = conf_find(&conf, "persist");
+    assert_true(key >= 0, "handle found");
+    assert_equal_int(conf_key_float(&conf, key, &f), CONF_SUCCESS, "read by handle");
+    assert_true(f == 0.25f, "handle value");
+    assert_equal_int(conf_find(&conf, "persis"), -CONF_ERR_NOT_FOUND, "prefix not found");
+    assert_equal_int(conf_key_int(&conf, conf_find(&conf, "nope"), &i), -CONF_ERR_NOT_FOUND, "missing handle");
+
+    conf_free(&conf);
+    assert_equal_int(conf_load(&conf, "/nonexistent/tnc.conf"), -CONF_ERR_FILE_NOT_FOUND, "file not found");
+}
+
+void test_conf_many_entries()
+{
+    // Per-channel settings well past the old 64 entry limit, with values past the old 256 bytes
+    size_t cap = 1 << 20;
+    char *text = malloc(cap);
+    size_t len = 0;
+    for (int i = 0; i < 2000; i++)
+        len += snprintf(&text[len], cap - len, "channel.%d.txdelay = %d\nchannel.%d.enabled = %s\n",
+                        i, i * 10, i, i % 2 ? "true" : "false");
+    len += snprintf(&text[len], cap - len, "beacon = ");
+    memset(&text[len], 'x', 5000);
+    len += 5000;
+
+    conf_t conf;
+    assert_equal_int(conf_load_buffer(&conf, text, len), CONF_SUCCESS, "load buffer");
+    assert_equal_int(conf.count, 4001, "all entries kept");
+
+    int errors = 0;
+    for (int i = 0; i < 2000; i++)
+    {
+        char name[64];
+        int v;
+        snprintf(name, sizeof(name), "channel.%d.txdelay", i);
+        if (conf_get_int(&conf, name, &v) || v != i * 10)
+            errors++;
+        snprintf(name, sizeof(name), "channel.%d.enabled", i);
+        if (conf_key_bool(&conf, conf_find(&conf, name), &v) || v != i % 2)
+            errors++;
+    }
+    assert_equal_int(errors, 0, "every entry found");
+    assert_equal_int(strlen(conf_get_str(&conf, "beacon")), 5000, "long value");
+
+    conf_free(&conf);
+    assert_equal_int(conf_load_buffer(&conf, "", 0), CONF_SUCCESS, "empty");
+    assert_equal_int(conf_find(&conf, "beacon"), -CONF_ERR_NOT_FOUND, "empty conf");
+    conf_free(&conf);
+    free(text);
+}
+
+static void conf_test_publish(conf_live_t *live, int generation)
+{
+    char text[128];
+    int len = snprintf(text, sizeof(text), "generation = %d\ndouble = %d\ntxdelay = 300\n", generation, 2 * generation);
+    conf_t conf;
+    conf_load_buffer(&conf, text, len);
+    conf_live_publish(live, &conf);
+}
+
+void test_conf_live_reclaim()
+{
+    conf_live_t live;
+    conf_live_init(&live);
+    assert_true(conf_live_get(&live) == NULL, "empty before publish");
+
+    int reader = conf_live_register(&live);
+    assert_equal_int(reader, 0, "first reader");
+
+    conf_test_publish(&live, 1);
+    const conf_t *first = conf_live_get(&live);
+    assert_equal_int(conf_get_int_or_default(first, "generation", 0), 1, "first snapshot");
+
+    // The reader still holds the first snapshot until it is quiescent
+    conf_test_publish(&live, 2);
+    assert_equal_int(conf_get_int_or_default(first, "generation", 0), 1, "old snapshot still readable");
+    assert_equal_int(conf_get_int_or_default(conf_live_get(&live), "generation", 0), 2, "new snapshot");
+    assert_equal_int(conf_live_reclaim(&live), 1, "old snapshot waits");
+    conf_live_quiescent(&live, reader);
+    assert_equal_int(conf_live_reclaim(&live), 0, "reclaimed after quiescent");
+
+    // Offline readers do not hold snapshots back
+    conf_live_offline(&live, reader);
+    conf_test_publish(&live, 3);
+    assert_equal_int(conf_live_reclaim(&live), 0, "offline reader");
+    conf_live_online(&live, reader);
+    conf_test_publish(&live, 4);
+    assert_equal_int(conf_live_reclaim(&live), 1, "online again");
+
+    // A failed reload keeps the current snapshot
+    assert_equal_int(conf_live_reload(&live, "/nonexistent/tnc.conf"), -CONF_ERR_FILE_NOT_FOUND, "reload error");
+    assert_equal_int(conf_get_int_or_default(conf_live_get(&live), "generation", 0), 4, "snapshot kept");
+
+    for (int i = 1; i < CONF_LIVE_MAX_READERS; i++)
+        conf_live_register(&live);
+    assert_equal_int(conf_live_register(&live), -CONF_ERR_TOO_MANY_READERS, "reader limit");
+
+    // An unregistered reader stops holding snapshots back and its index is reused
+    conf_live_unregister(&live, reader);
+    assert_equal_int(conf_live_reclaim(&live), 0, "unregistered reader");
+    assert_equal_int(conf_live_register(&live), reader, "index reused");
+    assert_equal_int(conf_live_register(&live), -CONF_ERR_TOO_MANY_READERS, "reader limit again");
+
+    conf_live_free(&live);
+}
+
+typedef struct conf_test_reader
+{
+    conf_live_t *live;
+    atomic_bool *stop;
+    atomic_int *started;
+    int reads;
+    int inconsistent;
+    int last_generation;
+    int backwards;
+} conf_test_reader_t;
+
+static void *conf_test_read(void *arg)
+{
+    conf_test_reader_t *r = arg;
+    int reader = conf_live_register(r->live);
+    atomic_fetch_add(r->started, 1);
+    do
+    {
+        const conf_t *conf = conf_live_get(r->live);
+        int generation = conf_get_int_or_default(conf, "generation", -1);
+        if (conf_get_int_or_default(conf, "double", -1) != 2 * generation)
+            r->inconsistent++;
+        if (generation < r->last_generation)
+            r->backwards++;
+        r->last_generation = generation;
+        r->reads++;
+        conf_live_quiescent(r->live, reader);
+    } while (!atomic_load(r->stop));
+    conf_live_unregister(r->live, reader);
+    return NULL;
+}
+
+void test_conf_live_concurrent()
+{
+    conf_live_t live;
+    conf_live_init(&live);
+    conf_test_publish(&live, 0);
+
+    atomic_bool stop;
+    atomic_int started;
+    atomic_init(&stop, false);
+    atomic_init(&started, 0);
+    conf_test_reader_t readers[4];
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++)
+    {
+        readers[i] = (conf_test_reader_t){.live = &live, .stop = &stop, .started = &started};
+        pthread_create(&threads[i], NULL, conf_test_read, &readers[i]);
+    }
+
+    while (atomic_load(&started) < 4)
+        ;
+    for (int generation = 1; generation <= 2000; generation++)
+        conf_test_publish(&live, generation);
+    atomic_store(&stop, true);
+
+    int inconsistent = 0, backwards = 0, reads = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        pthread_join(threads[i], NULL);
+        inconsistent += readers[i].inconsistent;
+        backwards += readers[i].backwards;
+        reads += readers[i].reads;
+    }
+    assert_true(reads > 0, "readers ran");
+    assert_equal_int(inconsistent, 0, "snapshots consistent");
+    assert_equal_int(backwards, 0, "snapshots in order");
+    assert_equal_int(conf_live_reclaim(&live), 0, "all reclaimed");
+
+    conf_live_free(&live);
+}
+
+#endif
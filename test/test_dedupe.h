@@ -0,0 +1,72 @@
+#ifndef TEST_DEDUPE_H
+#define TEST_DEDUPE_H
+
+#include "test.h"
+#include <string.h>
+#include "dedupe.h"
+#include "tnc2.h"
+
+static uint64_t dedupe_test_hash(const char *tnc2, bool from_frame)
+{
+    uint8_t info[AX25_MAX_INFO_LEN];
+    ax25_packet_t packet;
+    ax25_packet_init(&packet, info, sizeof(info));
+    buffer_t str = {.data = (unsigned char *)tnc2, .capacity = strlen(tnc2), .size = strlen(tnc2)};
+    tnc2_string_to_packet(&packet, &str);
+    if (!from_frame)
+        return dedupe_hash_packet(&packet);
+
+    uint8_t frame_data[AX25_MAX_PACKET_LEN];
+    buffer_t frame = {.data = frame_data, .capacity = sizeof(frame_data), .size = 0};
+    ax25_packet_pack(&packet, &frame);
+    return dedupe_hash_frame(&frame);
+}
+
+void test_dedupe_hash()
+{
+    uint64_t h = dedupe_test_hash("N0CALL>APRS,WIDE2-2:>hello", false);
+    assert_true(h == dedupe_test_hash("N0CALL>APRS,WIDE2-2:>hello", true), "frame and packet hash equal");
+    assert_true(h == dedupe_test_hash("N0CALL>APRS,DIGI*,WIDE2-1:>hello", true), "path ignored");
+    assert_true(h == dedupe_test_hash("N0CALL>APRS:>hello\r\n", true), "trailing cr lf ignored");
+    assert_true(h != dedupe_test_hash("N0CALL-1>APRS:>hello", true), "source ssid matters");
+    assert_true(h != dedupe_test_hash("N0CALL>APRS-1:>hello", true), "destination ssid matters");
+    assert_true(h != dedupe_test_hash("N0CALL>APRS:>hellO", true), "info matters");
+}
+
+void test_dedupe_window()
+{
+    dedupe_t dd;
+    assert_equal_int(dedupe_init(&dd, 100, 30000, 1000), 0, "dedupe init");
+
+    assert_true(!dedupe_check(&dd, 1234, 1000000), "first sighting");
+    assert_true(dedupe_check(&dd, 1234, 1000500), "duplicate within window");
+    assert_true(dedupe_check(&dd, 1234, 1028999), "duplicate before expiry");
+    assert_true(!dedupe_contains(&dd, 1234, 1031000), "expired after window");
+    assert_equal_int(dd.count, 0, "expired entry freed");
+
+    assert_true(!dedupe_check(&dd, 1234, 1031000), "new sighting after expiry");
+    assert_true(!dedupe_contains(&dd, 1234, 5000000), "expired after long gap");
+
+    dedupe_free(&dd);
+}
+
+void test_dedupe_bounded()
+{
+    dedupe_t dd;
+    dedupe_init(&dd, 1000, 10000, 100);
+
+    uint64_t now = 0;
+    for (uint64_t i = 0; i < 20000; i++)
+    {
+        if (i % 100 == 0)
+            now += 100;
+        dedupe_check(&dd, i * 0x100000001ULL, now);
+    }
+    assert_true(dd.count <= 1000, "dedupe stays within capacity");
+    assert_true(dedupe_contains(&dd, 19999 * 0x100000001ULL, now), "newest entry kept when full");
+    assert_true(!dedupe_contains(&dd, 0, now), "oldest entry evicted when full");
+
+    dedupe_free(&dd);
+}
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef TEST_DIGI_H
+#define TEST_DIGI_H
+
+#include "test.h"
+#include <string.h>
+#include "digi.h"
+#include "crc.h"
+#include "tnc2.h"
+
+static digi_t digi_test;
+
+static void digi_test_setup(void)
+{
+    ax25_addr_t addr;
+    ax25_addr_init_with(&addr, "DIGI", 1, false);
+    digi_init(&digi_test, &addr);
+    ax25_addr_init_with(&addr, "WIDE1", 1, false);
+    digi_add_alias(&digi_test, &addr);
+}
+
+// Runs a TNC2 frame through the digipeater, writing the result as TNC2 into out
+static int digi_test_run(const char *in, char *out, int out_len)
+{
+    uint8_t info[AX25_MAX_INFO_LEN];
+    ax25_packet_t packet;
+    ax25_packet_init(&packet, info, sizeof(info));
+    buffer_t str = {.data = (unsigned char *)in, .capacity = strlen(in), .size = strlen(in)};
+    if (tnc2_string_to_packet(&packet, &str))
+        return -100;
+
+    uint8_t frame_data[AX25_MAX_PACKET_LEN];
+    buffer_t frame = {.data = frame_data, .capacity = sizeof(frame_data), .size = 0};
+    ax25_packet_pack(&packet, &frame);
+
+    crc_ccitt_t crc;
+    crc_ccitt_init(&crc);
+    crc_ccitt_update_buffer(&crc, frame.data, frame.size);
+    uint16_t fcs = crc_ccitt_get(&crc);
+
+    int ret = digi_process(&digi_test, &frame, &fcs);
+
+    crc_ccitt_init(&crc);
+    crc_ccitt_update_buffer(&crc, frame.data, frame.size);
+    if (fcs != crc_ccitt_get(&crc))
+        return -200;
+
+    if (ax25_packet_unpack(&packet, &frame))
+        return -300;
+    buffer_t out_buf = {.data = (unsigned char *)out, .capacity = out_len, .size = 0};
+    tnc2_packet_to_string(&packet, &out_buf);
+    return ret;
+}
+
+void test_digi_wide()
+{
+    char out[256];
+    digi_test_setup();
+
+    assert_equal_int(digi_test_run("N0CALL>APRS,WIDE2-2:>hi", out, sizeof(out)), DIGI_REPEAT, "wide2-2 repeated");
+    assert_string(out, "N0CALL>APRS,DIGI-1*,WIDE2-1:>hi", "wide2-2 traced");
+
+    assert_equal_int(digi_test_run("N0CALL>APRS,OTHER*,WIDE2-1:>hi", out, sizeof(out)), DIGI_REPEAT, "wide2-1 repeated");
+    assert_string(out, "N0CALL>APRS,OTHER*,DIGI-1*,WIDE2*:>hi", "wide2-1 used up");
+
+    digi_test.trace_wide = false;
+    assert_equal_int(digi_test_run("N0CALL>APRS,WIDE2-2:>hi", out, sizeof(out)), DIGI_REPEAT, "untraced wide");
+    assert_string(out, "N0CALL>APRS,WIDE2-1:>hi", "untraced wide decremented in place");
+
+    assert_equal_int(digi_test_run("N0CALL>APRS,WIDE3-3:>hi", out, sizeof(out)), DIGI_IGNORE, "wide above max n");
+    assert_string(out, "N0CALL>APRS,WIDE3-3:>hi", "wide above max n unchanged");
+
+    assert_equal_int(digi_test_run("N0CALL>APRS,WIDE2*:>hi", out, sizeof(out)), DIGI_IGNORE, "used up path");
+}
+
+void test_digi_trace_and_alias()
+{
+    char out[256];
+    digi_test_setup();
+
+    assert_equal_int(digi_test_run("N0CALL>APRS,TRACE2-2:>hi", out, sizeof(out)), DIGI_REPEAT, "trace repeated");
+    assert_string(out, "N0CALL>APRS,DIGI-1*,TRACE2-1:>hi", "trace inserts own call");
+
+    assert_equal_int(digi_test_run("N0CALL>APRS,WIDE1-1,WIDE2-1:>hi", out, sizeof(out)), DIGI_REPEAT, "alias repeated");
+    assert_string(out, "N0CALL>APRS,DIGI-1*,WIDE2-1:>hi", "alias replaced by own call");
+
+    assert_equal_int(digi_test_run("N0CALL>APRS,DIGI-1:>hi", out, sizeof(out)), DIGI_REPEAT, "own call repeated");
+    assert_string(out, "N0CALL>APRS,DIGI-1*:>hi", "own call marked");
+
+    assert_equal_int(digi_test_run("DIGI-1>APRS,WIDE2-2:>hi", out, sizeof(out)), DIGI_IGNORE, "own packet ignored");
+
+    // Full path: cannot insert, decremented in place instead
+    assert_equal_int(digi_test_run("N0CALL>APRS,A*,B*,C*,D*,E*,F*,G*,TRACE2-2:>hi", out, sizeof(out)), DIGI_REPEAT, "full path");
+    assert_string(out, "N0CALL>APRS,A*,B*,C*,D*,E*,F*,G*,TRACE2-1:>hi", "full path decremented");
+}
+
+void test_digi_preempt()
+{
+    char out[256];
+    digi_test_setup();
+
+    assert_equal_int(digi_test_run("N0CALL>APRS,FAR,DIGI-1,WIDE2-1:>hi", out, sizeof(out)), DIGI_IGNORE, "preempt off");
+
+    digi_test.preempt = DIGI_PREEMPT_MARK;
+    assert_equal_int(digi_test_run("N0CALL>APRS,FAR,DIGI-1,WIDE2-1:>hi", out, sizeof(out)), DIGI_REPEAT, "preempt mark");
+    assert_string(out, "N0CALL>APRS,FAR*,DIGI-1*,WIDE2-1:>hi", "preempt mark path");
+
+    digi_test.preempt = DIGI_PREEMPT_DROP;
+    assert_equal_int(digi_test_run("N0CALL>APRS,FAR,NEAR,DIGI-1,WIDE2-1:>hi", out, sizeof(out)), DIGI_REPEAT, "preempt drop");
+    assert_string(out, "N0CALL>APRS,DIGI-1*,WIDE2-1:>hi", "preempt drop path");
+}
+
+void test_digi_fcs_patch()
+{
+    uint8_t a[200], delta[8];
+    for (int i = 0; i < (int)sizeof(a); i++)
+        a[i] = i * 37 + 11;
+
+    crc_ccitt_t crc;
+    crc_ccitt_init(&crc);
+    crc_ccitt_update_buffer(&crc, a, sizeof(a));
+    uint16_t fcs = crc_ccitt_get(&crc);
+
+    for (int i = 0; i < 8; i++)
+    {
+        delta[i] = 0x5a ^ i;
+        a[20 + i] ^= delta[i];
+    }
+
+    crc_ccitt_init(&crc);
+    crc_ccitt_update_buffer(&crc, a, sizeof(a));
+    assert_equal_int(crc_ccitt_patch(fcs, delta, 8, sizeof(a) - 28), crc_ccitt_get(&crc), "fcs patch matches recompute");
+}
+
+#endif
@@ -0,0 +1,182 @@
+#ifndef TEST_FILTER_H
+#define TEST_FILTER_H
+
+#include "test.h"
+#include <string.h>
+#include <math.h>
+#include "filter.h"
+#include "tnc2.h"
+
+static uint8_t filter_test_info[AX25_MAX_INFO_LEN];
+
+static ax25_packet_t filter_test_packet(const char *tnc2)
+{
+    ax25_packet_t packet;
+    ax25_packet_init(&packet, filter_test_info, sizeof(filter_test_info));
+    buffer_t str = {.data = (unsigned char *)tnc2, .capacity = strlen(tnc2), .size = strlen(tnc2)};
+    tnc2_string_to_packet(&packet, &str);
+    return packet;
+}
+
+static uint64_t filter_test_match(filter_set_t *set, const char *tnc2)
+{
+    ax25_packet_t packet = filter_test_packet(tnc2);
+    uint64_t bits[1] = {0};
+    filter_set_match(set, &packet, bits);
+    return bits[0];
+}
+
+void test_filter_compile()
+{
+    filter_set_t set;
+    assert_equal_int(filter_set_init(&set), 0, "init");
+
+    assert_equal_int(filter_set_add(&set, "p/N0"), 0, "first subscription");
+    assert_equal_int(filter_set_add(&set, "b/K1ABC t/m"), 1, "second subscription");
+    assert_equal_int(filter_set_add(&set, "x/foo"), -FILTER_ERR_SYNTAX, "unknown term");
+    assert_equal_int(filter_set_add(&set, "p/N0 t/z"), -FILTER_ERR_SYNTAX, "unknown type letter");
+    assert_equal_int(filter_set_add(&set, "r/91/0/10"), -FILTER_ERR_SYNTAX, "latitude out of range");
+    assert_equal_int(filter_set_add(&set, "p/N0*"), -FILTER_ERR_SYNTAX, "wildcard not allowed on prefix");
+    assert_equal_int(filter_set_add(&set, "  "), -FILTER_ERR_SYNTAX, "empty filter");
+    assert_equal_int(set.count, 2, "failed filters not added");
+    assert_equal_int(set.type_count, 1, "failed filters leave no terms behind");
+
+    filter_set_free(&set);
+}
+
+void test_filter_callsigns()
+{
+    filter_set_t set;
+    filter_set_init(&set);
+    filter_set_add(&set, "p/N0");
+    filter_set_add(&set, "b/N0CALL");
+    filter_set_add(&set, "b/N0CALL*");
+    filter_set_add(&set, "d/DIGI1");
+    filter_set_add(&set, "p/N -b/N0CALL-1");
+
+    assert_equal_int(filter_test_match(&set, "N0CALL>APRS:>hi"), 0x17, "exact, prefix and wildcard");
+    assert_equal_int(filter_test_match(&set, "N0CALL-1>APRS:>hi"), 0x05, "ssid excluded from exact and negated");
+    assert_equal_int(filter_test_match(&set, "N0XYZ>APRS,DIGI1*:>hi"), 0x19, "prefix and repeated digi");
+    assert_equal_int(filter_test_match(&set, "K1ABC>APRS,DIGI1,WIDE2-1:>hi"), 0, "digi not yet repeated");
+    assert_equal_int(filter_test_match(&set, "n0call>APRS:>hi"), 0x17, "lowercase source");
+
+    filter_set_free(&set);
+}
+
+void test_filter_types()
+{
+    ax25_packet_t packet = filter_test_packet("N0CALL>APRS::NWS-WARN :Tornado");
+    assert_equal_int(filter_packet_type(&packet), FILTER_TYPE_MESSAGE | FILTER_TYPE_NWS, "nws bulletin");
+    packet = filter_test_packet("N0CALL>APRS:!4903.50N/07201.75W_220/004g005t077");
+    assert_equal_int(filter_packet_type(&packet), FILTER_TYPE_POSITION | FILTER_TYPE_WEATHER, "weather position");
+
+    filter_set_t set;
+    filter_set_init(&set);
+    filter_set_add(&set, "t/po");
+    filter_set_add(&set, "t/m");
+    filter_set_add(&set, "p/N0 -t/s");
+
+    assert_equal_int(filter_test_match(&set, "N0CALL>APRS:=4903.50N/07201.75W-"), 0x05, "position");
+    assert_equal_int(filter_test_match(&set, "N0CALL>APRS:;OBJ      *111111z4903.50N/07201.75W-"), 0x05, "object");
+    assert_equal_int(filter_test_match(&set, "N0CALL>APRS::K1ABC    :hello{1"), 0x06, "message");
+    assert_equal_int(filter_test_match(&set, "N0CALL>APRS:>status"), 0, "status excluded");
+
+    filter_set_free(&set);
+}
+
+void test_filter_range()
+{
+    double lat, lon;
+    ax25_packet_t packet = filter_test_packet("N0CALL>APRS:!4903.50N/07201.75W-");
+    assert_true(filter_packet_position(&packet, &lat, &lon), "uncompressed position");
+    assert_true(fabs(lat - 49.058333) < 1e-5 && fabs(lon + 72.029167) < 1e-5, "uncompressed coordinates");
+
+    packet = filter_test_packet("N0CALL>APRS:@092345z/5L!!<*e7>7P[");
+    assert_true(filter_packet_position(&packet, &lat, &lon), "compressed position");
+    assert_true(fabs(lat - 49.5) < 1e-3 && fabs(lon + 72.75) < 1e-3, "compressed coordinates");
+
+    packet = filter_test_packet("N0CALL>APRS:>no position");
+    assert_true(!filter_packet_position(&packet, &lat, &lon), "no position");
+
+    filter_set_t set;
+    filter_set_init(&set);
+    filter_set_add(&set, "r/49.0/-72.0/10");
+    filter_set_add(&set, "r/49.0/-72.0/100");
+    filter_set_add(&set, "r/-33.9/151.2/50");
+    filter_set_add(&set, "p/N0 -r/49.0/-72.0/10");
+
+    assert_equal_int(filter_test_match(&set, "N0CALL>APRS:!4903.50N/07201.75W-"), 0x03, "within 10 km");
+    assert_equal_int(filter_test_match(&set, "N0CALL>APRS:!4930.00N/07245.00W-"), 0x0a, "within 100 km");
+    assert_equal_int(filter_test_match(&set, "N0CALL>APRS:!3352.00S/15112.00E-"), 0x0c, "other hemisphere");
+    assert_equal_int(filter_test_match(&set, "N0CALL>APRS:>no position"), 0x08, "no position");
+
+    filter_set_free(&set);
+}
+
+void test_filter_many()
+{
+    filter_set_t set;
+    filter_set_init(&set);
+    char filter[32];
+    for (int i = 0; i < 200; i++)
+    {
+        snprintf(filter, sizeof(filter), "b/N%dCL", i % 100);
+        assert_equal_int(filter_set_add(&set, filter), i, "subscription index");
+    }
+    assert_equal_int(set.words, 4, "bitmap words");
+
+    ax25_packet_t packet = filter_test_packet("N42CL>APRS:>hi");
+    uint64_t bits[4];
+    assert_equal_int(filter_set_match(&set, &packet, bits), 2, "two subscriptions match");
+    assert_true(bits[0] == 1ULL << 42 && bits[1] == 0 && bits[2] == 1ULL << (142 - 128) && bits[3] == 0, "bits set");
+
+    filter_set_free(&set);
+}
+
+void test_filter_remove_replace()
+{
+    filter_set_t set;
+    filter_set_init(&set);
+    filter_set_add(&set, "p/N0 t/m");
+    filter_set_add(&set, "b/N0CALL r/49.0/-72.0/10");
+    filter_set_add(&set, "p/K1 -t/s");
+
+    // Removed subscriptions stop matching and give back their terms
+    assert_equal_int(filter_set_remove(&set, 1), 0, "remove");
+    assert_equal_int(filter_test_match(&set, "N0CALL>APRS:>hi"), 0x01, "removed no longer matches");
+    assert_equal_int(set.range_count, 0, "range term dropped");
+    assert_equal_int(filter_set_remove(&set, 1), -FILTER_ERR_NOT_FOUND, "already removed");
+    assert_equal_int(filter_set_remove(&set, 7), -FILTER_ERR_NOT_FOUND, "no such subscription");
+
+    // Its slot is reused
+    assert_equal_int(filter_set_add(&set, "b/K1ABC"), 1, "slot reused");
+    assert_equal_int(filter_test_match(&set, "K1ABC>APRS:>hi"), 0x02, "new filter in the reused slot");
+
+    // Replacing keeps the index, a bad filter keeps the old one
+    assert_equal_int(filter_set_replace(&set, 0, "t/s"), 0, "replace");
+    assert_equal_int(filter_test_match(&set, "N0CALL>APRS::N0CALL   :hi"), 0, "old filter gone");
+    assert_equal_int(filter_test_match(&set, "N0CALL>APRS:>hi"), 0x01, "new filter matches");
+    assert_equal_int(filter_set_replace(&set, 0, "x/bad"), -FILTER_ERR_SYNTAX, "bad replacement");
+    assert_equal_int(filter_test_match(&set, "N0CALL>APRS:>hi"), 0x01, "old filter kept");
+    assert_equal_int(filter_set_replace(&set, 5, "t/s"), -FILTER_ERR_NOT_FOUND, "replace missing");
+
+    // Clients coming and going do not grow the set
+    uint32_t refs = set.ref_count, nodes = set.source_trie.count;
+    int moved = 0;
+    for (int i = 0; i < 1000; i++)
+    {
+        int sub = filter_set_add(&set, "b/N0CALL b/K1ABC* t/p r/10/10/5");
+        moved += sub != 3;
+        filter_set_remove(&set, sub);
+    }
+    assert_equal_int(moved, 0, "same slot every time");
+    assert_equal_int(set.count, 4, "slots");
+    assert_true(set.ref_count <= refs + 2, "refs recycled");
+    assert_equal_int(set.source_trie.count, nodes, "trie nodes reused");
+    assert_equal_int(set.type_count, 2, "type terms");
+    assert_equal_int(set.range_count, 0, "range terms");
+
+    filter_set_free(&set);
+}
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef TEST_G3RUH_H
+#define TEST_G3RUH_H
+
+#include "test.h"
+#include <math.h>
+#include <string.h>
+#include "g3ruh.h"
+#include "hldc.h"
+
+static uint32_t g3ruh_test_seed = 1;
+
+static uint32_t g3ruh_test_rand(void)
+{
+    g3ruh_test_seed = g3ruh_test_seed * 1664525 + 1013904223;
+    return g3ruh_test_seed >> 8;
+}
+
+void test_g3ruh_scrambler()
+{
+    // Word at a time matches the polynomial applied bit by bit, whatever the word lengths
+    static uint8_t data[4096], line[4096], reference[4096], back[4096];
+    for (int i = 0; i < (int)sizeof(data); i++)
+        data[i] = g3ruh_test_rand() & 1;
+    for (int i = 0; i < (int)sizeof(data); i++)
+        reference[i] = data[i] ^ (i >= 12 ? reference[i - 12] : 0) ^ (i >= 17 ? reference[i - 17] : 0);
+
+    g3ruh_scrambler_t scr, descr;
+    g3ruh_scrambler_init(&scr);
+    g3ruh_scrambler_init(&descr);
+    for (int pos = 0, len = 1; pos < (int)sizeof(data); pos += len, len = len % 64 + 1)
+    {
+        int n = min(len, (int)sizeof(data) - pos);
+        buffer_t in = {.data = &data[pos], .capacity = n, .size = n};
+        buffer_t out = {.data = &line[pos], .capacity = n, .size = 0};
+        assert_equal_int(g3ruh_scramble_bits(&scr, &in, &out), n, "scrambled");
+    }
+    assert_memory(line, reference, sizeof(line), "matches bitwise scrambler");
+
+    buffer_t line_buf = {.data = line, .capacity = sizeof(line), .size = sizeof(line)};
+    buffer_t back_buf = {.data = back, .capacity = sizeof(back), .size = 0};
+    assert_equal_int(g3ruh_descramble_bits(&descr, &line_buf, &back_buf), sizeof(back), "descrambled");
+    assert_memory(back, data, sizeof(back), "round trip");
+
+    // In place, and words agree with bytes
+    g3ruh_scrambler_init(&scr);
+    memcpy(back, data, sizeof(back));
+    back_buf.size = sizeof(back);
+    g3ruh_scramble_bits(&scr, &back_buf, &back_buf);
+    assert_memory(back, reference, sizeof(back), "in place");
+
+    g3ruh_scrambler_init(&scr);
+    uint64_t word = 0;
+    for (int i = 0; i < 64; i++)
+        word |= (uint64_t)data[i] << i;
+    uint64_t scrambled = g3ruh_scramble(&scr, word, 64);
+    int mismatches = 0;
+    for (int i = 0; i < 64; i++)
+        mismatches += ((scrambled >> i) & 1) != reference[i];
+    assert_equal_int(mismatches, 0, "word bit order");
+
+    // A descrambler joining mid stream is in step after 17 bits
+    g3ruh_scrambler_init(&descr);
+    buffer_t late = {.data = &line[1000], .capacity = 500, .size = 500};
+    back_buf.size = 0;
+    g3ruh_descramble_bits(&descr, &late, &back_buf);
+    assert_memory(&back[17], &data[1017], 500 - 17, "self synchronizing");
+
+    buffer_t small = {.data = back, .capacity = 10, .size = 0};
+    assert_equal_int(g3ruh_descramble_bits(&descr, &line_buf, &small), -G3RUH_BUF_TOO_SMALL, "too small");
+}
+
+// Frames, scrambles and modulates packets, then adds noise at the given Eb/N0
+static int g3ruh_test_render(int sample_rate, int packets, float db, float *out, int capacity)
+{
+    g3ruh_modulator_t mod;
+    g3ruh_modulator_init(&mod, sample_rate, 0.5f);
+    g3ruh_scrambler_t scr;
+    g3ruh_scrambler_init(&scr);
+    hldc_framer_t framer;
+    hldc_framer_init(&framer, 16, 4);
+
+    int total = 0;
+    for (int p = 0; p < packets; p++)
+    {
+        uint8_t frame[40];
+        for (int i = 0; i < (int)sizeof(frame); i++)
+            frame[i] = p * 31 + i * 7;
+        uint8_t bits_data[1024];
+        buffer_t frame_buf = {.data = frame, .capacity = sizeof(frame), .size = sizeof(frame)};
+        buffer_t bits_buf = {.data = bits_data, .capacity = sizeof(bits_data), .size = 0};
+        hldc_framer_process(&framer, &frame_buf, &bits_buf, NULL);
+        g3ruh_scramble_bits(&scr, &bits_buf, &bits_buf);
+
+        float_buffer_t audio = {.data = &out[total], .capacity = capacity - total, .size = 0};
+        int n = g3ruh_modulator_process(&mod, &bits_buf, &audio);
+        if (n < 0)
+            break;
+        total += n;
+    }
+
+    // Uniform noise of the same power as Gaussian noise at this Eb/N0, the pulses having unit
+    // energy per bit at amplitude 1
+    float eb = 0.5f * 0.5f / G3RUH_BAUD;
+    float peak = sqrtf(3 * eb / powf(10, db / 10) * sample_rate / 2);
+    for (int i = 0; i < total; i++)
+        out[i] += ((g3ruh_test_rand() / 16777216.0f) * 2 - 1) * peak;
+    return total;
+}
+
+static int g3ruh_test_decode(const float *audio, int len, int sample_rate)
+{
+    g3ruh_demodulator_t demod;
+    g3ruh_demodulator_init(&demod, sample_rate);
+    g3ruh_scrambler_t descr;
+    g3ruh_scrambler_init(&descr);
+    hldc_deframer_t deframer;
+    hldc_deframer_init(&deframer);
+
+    int frames = 0;
+    uint8_t bits[1024];
+    uint8_t frame[512];
+    for (int pos = 0, block = 100; pos < len; pos += block, block = block % 700 + 97)
+    {
+        float_buffer_t in = {.data = (float *)&audio[pos], .capacity = min(block, len - pos), .size = min(block, len - pos)};
+        buffer_t out = {.data = bits, .capacity = sizeof(bits), .size = 0};
+        int n = g3ruh_demodulator_process(&demod, &in, &out);
+        g3ruh_descramble_bits(&descr, &out, &out);
+        for (int i = 0; i < n; i++)
+        {
+            buffer_t frame_buf = {.data = frame, .capacity = sizeof(frame), .size = 0};
+            hldc_deframer_process(&deframer, bits[i], &frame_buf, NULL);
+            if (frame_buf.size == 40)
+                frames++;
+        }
+    }
+    g3ruh_demodulator_free(&demod);
+    return frames;
+}
+
+void test_g3ruh_modem_loopback()
+{
+    const int rates[] = {38400, 44100, 48000, 96000};
+    static float audio[96000 * 4];
+
+    for (int r = 0; r < 4; r++)
+    {
+        int len = g3ruh_test_render(rates[r], 50, 40, audio, sizeof(audio) / sizeof(float));
+        assert_equal_int(g3ruh_test_decode(audio, len, rates[r]), 50, "clean loopback");
+
+        len = g3ruh_test_render(rates[r], 50, 10, audio, sizeof(audio) / sizeof(float));
+        assert_true(g3ruh_test_decode(audio, len, rates[r]) >= 45, "noisy loopback");
+    }
+
+    // Offsets from a discriminator are removed
+    int len = g3ruh_test_render(48000, 50, 12, audio, sizeof(audio) / sizeof(float));
+    for (int i = 0; i < len; i++)
+        audio[i] += 0.3f;
+    assert_true(g3ruh_test_decode(audio, len, 48000) >= 45, "dc offset");
+
+    g3ruh_modulator_t mod;
+    g3ruh_demodulator_t demod;
+    assert_equal_int(g3ruh_modulator_init(&mod, 22050, 1), -G3RUH_INVALID_RATE, "modulator rate too low");
+    assert_equal_int(g3ruh_demodulator_init(&demod, 22050), -G3RUH_INVALID_RATE, "demodulator rate too low");
+}
+
+#endif
@@ -55,6 +55,45 @@ void test_hldc_framer_bit_stuffing(void)
     assert_equal_int(bits_buf.size, 9 + 16 + 1, "bit stuffing works");
 }
 
+void test_hldc_back_to_back(void)
+{
+    // The first frame's FCS ends in a run of ones, which must not carry into the next frame's
+    // bit stuffing
+    uint8_t frames[2][20];
+    memset(frames[0], 0x55, sizeof(frames[0]));
+    memset(frames[1], 0xff, sizeof(frames[1]));
+    crc_ccitt_t crc_inst;
+    do
+    {
+        frames[0][0]++;
+        crc_ccitt_init(&crc_inst);
+        crc_ccitt_update_buffer(&crc_inst, frames[0], sizeof(frames[0]));
+    } while ((crc_ccitt_get(&crc_inst) & 0xf000) != 0xf000);
+
+    hldc_framer_t framer;
+    hldc_framer_init(&framer, 1, 1);
+    hldc_deframer_t deframer;
+    hldc_deframer_init(&deframer);
+    int received = 0;
+    for (int f = 0; f < 2; f++)
+    {
+        uint8_t bits[256];
+        buffer_t bits_buf = {.data = bits, .capacity = sizeof(bits), .size = 0};
+        buffer_t data_buf = {.data = frames[f], .capacity = sizeof(frames[f]), .size = sizeof(frames[f])};
+        hldc_framer_process(&framer, &data_buf, &bits_buf, NULL);
+
+        for (int i = 0; i < bits_buf.size; i++)
+        {
+            uint8_t frame[32];
+            buffer_t frame_buf = {.data = frame, .capacity = sizeof(frame), .size = 0};
+            hldc_deframer_process(&deframer, bits[i], &frame_buf, NULL);
+            if (frame_buf.size == sizeof(frames[f]) && memcmp(frame, frames[f], sizeof(frames[f])) == 0)
+                received++;
+        }
+    }
+    assert_equal_int(received, 2, "both frames deframed");
+}
+
 void test_hldc_deframer_init(void)
 {
     hldc_deframer_t deframer;
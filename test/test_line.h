@@ -11,18 +11,20 @@
 // Callback capture variables
 static char captured_lines[10][TEST_BUF_SIZE];
 static size_t captured_lengths[10];
+static const unsigned char *captured_data[10];
 static int callback_count;
 static int current_capture_index;
 static const int MAX_CAPTURES = 10;
 
 // Test callback implementation
-void test_line_callback(const buffer_t *line_buf)
+void test_line_callback(void *ctx, const buffer_t *line_buf)
 {
     if (callback_count < MAX_CAPTURES && line_buf->size < TEST_BUF_SIZE)
     {
         memcpy(captured_lines[callback_count], line_buf->data, line_buf->size);
         captured_lines[callback_count][line_buf->size] = '\0'; // Safe null termination
         captured_lengths[callback_count] = line_buf->size;
+        captured_data[callback_count] = line_buf->data;
         callback_count++;
     }
 }
@@ -45,7 +47,7 @@ void process_string(line_reader_t *lr, const char *str)
 void test_lr_simple_line()
 {
     line_reader_t lr;
-    line_reader_init(&lr, test_line_callback);
+    line_reader_init(&lr, test_line_callback, NULL);
     reset_callback_capture();
 
     process_string(&lr, "hello world\n");
@@ -58,7 +60,7 @@ void test_lr_simple_line()
 void test_lr_crlf_handling()
 {
     line_reader_t lr;
-    line_reader_init(&lr, test_line_callback);
+    line_reader_init(&lr, test_line_callback, NULL);
     reset_callback_capture();
 
     process_string(&lr, "line1\r\n");
@@ -71,7 +73,7 @@ void test_lr_crlf_handling()
 void test_lr_empty_lines_ignored()
 {
     line_reader_t lr;
-    line_reader_init(&lr, test_line_callback);
+    line_reader_init(&lr, test_line_callback, NULL);
     reset_callback_capture();
 
     process_string(&lr, "\n\nhello\n\n");
@@ -84,7 +86,7 @@ void test_lr_empty_lines_ignored()
 void test_lr_embedded_cr()
 {
     line_reader_t lr;
-    line_reader_init(&lr, test_line_callback);
+    line_reader_init(&lr, test_line_callback, NULL);
     reset_callback_capture();
 
     process_string(&lr, "hello\rworld\n");
@@ -97,7 +99,7 @@ void test_lr_embedded_cr()
 void test_lr_multiple_lines()
 {
     line_reader_t lr;
-    line_reader_init(&lr, test_line_callback);
+    line_reader_init(&lr, test_line_callback, NULL);
     reset_callback_capture();
 
     process_string(&lr, "line1\nline2\n");
@@ -112,7 +114,7 @@ void test_lr_multiple_lines()
 void test_lr_binary_data()
 {
     line_reader_t lr;
-    line_reader_init(&lr, test_line_callback);
+    line_reader_init(&lr, test_line_callback, NULL);
     reset_callback_capture();
 
     // Process chars manually since 'a\0b\n' would stop at null in process_string
@@ -131,7 +133,7 @@ void test_lr_binary_data()
 void test_lr_line_too_long()
 {
     line_reader_t lr;
-    line_reader_init(&lr, test_line_callback);
+    line_reader_init(&lr, test_line_callback, NULL);
     reset_callback_capture();
 
     // Feed 2049 'a's followed by \n (exceeds READ_BUF_SIZE)
@@ -149,4 +151,164 @@ void test_lr_line_too_long()
     assert_string(captured_lines[0], "valid", "valid line content");
 }
 
+void test_lr_buffer_views()
+{
+    line_reader_t lr;
+    line_reader_init(&lr, test_line_callback, NULL);
+    reset_callback_capture();
+
+    const char *first = "line1\r\n\nline2\npar";
+    line_reader_process_buffer(&lr, (const uint8_t *)first, strlen(first));
+    assert_equal_int(callback_count, 2, "complete lines delivered");
+    assert_string(captured_lines[0], "line1", "first line");
+    assert_true(captured_data[0] == (const unsigned char *)first, "first line not copied");
+    assert_true(captured_data[1] == (const unsigned char *)first + 8, "second line not copied");
+
+    const char *second = "tial\nlast\n";
+    line_reader_process_buffer(&lr, (const uint8_t *)second, strlen(second));
+    assert_equal_int(callback_count, 4, "fragment joined");
+    assert_string(captured_lines[2], "partial", "joined line");
+    assert_true(captured_data[3] == (const unsigned char *)second + 5, "line after fragment not copied");
+
+    // Over-long lines are dropped whether complete in one block or spanning blocks
+    static uint8_t block[3 * READ_BUF_SIZE];
+    memset(block, 'a', sizeof(block));
+    block[READ_BUF_SIZE + 1] = '\n';
+    reset_callback_capture();
+    line_reader_process_buffer(&lr, block, READ_BUF_SIZE + 2);
+    line_reader_process_buffer(&lr, block, READ_BUF_SIZE);
+    line_reader_process_buffer(&lr, block, 10);
+    line_reader_process_buffer(&lr, (const uint8_t *)"\nok\n", 4);
+    assert_equal_int(callback_count, 1, "long lines dropped");
+    assert_string(captured_lines[0], "ok", "line after long lines");
+
+    // The longest allowed line, with CR, spanning two blocks
+    memset(block, 'b', sizeof(block));
+    block[READ_BUF_SIZE - 1] = '\r';
+    block[READ_BUF_SIZE] = '\n';
+    reset_callback_capture();
+    line_reader_process_buffer(&lr, block, 100);
+    line_reader_process_buffer(&lr, block + 100, READ_BUF_SIZE + 1 - 100);
+    assert_equal_int(callback_count, 1, "longest line kept");
+    assert_equal_int(captured_lengths[0], READ_BUF_SIZE - 1, "longest line length");
+}
+
+void test_lr_buffer_matches_bytes()
+{
+    const char *input = "N0CALL>APRS:hello\r\n\n\r\nab\rc\nx\nlonger line here\n\nend";
+    size_t len = strlen(input);
+
+    line_reader_t lr;
+    line_reader_init(&lr, test_line_callback, NULL);
+    reset_callback_capture();
+    process_string(&lr, input);
+    process_string(&lr, "\n");
+    int expected_count = callback_count;
+    char expected[10][TEST_BUF_SIZE];
+    memcpy(expected, captured_lines, sizeof(expected));
+
+    // Every way of cutting the input in three gives the same lines
+    for (size_t a = 0; a <= len; a++)
+        for (size_t b = a; b <= len; b++)
+        {
+            line_reader_init(&lr, test_line_callback, NULL);
+            reset_callback_capture();
+            line_reader_process_buffer(&lr, (const uint8_t *)input, a);
+            line_reader_process_buffer(&lr, (const uint8_t *)input + a, b - a);
+            line_reader_process_buffer(&lr, (const uint8_t *)input + b, len - b);
+            line_reader_process_buffer(&lr, (const uint8_t *)"\n", 1);
+            if (callback_count != expected_count || memcmp(expected, captured_lines, sizeof(expected)))
+            {
+                assert_true(false, "split input matches byte input");
+                return;
+            }
+        }
+    assert_equal_int(expected_count, 5, "byte input lines");
+}
+
+typedef struct test_line_client
+{
+    int lines;
+    int batches;
+    int bytes;
+    int longest;
+} test_line_client_t;
+
+static void test_line_client_batch(void *ctx, const buffer_t *lines, int count)
+{
+    test_line_client_t *client = ctx;
+    client->batches++;
+    client->lines += count;
+    for (int i = 0; i < count; i++)
+    {
+        client->bytes += lines[i].size;
+        if (lines[i].size > client->longest)
+            client->longest = lines[i].size;
+    }
+}
+
+void test_lr_context_batches()
+{
+    // Independent readers, one per client, with no shared state
+    test_line_client_t clients[2] = {0};
+    line_reader_t readers[2];
+    for (int i = 0; i < 2; i++)
+        line_reader_init_batch(&readers[i], test_line_client_batch, &clients[i]);
+
+    const char *block = "a\nbb\nccc\npartial";
+    line_reader_process_buffer(&readers[0], (const uint8_t *)block, strlen(block));
+    line_reader_process_buffer(&readers[1], (const uint8_t *)"x\n", 2);
+    assert_equal_int(clients[0].batches, 1, "one call per block");
+    assert_equal_int(clients[0].lines, 3, "lines in batch");
+    assert_equal_int(clients[1].lines, 1, "second reader separate");
+
+    line_reader_process_buffer(&readers[0], (const uint8_t *)"\n", 1);
+    assert_equal_int(clients[0].lines, 4, "fragment completed");
+    assert_equal_int(clients[0].bytes, 13, "line bytes");
+
+    // Blocks with more lines than fit in a batch are split over several calls
+    static uint8_t many[3 * LINE_READER_BATCH];
+    for (int i = 0; i < (int)sizeof(many); i += 3)
+        memcpy(&many[i], "ab\n", 3);
+    clients[1] = (test_line_client_t){0};
+    line_reader_process_buffer(&readers[1], many, sizeof(many));
+    assert_equal_int(clients[1].lines, LINE_READER_BATCH, "all lines delivered");
+    assert_equal_int(clients[1].batches, 1, "full batch");
+    line_reader_process_buffer(&readers[1], (const uint8_t *)"c\n", 2);
+    line_reader_process_buffer(&readers[1], many, sizeof(many) - 3);
+    assert_equal_int(clients[1].batches, 3, "second block");
+    assert_equal_int(clients[1].lines, 2 * LINE_READER_BATCH, "second block lines");
+
+    // Long lines grow heap storage up to the cap, longer ones are counted as dropped
+    static uint8_t big[5 * READ_BUF_SIZE];
+    memset(big, 'z', sizeof(big));
+    clients[0] = (test_line_client_t){0};
+    line_reader_set_max_line(&readers[0], 4 * READ_BUF_SIZE);
+    for (int i = 0; i < 4 * READ_BUF_SIZE; i += 100)
+        line_reader_process_buffer(&readers[0], big, min(100, 4 * READ_BUF_SIZE - i));
+    line_reader_process_buffer(&readers[0], (const uint8_t *)"\n", 1);
+    assert_equal_int(clients[0].longest, 4 * READ_BUF_SIZE, "long line kept");
+    assert_true(readers[0].arena_capacity <= 4 * READ_BUF_SIZE, "storage capped");
+
+    line_reader_process_buffer(&readers[0], big, 4 * READ_BUF_SIZE + 1);
+    line_reader_process_buffer(&readers[0], (const uint8_t *)"\n", 1);
+    big[4 * READ_BUF_SIZE + 1] = '\n';
+    line_reader_process_buffer(&readers[0], big, 4 * READ_BUF_SIZE + 2);
+    assert_equal_int(readers[0].dropped, 2, "over-long lines dropped");
+    assert_equal_int(clients[0].lines, 1, "no over-long line delivered");
+    line_reader_process_buffer(&readers[0], (const uint8_t *)"ok\n", 3);
+    assert_equal_int(clients[0].lines, 2, "reader recovers");
+
+    // Lowering the cap below a stored fragment drops that line
+    line_reader_process_buffer(&readers[0], big, 3 * READ_BUF_SIZE);
+    line_reader_set_max_line(&readers[0], 2 * READ_BUF_SIZE);
+    line_reader_process_buffer(&readers[0], big, 100);
+    line_reader_process_buffer(&readers[0], (const uint8_t *)"\nok\n", 4);
+    assert_equal_int(readers[0].dropped, 3, "fragment over the lowered cap dropped");
+    assert_equal_int(clients[0].lines, 3, "only the short line delivered");
+
+    for (int i = 0; i < 2; i++)
+        line_reader_free(&readers[i]);
+}
+
 #endif
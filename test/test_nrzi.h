@@ -0,0 +1,88 @@
+#ifndef TEST_NRZI_H
+#define TEST_NRZI_H
+
+#include "test.h"
+#include "nrzi.h"
+
+// Every 16 bit word from both starting states matches the single bit functions, as do the
+// states left behind
+void test_nrzi_words_exhaustive()
+{
+    int encode_errors = 0, decode_errors = 0;
+    for (int state = 0; state <= 1; state++)
+        for (uint32_t x = 0; x < 1 << 16; x++)
+        {
+            int enc_bit = state, enc_word = state, dec_bit = state, dec_word = state;
+            uint64_t encoded = 0, decoded = 0;
+            for (int i = 0; i < 16; i++)
+            {
+                encoded |= (uint64_t)nrzi_encode((x >> i) & 1, &enc_bit) << i;
+                decoded |= (uint64_t)nrzi_decode((x >> i) & 1, &dec_bit) << i;
+            }
+            if (nrzi_encode_word(x, 16, &enc_word) != encoded || enc_word != enc_bit)
+                encode_errors++;
+            if (nrzi_decode_word(x, 16, &dec_word) != decoded || dec_word != dec_bit)
+                decode_errors++;
+        }
+    assert_equal_int(encode_errors, 0, "encode matches scalar");
+    assert_equal_int(decode_errors, 0, "decode matches scalar");
+}
+
+// Long streams cut into words of every length carry state across words
+void test_nrzi_words_stream()
+{
+    static uint8_t bits[64 * 65], levels[64 * 65];
+    uint32_t seed = 7;
+    int enc_bit, dec_bit;
+    nrzi_encoder_init(&enc_bit);
+    for (int i = 0; i < (int)sizeof(bits); i++)
+    {
+        seed = seed * 1664525 + 1013904223;
+        // Runs of ones as well as random bits
+        bits[i] = i % 400 < 100 ? 1 : seed >> 31;
+        levels[i] = nrzi_encode(bits[i], &enc_bit);
+    }
+
+    int encode_errors = 0, decode_errors = 0, prefix_errors = 0;
+    int enc_word, dec_word;
+    nrzi_encoder_init(&enc_word);
+    nrzi_decoder_init(&dec_word);
+    nrzi_decoder_init(&dec_bit);
+    for (int pos = 0, n = 1; pos < (int)sizeof(bits); pos += n, n = n % 64 + 1)
+    {
+        n = n < (int)sizeof(bits) - pos ? n : (int)sizeof(bits) - pos;
+        uint64_t in = 0, line = 0;
+        for (int i = 0; i < n; i++)
+        {
+            in |= (uint64_t)bits[pos + i] << i;
+            line |= (uint64_t)levels[pos + i] << i;
+        }
+
+        // Garbage above n is ignored
+        uint64_t above = n == 64 ? 0 : ~nrzi_word_mask(n);
+        if (nrzi_encode_word(in | above, n, &enc_word) != line)
+            encode_errors++;
+
+        uint64_t out = nrzi_decode_word(line | above, n, &dec_word);
+        for (int i = 0; i < n; i++)
+            if (((out >> i) & 1) != (uint64_t)nrzi_decode(levels[pos + i], &dec_bit) || ((out >> i) & 1) != bits[pos + i])
+                decode_errors++;
+        if (out & above)
+            decode_errors++;
+
+        uint64_t naive = 0, acc = 0;
+        for (int i = 0; i < 64; i++)
+        {
+            acc ^= (line >> i) & 1;
+            naive |= acc << i;
+        }
+        if (nrzi_prefix_xor(line) != naive)
+            prefix_errors++;
+    }
+    assert_equal_int(encode_errors, 0, "stream encode");
+    assert_equal_int(decode_errors, 0, "stream decode");
+    assert_equal_int(prefix_errors, 0, "prefix xor");
+    assert_equal_int(enc_word, enc_bit, "encoder state");
+}
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef TEST_RESAMPLE_H
+#define TEST_RESAMPLE_H
+
+#include "test.h"
+#include <math.h>
+#include <string.h>
+#include "resample.h"
+#include "test_afsk.h"
+
+// Resamples in uneven blocks, returns the output length
+static int resample_test_run(resampler_t *rs, const float *in, int len, float *out, int capacity)
+{
+    int total = 0;
+    for (int pos = 0, block = 1; pos < len; pos += block, block = block % 900 + 37)
+    {
+        int n = min(block, len - pos);
+        float_buffer_t in_buf = {.data = (float *)&in[pos], .capacity = n, .size = n};
+        float_buffer_t out_buf = {.data = &out[total], .capacity = capacity - total, .size = 0};
+        int ret = resampler_process(rs, &in_buf, &out_buf);
+        if (ret < 0)
+            return ret;
+        total += ret;
+    }
+    return total;
+}
+
+static float resample_test_rms(const float *x, int from, int to)
+{
+    double sum = 0;
+    for (int i = from; i < to; i++)
+        sum += x[i] * x[i];
+    return sqrtf(sum / (to - from));
+}
+
+void test_resample_rates()
+{
+    const int pairs[][2] = {{48000, 38400}, {44100, 38400}, {96000, 38400}, {44100, 9600}, {48000, 9600}, {8000, 48000}, {44100, 48000}};
+    static float in[96000], out[96000], blocks[96000];
+
+    for (int r = 0; r < (int)(sizeof(pairs) / sizeof(pairs[0])); r++)
+    {
+        int in_rate = pairs[r][0], out_rate = pairs[r][1];
+        resampler_t rs;
+        assert_equal_int(resampler_init(&rs, in_rate, out_rate), 0, "init");
+
+        // One second in is one second out, with the tone kept at its level and frequency
+        for (int i = 0; i < in_rate; i++)
+            in[i] = sin(2 * M_PI * (1000 * i % in_rate) / in_rate);
+        float_buffer_t in_buf = {.data = in, .capacity = in_rate, .size = in_rate};
+        float_buffer_t out_buf = {.data = out, .capacity = 96000, .size = 0};
+        int n = resampler_process(&rs, &in_buf, &out_buf);
+        assert_true(abs(n - out_rate) <= 1, "output length");
+        float rms = resample_test_rms(out, out_rate / 10, n);
+        assert_true(fabsf(rms - sqrtf(0.5f)) < 0.005f, "passband gain");
+        float tone = afsk_test_power(&out[out_rate / 10], n - out_rate / 10, 1000, out_rate);
+        float off = afsk_test_power(&out[out_rate / 10], n - out_rate / 10, 1300, out_rate);
+        assert_true(tone > 1e4f * off, "tone frequency");
+
+        // Blocks of any size give the same samples as one call
+        resampler_free(&rs);
+        resampler_init(&rs, in_rate, out_rate);
+        assert_equal_int(resample_test_run(&rs, in, in_rate, blocks, 96000), n, "same length in blocks");
+        assert_memory(blocks, out, n * sizeof(float), "same samples in blocks");
+        resampler_free(&rs);
+
+        // Tones the output rate cannot carry are filtered rather than aliased
+        if (out_rate < in_rate)
+        {
+            resampler_init(&rs, in_rate, out_rate);
+            double hz = 0.56 * out_rate;
+            for (int i = 0; i < in_rate; i++)
+                in[i] = sin(2 * M_PI * fmod(hz * i, in_rate) / in_rate);
+            n = resampler_process(&rs, &in_buf, &out_buf);
+            assert_true(resample_test_rms(out, out_rate / 10, n) < 1e-4f, "stopband");
+            resampler_free(&rs);
+        }
+    }
+
+    resampler_t rs;
+    assert_equal_int(resampler_init(&rs, 0, 48000), -RESAMPLER_INVALID_RATE, "zero rate");
+    assert_equal_int(resampler_init(&rs, 44100, 48001), -RESAMPLER_INVALID_RATE, "too many phases");
+
+    resampler_init(&rs, 44100, 9600);
+    float_buffer_t in_buf = {.data = in, .capacity = 1000, .size = 1000};
+    float_buffer_t small = {.data = out, .capacity = 10, .size = 0};
+    assert_equal_int(resampler_process(&rs, &in_buf, &small), -RESAMPLER_BUF_TOO_SMALL, "too small");
+    resampler_free(&rs);
+}
+
+void test_resample_afsk()
+{
+    // A 44.1 kHz capture decimated to 8 samples per bit still decodes
+    static float audio[44100 * 10], decimated[9600 * 10 + 1];
+    afsk_test_channel_t ch = {.seed = 5, .mark_gain = 0.5f, .space_gain = 0.5f};
+    ch.noise = afsk_test_ebn0(0.5f, 12, 44100);
+    int len = afsk_test_render(&ch, 44100, 20, audio, sizeof(audio) / sizeof(float));
+
+    resampler_t rs;
+    resampler_init(&rs, 44100, 9600);
+    int n = resample_test_run(&rs, audio, len, decimated, sizeof(decimated) / sizeof(float));
+    resampler_free(&rs);
+    assert_true(afsk_test_decode(decimated, n, 9600) >= 18, "decimated loopback");
+}
+
+#endif
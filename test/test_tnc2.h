@@ -2,6 +2,7 @@
 #define TEST_TNC2_H
 
 #include "test.h"
+#include <stdio.h>
 #include <string.h>
 #include "tnc2.h"
 #include "ax25.h"
@@ -10,6 +11,8 @@
 void test_tnc2_string_to_packet_with_repeated()
 {
     ax25_packet_t packet;
+    uint8_t packet_info[AX25_MAX_INFO_LEN];
+    ax25_packet_init(&packet, packet_info, sizeof(packet_info));
     const char *str = "N0CALL>APN001,RPTD*:test!abcdefghijkl";
     buffer_t buf = {.data = (unsigned char *)str, .capacity = strlen(str), .size = strlen(str)};
     int ret = tnc2_string_to_packet(&packet, &buf);
@@ -22,10 +25,13 @@ void test_tnc2_string_to_packet_with_repeated()
 void test_tnc2_roundtrip_simple()
 {
     ax25_packet_t packet1, packet2;
+    uint8_t packet1_info[AX25_MAX_INFO_LEN];
+    uint8_t packet2_info[AX25_MAX_INFO_LEN];
+    ax25_packet_init(&packet1, packet1_info, sizeof(packet1_info));
+    ax25_packet_init(&packet2, packet2_info, sizeof(packet2_info));
     unsigned char buf_data[256];
     buffer_t buf = {.data = buf_data, .capacity = sizeof(buf_data), .size = 0};
 
-    ax25_packet_init(&packet1);
     ax25_addr_init_with(&packet1.source, "SRC", 0, 0);
     ax25_addr_init_with(&packet1.destination, "DST", 0, 0);
     memcpy(packet1.info, "test", 4);
@@ -43,10 +49,13 @@ void test_tnc2_roundtrip_simple()
 void test_tnc2_roundtrip_complex()
 {
     ax25_packet_t packet1, packet2;
+    uint8_t packet1_info[AX25_MAX_INFO_LEN];
+    uint8_t packet2_info[AX25_MAX_INFO_LEN];
+    ax25_packet_init(&packet1, packet1_info, sizeof(packet1_info));
+    ax25_packet_init(&packet2, packet2_info, sizeof(packet2_info));
     unsigned char buf_data[256];
     buffer_t buf = {.data = buf_data, .capacity = sizeof(buf_data), .size = 0};
 
-    ax25_packet_init(&packet1);
     ax25_addr_init_with(&packet1.source, "SRC", 1, 0);
     ax25_addr_init_with(&packet1.destination, "DST", 2, 0);
     packet1.path_len = 2;
@@ -69,6 +78,8 @@ void test_tnc2_roundtrip_complex()
 void test_tnc2_invalid_chars_in_callsign()
 {
     ax25_packet_t packet;
+    uint8_t packet_info[AX25_MAX_INFO_LEN];
+    ax25_packet_init(&packet, packet_info, sizeof(packet_info));
     const char *str = "SRC@>DEST:info";
     buffer_t buf = {.data = (unsigned char *)str, .capacity = strlen(str), .size = strlen(str)};
     int ret = tnc2_string_to_packet(&packet, &buf);
@@ -78,6 +89,8 @@ void test_tnc2_invalid_chars_in_callsign()
 void test_tnc2_control_char()
 {
     ax25_packet_t packet;
+    uint8_t packet_info[AX25_MAX_INFO_LEN];
+    ax25_packet_init(&packet, packet_info, sizeof(packet_info));
     const char *str = "SRC\x00>DEST:info";
     buffer_t buf = {.data = (unsigned char *)str, .capacity = 14, .size = 14};
     int ret = tnc2_string_to_packet(&packet, &buf);
@@ -87,6 +100,8 @@ void test_tnc2_control_char()
 void test_tnc2_ssid_overflow()
 {
     ax25_packet_t packet;
+    uint8_t packet_info[AX25_MAX_INFO_LEN];
+    ax25_packet_init(&packet, packet_info, sizeof(packet_info));
     const char *str = "SRC-999>DEST:info";
     buffer_t buf = {.data = (unsigned char *)str, .capacity = strlen(str), .size = strlen(str)};
     int ret = tnc2_string_to_packet(&packet, &buf);
@@ -96,6 +111,8 @@ void test_tnc2_ssid_overflow()
 void test_tnc2_missing_greater_than()
 {
     ax25_packet_t packet;
+    uint8_t packet_info[AX25_MAX_INFO_LEN];
+    ax25_packet_init(&packet, packet_info, sizeof(packet_info));
     const char *str = "SRCDEST:info";
     buffer_t buf = {.data = (unsigned char *)str, .capacity = strlen(str), .size = strlen(str)};
     int ret = tnc2_string_to_packet(&packet, &buf);
@@ -105,6 +122,8 @@ void test_tnc2_missing_greater_than()
 void test_tnc2_missing_colon()
 {
     ax25_packet_t packet;
+    uint8_t packet_info[AX25_MAX_INFO_LEN];
+    ax25_packet_init(&packet, packet_info, sizeof(packet_info));
     const char *str = "SRC>DESTinfo";
     buffer_t buf = {.data = (unsigned char *)str, .capacity = strlen(str), .size = strlen(str)};
     int ret = tnc2_string_to_packet(&packet, &buf);
@@ -114,6 +133,8 @@ void test_tnc2_missing_colon()
 void test_tnc2_empty_callsign()
 {
     ax25_packet_t packet;
+    uint8_t packet_info[AX25_MAX_INFO_LEN];
+    ax25_packet_init(&packet, packet_info, sizeof(packet_info));
     const char *str = "->DEST:info";
     buffer_t buf = {.data = (unsigned char *)str, .capacity = strlen(str), .size = strlen(str)};
     int ret = tnc2_string_to_packet(&packet, &buf);
@@ -123,6 +144,8 @@ void test_tnc2_empty_callsign()
 void test_tnc2_too_many_digis()
 {
     ax25_packet_t packet;
+    uint8_t packet_info[AX25_MAX_INFO_LEN];
+    ax25_packet_init(&packet, packet_info, sizeof(packet_info));
     const char *str = "SRC>DEST,D1,D2,D3,D4,D5,D6,D7,D8,D9:info";
     buffer_t buf = {.data = (unsigned char *)str, .capacity = strlen(str), .size = strlen(str)};
     int ret = tnc2_string_to_packet(&packet, &buf);
@@ -132,6 +155,8 @@ void test_tnc2_too_many_digis()
 void test_tnc2_callsign_too_long()
 {
     ax25_packet_t packet;
+    uint8_t packet_info[AX25_MAX_INFO_LEN];
+    ax25_packet_init(&packet, packet_info, sizeof(packet_info));
     const char *str = "ABCDEFGHIJ>DEST:info";
     buffer_t buf = {.data = (unsigned char *)str, .capacity = strlen(str), .size = strlen(str)};
     int ret = tnc2_string_to_packet(&packet, &buf);
@@ -141,6 +166,8 @@ void test_tnc2_callsign_too_long()
 void test_tnc2_space_in_callsign()
 {
     ax25_packet_t packet;
+    uint8_t packet_info[AX25_MAX_INFO_LEN];
+    ax25_packet_init(&packet, packet_info, sizeof(packet_info));
     const char *str = "SR C>DEST:info";
     buffer_t buf = {.data = (unsigned char *)str, .capacity = strlen(str), .size = strlen(str)};
     int ret = tnc2_string_to_packet(&packet, &buf);
@@ -150,6 +177,8 @@ void test_tnc2_space_in_callsign()
 void test_tnc2_info_too_large()
 {
     ax25_packet_t packet;
+    uint8_t packet_info[AX25_MAX_INFO_LEN];
+    ax25_packet_init(&packet, packet_info, sizeof(packet_info));
     char str[600];
     memcpy(str, "SRC>DEST:", 9);
     memset(str + 9, 'X', 550);
@@ -193,7 +222,10 @@ void test_tnc2_null_termination()
 void test_tnc2_packet_roundtrip_with_null_term()
 {
     ax25_packet_t packet1, packet2;
-    ax25_packet_init(&packet1);
+    uint8_t packet1_info[AX25_MAX_INFO_LEN];
+    uint8_t packet2_info[AX25_MAX_INFO_LEN];
+    ax25_packet_init(&packet1, packet1_info, sizeof(packet1_info));
+    ax25_packet_init(&packet2, packet2_info, sizeof(packet2_info));
     ax25_addr_init_with(&packet1.source, "SRC", 0, 0);
     ax25_addr_init_with(&packet1.destination, "DST", 0, 0);
     memcpy(packet1.info, "HELLO APRS", 10);
@@ -221,6 +253,8 @@ void test_tnc2_packet_roundtrip_with_null_term()
 void test_tnc2_edge_case_mixed_valid_invalid_chars()
 {
     ax25_packet_t packet;
+    uint8_t packet_info[AX25_MAX_INFO_LEN];
+    ax25_packet_init(&packet, packet_info, sizeof(packet_info));
     // Test callsign with valid chars followed by invalid
     const char *str1 = "ABC123@>DEST:info";
     buffer_t buf1 = {.data = (unsigned char *)str1, .capacity = strlen(str1), .size = strlen(str1)};
@@ -243,6 +277,8 @@ void test_tnc2_edge_case_mixed_valid_invalid_chars()
 void test_tnc2_edge_case_boundary_digits()
 {
     ax25_packet_t packet;
+    uint8_t packet_info[AX25_MAX_INFO_LEN];
+    ax25_packet_init(&packet, packet_info, sizeof(packet_info));
     // Test SSID boundary values
     const char *str1 = "CALL-15>DEST:info"; // Max valid SSID
     buffer_t buf1 = {.data = (unsigned char *)str1, .capacity = strlen(str1), .size = strlen(str1)};
@@ -283,4 +319,177 @@ void test_tnc2_edge_case_callsign_padding()
     assert_equal_int(n, 1, "single char callsign length");
     assert_string((char *)buf.data, "A", "single char callsign content");
 }
+
+void test_tnc2_info_capacity()
+{
+    char str[600];
+    memcpy(str, "SRC>DEST:", 9);
+    memset(str + 9, 'X', 500);
+    buffer_t buf = {.data = (unsigned char *)str, .capacity = sizeof(str), .size = 509};
+
+    ax25_packet_t packet;
+    uint8_t info[512];
+    ax25_packet_init(&packet, info, sizeof(info));
+    assert_equal_int(tnc2_string_to_packet(&packet, &buf), 0, "accept info within runtime capacity");
+    assert_equal_int(packet.info_len, 500, "large info len");
+
+    ax25_packet_init(&packet, info, 100);
+    assert_equal_int(tnc2_string_to_packet(&packet, &buf), -1, "reject info over runtime capacity");
+}
+
+void test_tnc2_format_ssids()
+{
+    uint8_t info[AX25_MAX_INFO_LEN];
+    ax25_packet_t packet;
+    ax25_packet_init(&packet, info, sizeof(info));
+    ax25_addr_init_with(&packet.source, "N0CALL", 0, false);
+    ax25_addr_init_with(&packet.destination, "APRS", 0, false);
+    packet.path_len = 1;
+    memcpy(packet.info, ">hi", 3);
+    packet.info_len = 3;
+
+    char expected[64];
+    unsigned char out[64];
+    for (int ssid = 0; ssid <= 15; ssid++)
+    {
+        packet.source.ssid = ssid;
+        ax25_addr_init_with(&packet.path[0], "WIDE2", ssid, ssid % 2);
+        if (ssid)
+            sprintf(expected, "N0CALL-%d>APRS,WIDE2-%d%s:>hi", ssid, ssid, ssid % 2 ? "*" : "");
+        else
+            strcpy(expected, "N0CALL>APRS,WIDE2:>hi");
+
+        int len = strlen(expected);
+        assert_equal_int(tnc2_packet_string_len(&packet), len, "formatted length");
+
+        // Exact fit succeeds without a terminator, one byte less fails
+        buffer_t buf = {.data = out, .capacity = len, .size = 0};
+        assert_equal_int(tnc2_packet_to_string(&packet, &buf), len, "exact fit");
+        assert_memory(out, expected, len, "formatted packet");
+        buf.size = 0;
+        buf.capacity = len - 1;
+        assert_equal_int(tnc2_packet_to_string(&packet, &buf), -1, "one byte short");
+    }
+
+    packet.path[0].ssid = 16;
+    assert_equal_int(tnc2_packet_string_len(&packet), -1, "ssid out of range");
+}
+
+void test_tnc2_packets_to_lines()
+{
+    uint8_t info[3][AX25_MAX_INFO_LEN];
+    ax25_packet_t packets[3];
+    const char *lines[3] = {"N0CALL>APRS:>one", "N1CALL-7>APRS,WIDE1-1*,WIDE2-1:!two", "N2CALL-15>APZ:three"};
+    const ax25_packet_t *refs[3];
+    for (int i = 0; i < 3; i++)
+    {
+        ax25_packet_init(&packets[i], info[i], sizeof(info[i]));
+        buffer_t str = {.data = (unsigned char *)lines[i], .capacity = strlen(lines[i]), .size = strlen(lines[i])};
+        tnc2_string_to_packet(&packets[i], &str);
+        refs[i] = &packets[i];
+    }
+
+    const char *expected = "N0CALL>APRS:>one\nN1CALL-7>APRS,WIDE1-1*,WIDE2-1:!two\nN2CALL-15>APZ:three\n";
+    unsigned char out[128];
+    memcpy(out, "log\n", 4);
+    buffer_t buf = {.data = out, .capacity = sizeof(out), .size = 4};
+    assert_equal_int(tnc2_packets_to_lines(refs, 3, &buf), 3, "all appended");
+    assert_equal_int(buf.size, 4 + strlen(expected), "appended size");
+    assert_memory(out, "log\n", 4, "existing content kept");
+    assert_memory(out + 4, expected, strlen(expected), "appended lines");
+
+    // Stops at the first line that does not fit
+    buf.size = 0;
+    buf.capacity = strlen("N0CALL>APRS:>one\n") + 10;
+    assert_equal_int(tnc2_packets_to_lines(refs, 3, &buf), 1, "partial batch");
+    assert_equal_int(buf.size, strlen("N0CALL>APRS:>one\n"), "partial size");
+}
+
+void test_tnc2_header_limits()
+{
+    uint8_t info[AX25_MAX_INFO_LEN];
+    ax25_packet_t packet;
+    ax25_packet_init(&packet, info, sizeof(info));
+
+    // Longest possible header, with a ':' in the info
+    const char *longest = "CALLSA-15*>CALLSB-15,CALLSC-15*,CALLSD-15*,CALLSE-15*,CALLSF-15*,CALLSG-15*,"
+                          "CALLSH-15*,CALLSI-15*,CALLSJ-15:a:b";
+    buffer_t buf = {.data = (unsigned char *)longest, .capacity = strlen(longest), .size = strlen(longest)};
+    assert_equal_int(tnc2_string_to_packet(&packet, &buf), 0, "longest header");
+    assert_equal_int(packet.path_len, 8, "longest header path");
+    assert_memory(packet.path[7].callsign, "CALLSJ", 6, "last digipeater");
+    assert_equal_int(packet.path[7].ssid, 15, "last digipeater ssid");
+    assert_equal_int(packet.path[6].repeated, 1, "repeated digipeater");
+    assert_equal_int(packet.info_len, 3, "info after first colon");
+
+    const char *lower = "n0call-7>apdw16:x";
+    buf = (buffer_t){.data = (unsigned char *)lower, .capacity = strlen(lower), .size = strlen(lower)};
+    assert_equal_int(tnc2_string_to_packet(&packet, &buf), 0, "lower case callsigns");
+    assert_memory(packet.source.callsign, "n0call", 6, "lower case kept");
+
+    const char *high = "N0C\xc1LL>APRS:x";
+    buf = (buffer_t){.data = (unsigned char *)high, .capacity = strlen(high), .size = strlen(high)};
+    assert_equal_int(tnc2_string_to_packet(&packet, &buf), -1, "reject non-ASCII");
+
+    const char *twice = "N0CALL>APRS>WIDE:x";
+    buf = (buffer_t){.data = (unsigned char *)twice, .capacity = strlen(twice), .size = strlen(twice)};
+    assert_equal_int(tnc2_string_to_packet(&packet, &buf), -1, "reject second >");
+
+    const char *comma_first = "N0CALL,WIDE>APRS:x";
+    buf = (buffer_t){.data = (unsigned char *)comma_first, .capacity = strlen(comma_first), .size = strlen(comma_first)};
+    assert_equal_int(tnc2_string_to_packet(&packet, &buf), -1, "reject path before destination");
+
+    char far[200];
+    memset(far, 'A', sizeof(far));
+    memcpy(far, "N0CALL>APRS", 11);
+    far[150] = ':';
+    buf = (buffer_t){.data = (unsigned char *)far, .capacity = sizeof(far), .size = sizeof(far)};
+    assert_equal_int(tnc2_string_to_packet(&packet, &buf), -1, "reject overlong header");
+}
+
+void test_tnc2_view_third_party()
+{
+    const char *line = "N0CALL-10>APRS,TCPIP*,qAC,T2TEST:}KB1ABC-9>APOT21,TCPIP,N0CALL-10*:!4903.50N/07201.75W>";
+    tnc2_view_t view;
+    assert_equal_int(tnc2_view_parse(&view, (const uint8_t *)line, strlen(line)), 0, "parse igated line");
+    assert_true(tnc2_span_equal(&view.source, "N0CALL-10"), "outer source");
+    assert_true(tnc2_span_equal(&view.destination, "APRS"), "outer destination");
+    assert_equal_int(view.path_len, 3, "outer path");
+    assert_true(tnc2_span_equal(&view.path[0], "TCPIP*"), "path entry");
+    assert_equal_int(view.q_index, 1, "q-construct index");
+    assert_true(tnc2_span_equal(&view.q_construct, "qAC"), "q-construct");
+    assert_true(tnc2_span_equal(&view.q_gate, "T2TEST"), "q-construct gate");
+    assert_true(tnc2_span_equal(&view.header, "N0CALL-10>APRS,TCPIP*,qAC,T2TEST"), "outer header");
+    assert_true(view.third_party, "third party");
+    assert_true(view.source.data == (const uint8_t *)line, "views into the line");
+
+    // The inner packet parses as a view or as a packet
+    tnc2_view_t inner;
+    assert_equal_int(tnc2_view_parse(&inner, view.inner.data, view.inner.len), 0, "parse inner");
+    assert_true(tnc2_span_equal(&inner.source, "KB1ABC-9"), "inner source");
+    assert_equal_int(inner.q_index, -1, "no inner q-construct");
+    assert_true(tnc2_span_equal(&inner.info, "!4903.50N/07201.75W>"), "inner info");
+    assert_true(!inner.third_party, "inner not third party");
+
+    uint8_t info[AX25_MAX_INFO_LEN];
+    ax25_packet_t packet;
+    ax25_packet_init(&packet, info, sizeof(info));
+    buffer_t buf = {.data = (unsigned char *)view.inner.data, .capacity = view.inner.len, .size = view.inner.len};
+    assert_equal_int(tnc2_string_to_packet(&packet, &buf), 0, "inner packet");
+    assert_equal_int(packet.path_len, 2, "inner path");
+
+    // Paths longer than AX.25 allows, and server names over six characters
+    const char *longer = "N0CALL>APRS,WIDE1-1,WIDE2-1,A,B,C,D,E,F,G,qAR,IGATECALL:>status";
+    assert_equal_int(tnc2_view_parse(&view, (const uint8_t *)longer, strlen(longer)), 0, "long path");
+    assert_equal_int(view.path_len, 11, "long path length");
+    assert_equal_int(view.q_index, 9, "late q-construct");
+    assert_true(tnc2_span_equal(&view.q_gate, "IGATECALL"), "long gate name");
+    assert_true(!view.third_party, "not third party");
+
+    const char *bad[] = {"N0CALL>APRS", "N0CALL:>x", ">APRS:x", "N0CALL>:x", "N0CALL>APRS,,WIDE:x",
+                         "N0CALL>APRS>X:x", "N0 CALL>APRS:x", "N0,CALL>APRS:x", ""};
+    for (int i = 0; i < (int)(sizeof(bad) / sizeof(bad[0])); i++)
+        assert_equal_int(tnc2_view_parse(&view, (const uint8_t *)bad[i], strlen(bad[i])), -1, "malformed header");
+}
+
 #endif
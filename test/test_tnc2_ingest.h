@@ -0,0 +1,141 @@
+#ifndef TEST_TNC2_INGEST_H
+#define TEST_TNC2_INGEST_H
+
+#include "test.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include "tnc2.h"
+#include "tnc2_ingest.h"
+
+#define INGEST_TEST_LINES 20000
+
+typedef struct ingest_test_sink
+{
+    buffer_t out;
+    int64_t last_chunk;
+    bool in_order;
+    atomic_int packets;
+    atomic_int calls;
+} ingest_test_sink_t;
+
+static void ingest_test_collect(void *ctx, int worker, uint64_t chunk, const ax25_packet_t *packets, int count)
+{
+    ingest_test_sink_t *sink = ctx;
+    if ((int64_t)chunk <= sink->last_chunk)
+        sink->in_order = false;
+    sink->last_chunk = chunk;
+
+    for (int i = 0; i < count; i++)
+    {
+        const ax25_packet_t *packet = &packets[i];
+        tnc2_packets_to_lines(&packet, 1, &sink->out);
+    }
+}
+
+static void ingest_test_count(void *ctx, int worker, uint64_t chunk, const ax25_packet_t *packets, int count)
+{
+    ingest_test_sink_t *sink = ctx;
+    atomic_fetch_add(&sink->packets, count);
+    atomic_fetch_add(&sink->calls, 1);
+}
+
+// A log with CRLF endings, blank and malformed lines, and the valid lines as they format back
+static void ingest_test_log(buffer_t *log, buffer_t *expected)
+{
+    log->size = 0;
+    expected->size = 0;
+    for (int i = 0; i < INGEST_TEST_LINES; i++)
+    {
+        char line[200];
+        int len;
+        if (i % 97 == 0)
+            len = sprintf(line, "not a packet %d", i);
+        else
+        {
+            len = sprintf(line, "N%dCL-%d>APRS,WIDE%d-%d*:>status %d %.*s", i % 1000, i % 15 + 1, i % 3 + 1, i % 2 + 1, i,
+                          i % 80, "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx");
+            memcpy(&expected->data[expected->size], line, len);
+            expected->size += len;
+            expected->data[expected->size++] = '\n';
+        }
+        memcpy(&log->data[log->size], line, len);
+        log->size += len;
+        if (i % 5 == 0)
+            log->data[log->size++] = '\r';
+        log->data[log->size++] = '\n';
+        if (i % 31 == 0)
+            log->data[log->size++] = '\n';
+    }
+}
+
+void test_tnc2_ingest_ordered()
+{
+    size_t capacity = INGEST_TEST_LINES * 200;
+    buffer_t log = {.data = malloc(capacity), .capacity = capacity, .size = 0};
+    buffer_t expected = {.data = malloc(capacity), .capacity = capacity, .size = 0};
+    ingest_test_log(&log, &expected);
+
+    char path[] = "/tmp/tnc2_ingest_XXXXXX";
+    int fd = mkstemp(path);
+    assert_true(fd >= 0 && write(fd, log.data, log.size) == log.size, "log written");
+    close(fd);
+
+    // Chunks much larger and much smaller than a line
+    size_t chunk_sizes[] = {1 << 16, 1000, 7};
+    for (int i = 0; i < 3; i++)
+    {
+        ingest_test_sink_t sink = {.out = {.data = malloc(capacity), .capacity = capacity}, .last_chunk = -1, .in_order = true};
+        tnc2_ingest_config_t config;
+        tnc2_ingest_config_init(&config);
+        config.threads = 4;
+        config.chunk_size = chunk_sizes[i];
+        config.ordered = true;
+
+        tnc2_ingest_stats_t stats;
+        assert_equal_int(tnc2_ingest_file(path, &config, ingest_test_collect, &sink, &stats), 0, "ordered ingest");
+        assert_true(sink.in_order, "chunks delivered in order");
+        assert_equal_int(stats.lines, INGEST_TEST_LINES, "non-empty lines");
+        assert_equal_int(stats.errors, (INGEST_TEST_LINES + 96) / 97, "malformed lines");
+        assert_equal_int(stats.packets, stats.lines - stats.errors, "packets");
+        assert_equal_int(sink.out.size, expected.size, "output size");
+        assert_true(sink.out.size == expected.size && memcmp(sink.out.data, expected.data, expected.size) == 0, "packets in log order");
+        free(sink.out.data);
+    }
+
+    unlink(path);
+    free(log.data);
+    free(expected.data);
+}
+
+void test_tnc2_ingest_unordered()
+{
+    size_t capacity = INGEST_TEST_LINES * 200;
+    buffer_t log = {.data = malloc(capacity), .capacity = capacity, .size = 0};
+    buffer_t expected = {.data = malloc(capacity), .capacity = capacity, .size = 0};
+    ingest_test_log(&log, &expected);
+
+    ingest_test_sink_t sink = {.last_chunk = -1};
+    atomic_init(&sink.packets, 0);
+    atomic_init(&sink.calls, 0);
+    tnc2_ingest_config_t config;
+    tnc2_ingest_config_init(&config);
+    config.chunk_size = 4096;
+
+    tnc2_ingest_stats_t stats;
+    assert_equal_int(tnc2_ingest_buffer(log.data, log.size, &config, ingest_test_count, &sink, &stats), 0, "unordered ingest");
+    assert_equal_int(atomic_load(&sink.packets), stats.packets, "all packets delivered");
+    assert_equal_int(stats.packets, INGEST_TEST_LINES - (INGEST_TEST_LINES + 96) / 97, "packet count");
+    assert_equal_int(atomic_load(&sink.calls), (log.size + 4095) / 4096, "one call per chunk");
+
+    assert_equal_int(tnc2_ingest_buffer(NULL, 0, &config, ingest_test_count, &sink, &stats), 0, "empty input");
+    assert_equal_int(stats.lines, 0, "no lines");
+    assert_equal_int(tnc2_ingest_file("/nonexistent/log", &config, ingest_test_count, &sink, NULL), -TNC2_INGEST_IO, "missing file");
+
+    free(log.data);
+    free(expected.data);
+}
+
+#endif